@@ -0,0 +1,388 @@
+/*
+ *
+ *  Attract-Mode Plus frontend
+ *  Copyright (C) 2025 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode Plus
+ *
+ *  Attract-Mode Plus is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode Plus is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode Plus.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "fe_atlas.hpp"
+#include "fe_base.hpp" // logging
+#include "image_loader.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	const unsigned int PAGE_SIZE = 2048;
+	const int MAX_PAGES = 4;
+	const unsigned int PAD = 1; // pixels of padding around each image
+	const int EVICT_SCAN = 32; // unused slots checked for one the image loader has dropped
+
+	std::vector<std::uint8_t> g_scratch;
+
+	unsigned int shelf_height( unsigned int h )
+	{
+		return ( h + 3 ) & ~3u;
+	}
+};
+
+int FeTextureAtlas::s_max_image_size = 0;
+
+FeTextureAtlas &FeTextureAtlas::get_ref()
+{
+	static FeTextureAtlas atlas;
+	return atlas;
+}
+
+FeTextureAtlas::FeTextureAtlas()
+	: m_page_size( 0 )
+{
+}
+
+void FeTextureAtlas::set_max_image_size( int s )
+{
+	s = std::max( 0, std::min( s, (int)PAGE_SIZE / 4 ));
+	if ( s == s_max_image_size )
+		return;
+
+	s_max_image_size = s;
+
+	// images that no longer qualify shouldn't hold on to atlas space
+	get_ref().purge();
+}
+
+int FeTextureAtlas::get_max_image_size()
+{
+	return s_max_image_size;
+}
+
+bool FeTextureAtlas::is_candidate( unsigned int w, unsigned int h )
+{
+	return ( s_max_image_size > 0 )
+		&& ( w > 0 ) && ( h > 0 )
+		&& ( w <= (unsigned int)s_max_image_size )
+		&& ( h <= (unsigned int)s_max_image_size );
+}
+
+FeAtlasSlot *FeTextureAtlas::acquire( const std::string &key,
+	unsigned int w,
+	unsigned int h,
+	bool smooth )
+{
+	if ( !is_candidate( w, h ) )
+		return NULL;
+
+	std::string k = key;
+	k += smooth ? "|s" : "|n";
+
+	std::map< std::string, FeAtlasSlot * >::iterator itr = m_slots.find( k );
+	if ( itr != m_slots.end() )
+	{
+		FeAtlasSlot *slot = itr->second;
+		if (( slot->rect.size.x == (int)w ) && ( slot->rect.size.y == (int)h ))
+		{
+			if ( slot->refs == 0 )
+				m_unused.erase( slot->lru );
+
+			slot->refs++;
+			return slot;
+		}
+
+		// the file has changed size since it was last seen
+		if ( slot->refs > 0 )
+			return NULL;
+
+		m_unused.erase( slot->lru );
+		free_space( slot );
+		m_slots.erase( itr );
+		delete slot;
+	}
+
+	if ( m_page_size == 0 )
+		m_page_size = std::min( PAGE_SIZE, sf::Texture::getMaximumSize() );
+
+	unsigned int pw = w + PAD * 2;
+	unsigned int ph = h + PAD * 2;
+
+	while ( true )
+	{
+		for ( int i=0; i<(int)m_pages.size(); i++ )
+		{
+			Page &p = *m_pages[i];
+			if ( p.smooth != smooth )
+				continue;
+
+			int shelf;
+			unsigned int x, y;
+			if ( allocate( p, pw, ph, shelf, x, y ) )
+			{
+				FeAtlasSlot *slot = new FeAtlasSlot;
+				slot->key = k;
+				slot->page = i;
+				slot->shelf = shelf;
+				slot->rect = sf::IntRect( { (int)( x + PAD ), (int)( y + PAD ) }, { (int)w, (int)h } );
+				slot->refs = 1;
+				m_slots[ k ] = slot;
+				p.used++;
+				return slot;
+			}
+		}
+
+		if ( (int)m_pages.size() < MAX_PAGES )
+		{
+			std::unique_ptr<Page> p = std::make_unique<Page>();
+			if ( !p->texture.resize( { m_page_size, m_page_size } ))
+				return NULL;
+
+			p->texture.setSmooth( smooth );
+			p->smooth = smooth;
+			p->next_y = 0;
+			p->used = 0;
+			m_pages.push_back( std::move( p ));
+
+			FeDebug() << "Texture atlas: added page " << m_pages.size() << " (" << m_page_size
+				<< "x" << m_page_size << ", smooth=" << smooth << ")" << std::endl;
+			continue;
+		}
+
+		if ( !evict_one() )
+			return NULL;
+	}
+}
+
+bool FeTextureAtlas::allocate( Page &p,
+	unsigned int w,
+	unsigned int h,
+	int &shelf,
+	unsigned int &x,
+	unsigned int &y )
+{
+	//
+	// Use the shortest shelf that fits, as long as it doesn't waste too
+	// much space above the image
+	//
+	unsigned int sh = shelf_height( h );
+	unsigned int max_h = sh + sh / 4 + 4;
+
+	int best=-1;
+	size_t best_span=0;
+	for ( int i=0; i<(int)p.shelves.size(); i++ )
+	{
+		const Shelf &s = p.shelves[i];
+		if (( s.h < h ) || ( s.h > max_h ))
+			continue;
+
+		if (( best >= 0 ) && ( p.shelves[best].h <= s.h ))
+			continue;
+
+		for ( size_t j=0; j<s.free.size(); j++ )
+		{
+			if ( s.free[j].w >= w )
+			{
+				best = i;
+				best_span = j;
+				break;
+			}
+		}
+	}
+
+	if ( best < 0 )
+	{
+		if ( p.next_y + sh > m_page_size )
+			return false;
+
+		Shelf s;
+		s.y = p.next_y;
+		s.h = sh;
+		s.free.push_back( { 0, m_page_size } );
+		p.shelves.push_back( s );
+		p.next_y += sh;
+
+		best = p.shelves.size() - 1;
+		best_span = 0;
+	}
+
+	Shelf &s = p.shelves[best];
+	Span &span = s.free[best_span];
+
+	shelf = best;
+	x = span.x;
+	y = s.y;
+
+	span.x += w;
+	span.w -= w;
+	if ( span.w == 0 )
+		s.free.erase( s.free.begin() + best_span );
+
+	return true;
+}
+
+void FeTextureAtlas::free_space( FeAtlasSlot *slot )
+{
+	Page &p = *m_pages[ slot->page ];
+	Shelf &s = p.shelves[ slot->shelf ];
+
+	Span n = { (unsigned int)slot->rect.position.x - PAD, (unsigned int)slot->rect.size.x + PAD * 2 };
+
+	std::vector<Span>::iterator itr = s.free.begin();
+	while (( itr != s.free.end() ) && ( (*itr).x < n.x ))
+		++itr;
+
+	itr = s.free.insert( itr, n );
+
+	// merge with the following span, then the preceding one
+	if (( itr + 1 != s.free.end() ) && ( (*itr).x + (*itr).w == (*( itr + 1 )).x ))
+	{
+		(*itr).w += (*( itr + 1 )).w;
+		s.free.erase( itr + 1 );
+	}
+
+	if (( itr != s.free.begin() ) && ( (*( itr - 1 )).x + (*( itr - 1 )).w == (*itr).x ))
+	{
+		(*( itr - 1 )).w += (*itr).w;
+		s.free.erase( itr );
+	}
+
+	p.used--;
+
+	// give empty shelves at the bottom of the page back
+	while ( !p.shelves.empty() )
+	{
+		const Shelf &last = p.shelves.back();
+		if (( last.free.size() != 1 ) || ( last.free[0].w != m_page_size ))
+			break;
+
+		p.next_y = last.y;
+		p.shelves.pop_back();
+	}
+}
+
+bool FeTextureAtlas::evict_one()
+{
+	if ( m_unused.empty() )
+		return false;
+
+	//
+	// Prefer an image that is no longer in the image loader's cache, since it
+	// is the least likely to be shown again soon
+	//
+	FeImageLoader &il = FeImageLoader::get_ref();
+	std::list< FeAtlasSlot * >::iterator victim = --m_unused.end();
+
+	std::list< FeAtlasSlot * >::iterator itr = victim;
+	for ( int i=0; i<EVICT_SCAN; i++ )
+	{
+		const std::string &k = (*itr)->key;
+		if ( !il.image_in_cache( k.substr( 0, k.size() - 2 ) ))
+		{
+			victim = itr;
+			break;
+		}
+
+		if ( itr == m_unused.begin() )
+			break;
+
+		--itr;
+	}
+
+	FeAtlasSlot *slot = *victim;
+	m_unused.erase( victim );
+
+	free_space( slot );
+	m_slots.erase( slot->key );
+	delete slot;
+
+	return true;
+}
+
+void FeTextureAtlas::release( FeAtlasSlot *slot )
+{
+	if ( !slot || ( slot->refs <= 0 ))
+		return;
+
+	slot->refs--;
+	if ( slot->refs > 0 )
+		return;
+
+	if ( !slot->loaded )
+	{
+		// never received its pixels, so there is nothing worth keeping
+		free_space( slot );
+		m_slots.erase( slot->key );
+		delete slot;
+		return;
+	}
+
+	m_unused.push_front( slot );
+	slot->lru = m_unused.begin();
+}
+
+void FeTextureAtlas::update( FeAtlasSlot *slot, const unsigned char *pixels )
+{
+	if ( !slot || !pixels )
+		return;
+
+	unsigned int w = slot->rect.size.x;
+	unsigned int h = slot->rect.size.y;
+	unsigned int pw = w + PAD * 2;
+	unsigned int ph = h + PAD * 2;
+
+	g_scratch.resize( pw * ph * 4 );
+
+	for ( unsigned int y=0; y<ph; y++ )
+	{
+		unsigned int sy = std::min( h - 1, ( y > PAD ) ? y - PAD : 0 );
+		const std::uint8_t *src = pixels + sy * w * 4;
+		std::uint8_t *dst = g_scratch.data() + y * pw * 4;
+
+		memcpy( dst + PAD * 4, src, w * 4 );
+		for ( unsigned int i=0; i<PAD; i++ )
+		{
+			memcpy( dst + i * 4, src, 4 );
+			memcpy( dst + ( pw - 1 - i ) * 4, src + ( w - 1 ) * 4, 4 );
+		}
+	}
+
+	m_pages[ slot->page ]->texture.update( g_scratch.data(), { pw, ph },
+		{ (unsigned int)slot->rect.position.x - PAD, (unsigned int)slot->rect.position.y - PAD } );
+
+	slot->loaded = true;
+}
+
+const sf::Texture &FeTextureAtlas::get_texture( const FeAtlasSlot *slot ) const
+{
+	return m_pages[ slot->page ]->texture;
+}
+
+void FeTextureAtlas::purge()
+{
+	while ( !m_unused.empty() )
+	{
+		FeAtlasSlot *slot = m_unused.back();
+		m_unused.pop_back();
+
+		free_space( slot );
+		m_slots.erase( slot->key );
+		delete slot;
+	}
+
+	// pages are referred to by index, so only empty pages at the end can go
+	while ( !m_pages.empty() && ( m_pages.back()->used == 0 ))
+		m_pages.pop_back();
+}
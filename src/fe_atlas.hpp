@@ -0,0 +1,129 @@
+/*
+ *
+ *  Attract-Mode Plus frontend
+ *  Copyright (C) 2025 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode Plus
+ *
+ *  Attract-Mode Plus is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode Plus is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode Plus.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FE_ATLAS_HPP
+#define FE_ATLAS_HPP
+
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/Rect.hpp>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+
+//
+// A space reserved for one image in a texture atlas page
+//
+struct FeAtlasSlot
+{
+	std::string key;
+	int page=0;
+	int shelf=0;
+	sf::IntRect rect; // the image area, not including padding
+	int refs=0;
+	bool loaded=false; // true once the pixels have been uploaded
+	std::list<FeAtlasSlot *>::iterator lru; // position in unused list when refs==0
+};
+
+//
+// Texture atlas for small images (wheel logos, icons, flags and so on).
+// Images up to the configured size are packed into shared texture pages
+// using a shelf packer, so they don't need a texture each and images drawn
+// one after another from the same page don't need a texture bind.
+//
+// Slots are reference counted.  A slot that is no longer in use keeps its
+// pixels until the space is needed, so an image that comes back into view
+// (i.e. when scrolling back and forth) doesn't need to be uploaded again.
+// Images the image loader has already dropped from its cache are evicted
+// first.
+//
+class FeTextureAtlas
+{
+public:
+	static FeTextureAtlas &get_ref();
+
+	// Images with a width or height larger than this aren't put in the
+	// atlas.  0 disables the atlas
+	static void set_max_image_size( int s );
+	static int get_max_image_size();
+
+	// Return true if an image of the given size can go in the atlas
+	static bool is_candidate( unsigned int w, unsigned int h );
+
+	//
+	// Get a slot for the image identified by key.  If the image is already in
+	// the atlas its slot is returned with loaded set, otherwise the caller
+	// needs to call update() with its pixels.  Returns NULL if there's no room.
+	//
+	FeAtlasSlot *acquire( const std::string &key, unsigned int w, unsigned int h, bool smooth );
+	void release( FeAtlasSlot *slot );
+
+	// Upload RGBA pixels for slot.  The edge pixels are repeated into the
+	// padding around the slot so smoothing doesn't pick up its neighbours
+	void update( FeAtlasSlot *slot, const unsigned char *pixels );
+
+	const sf::Texture &get_texture( const FeAtlasSlot *slot ) const;
+
+	// Drop all unused slots, and any pages left empty
+	void purge();
+
+private:
+	FeTextureAtlas();
+	FeTextureAtlas( const FeTextureAtlas & );
+	FeTextureAtlas &operator=( const FeTextureAtlas & );
+
+	struct Span
+	{
+		unsigned int x;
+		unsigned int w;
+	};
+
+	struct Shelf
+	{
+		unsigned int y;
+		unsigned int h;
+		std::vector<Span> free;
+	};
+
+	struct Page
+	{
+		sf::Texture texture;
+		bool smooth;
+		unsigned int next_y;
+		std::vector<Shelf> shelves;
+		int used;
+	};
+
+	bool allocate( Page &p, unsigned int w, unsigned int h, int &shelf, unsigned int &x, unsigned int &y );
+	void free_space( FeAtlasSlot *slot );
+	bool evict_one();
+
+	std::vector< std::unique_ptr<Page> > m_pages;
+	std::map< std::string, FeAtlasSlot * > m_slots;
+	std::list< FeAtlasSlot * > m_unused; // unused slots, most recently used first
+	unsigned int m_page_size;
+
+	static int s_max_image_size;
+};
+
+#endif
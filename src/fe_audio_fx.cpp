@@ -44,6 +44,7 @@ static constexpr float NORMALISE_DECREASE_TIME_MS = 2.0f;
 #include "fe_present.hpp"
 
 #include <SFML/Audio/PlaybackDevice.hpp>
+#include <sqstdblob.h>
 #include <algorithm>
 #include <cstring>
 #include <cstdio>
@@ -164,7 +165,11 @@ void FeAudioEffectsManager::set_ready_for_processing()
 std::vector<float> FeAudioVisualiser::m_window_lut;
 
 FeAudioVisualiser::FeAudioVisualiser()
-	: m_vu_mono_in( 0.0f ),
+	: m_snapshot_shared( 1 ),
+	m_snapshot_back( 0 ),
+	m_snapshot_front( 2 ),
+	m_snapshot_taken( false ),
+	m_vu_mono_in( 0.0f ),
 	m_vu_mono_out( 0.0f ),
 	m_vu_left_in( 0.0f ),
 	m_vu_left_out( 0.0f ),
@@ -202,6 +207,8 @@ FeAudioVisualiser::FeAudioVisualiser()
 
 	// Allocate FFT output buffer
 	m_fft_output_buffer.resize( FFT_BUFFER_SIZE / 2 + 1 );
+
+	std::memset( m_snapshots, 0, sizeof( m_snapshots ));
 }
 
 FeAudioVisualiser::~FeAudioVisualiser()
@@ -233,6 +240,15 @@ bool FeAudioVisualiser::process( const float* input_frames, float* output_frames
 	if ( !m_fft_requested && !m_vu_requested )
 		return false;
 
+	// Start accumulating afresh once update() has taken the last snapshot
+	if ( m_snapshot_taken.exchange( false ))
+	{
+		m_vu_mono_in = m_vu_left_in = m_vu_right_in = 0.0f;
+		std::fill( m_fft_mono_in.begin(), m_fft_mono_in.end(), 0.0f );
+		std::fill( m_fft_left_in.begin(), m_fft_left_in.end(), 0.0f );
+		std::fill( m_fft_right_in.begin(), m_fft_right_in.end(), 0.0f );
+	}
+
 	resample_and_buffer_audio( input_frames, frame_count, channel_count );
 
 	const size_t MIN_FFT_SIZE = 1024;
@@ -293,52 +309,52 @@ bool FeAudioVisualiser::process( const float* input_frames, float* output_frames
 		if ( computational_load > 2.0f )
 			throttle_factor = static_cast<int>( std::min( 4.0f, 1.0f + ( computational_load - 2.0f ) * 1.5f ));
 
-		if ( throttle_factor > 1 && ( fft_call_counter % throttle_factor ) != 0 )
-			return false;
+		bool throttled = ( throttle_factor > 1 && ( fft_call_counter % throttle_factor ) != 0 );
 
 		// Only process if we have enough samples
-		if ( m_buffer_samples_count < FFT_BUFFER_SIZE )
-			return false;
-
-		std::vector<float> temp_mono( FFT_BUFFER_SIZE );
-		std::vector<float> temp_left( FFT_BUFFER_SIZE );
-		std::vector<float> temp_right( FFT_BUFFER_SIZE );
-
-		for ( size_t i = 0; i < FFT_BUFFER_SIZE; ++i )
+		if ( !throttled && ( m_buffer_samples_count >= FFT_BUFFER_SIZE ))
 		{
-			size_t read_pos = ( m_buffer_write_pos + ROLLING_BUFFER_SIZE - FFT_BUFFER_SIZE + i ) % ROLLING_BUFFER_SIZE;
-			temp_mono[i] = m_rolling_buffer_mono[read_pos];
-			temp_left[i] = m_rolling_buffer_left[read_pos];
-			temp_right[i] = m_rolling_buffer_right[read_pos];
-		}
+			std::vector<float> temp_mono( FFT_BUFFER_SIZE );
+			std::vector<float> temp_left( FFT_BUFFER_SIZE );
+			std::vector<float> temp_right( FFT_BUFFER_SIZE );
 
-		// Use temporary vectors for FFT calculation to avoid race conditions
-		std::vector<float> temp_fft_mono( FFT_BANDS_MAX, 0.0f );
-		std::vector<float> temp_fft_left( FFT_BANDS_MAX, 0.0f );
-		std::vector<float> temp_fft_right( FFT_BANDS_MAX, 0.0f );
+			for ( size_t i = 0; i < FFT_BUFFER_SIZE; ++i )
+			{
+				size_t read_pos = ( m_buffer_write_pos + ROLLING_BUFFER_SIZE - FFT_BUFFER_SIZE + i ) % ROLLING_BUFFER_SIZE;
+				temp_mono[i] = m_rolling_buffer_mono[read_pos];
+				temp_left[i] = m_rolling_buffer_left[read_pos];
+				temp_right[i] = m_rolling_buffer_right[read_pos];
+			}
 
-		if ( channel_count == 1 )
-		{
-			calculate_fft_channel( temp_mono.data(), FFT_BUFFER_SIZE, temp_fft_mono, RESAMPLE_RATE );
+			// Use temporary vectors for FFT calculation to avoid race conditions
+			std::vector<float> temp_fft_mono( FFT_BANDS_MAX, 0.0f );
+			std::vector<float> temp_fft_left( FFT_BANDS_MAX, 0.0f );
+			std::vector<float> temp_fft_right( FFT_BANDS_MAX, 0.0f );
 
-			std::copy( temp_fft_mono.begin(), temp_fft_mono.begin() + m_fft_bands, m_fft_mono_in.begin() );
-			std::copy( temp_fft_mono.begin(), temp_fft_mono.begin() + m_fft_bands, m_fft_left_in.begin() );
-			std::copy( temp_fft_mono.begin(), temp_fft_mono.begin() + m_fft_bands, m_fft_right_in.begin() );
-		}
-		else
-		{
-			calculate_fft_channel( temp_left.data(), FFT_BUFFER_SIZE, temp_fft_left, RESAMPLE_RATE );
-			calculate_fft_channel( temp_right.data(), FFT_BUFFER_SIZE, temp_fft_right, RESAMPLE_RATE );
+			if ( channel_count == 1 )
+			{
+				calculate_fft_channel( temp_mono.data(), FFT_BUFFER_SIZE, temp_fft_mono, RESAMPLE_RATE );
 
-			for ( int i = 0; i < m_fft_bands; ++i )
-				temp_fft_mono[i] = ( temp_fft_left[i] + temp_fft_right[i] ) * 0.5f;
+				std::copy( temp_fft_mono.begin(), temp_fft_mono.begin() + m_fft_bands, m_fft_mono_in.begin() );
+				std::copy( temp_fft_mono.begin(), temp_fft_mono.begin() + m_fft_bands, m_fft_left_in.begin() );
+				std::copy( temp_fft_mono.begin(), temp_fft_mono.begin() + m_fft_bands, m_fft_right_in.begin() );
+			}
+			else
+			{
+				calculate_fft_channel( temp_left.data(), FFT_BUFFER_SIZE, temp_fft_left, RESAMPLE_RATE );
+				calculate_fft_channel( temp_right.data(), FFT_BUFFER_SIZE, temp_fft_right, RESAMPLE_RATE );
 
-			std::copy( temp_fft_left.begin(), temp_fft_left.begin() + m_fft_bands, m_fft_left_in.begin() );
-			std::copy( temp_fft_right.begin(), temp_fft_right.begin() + m_fft_bands, m_fft_right_in.begin() );
-			std::copy( temp_fft_mono.begin(), temp_fft_mono.begin() + m_fft_bands, m_fft_mono_in.begin() );
+				for ( int i = 0; i < m_fft_bands; ++i )
+					temp_fft_mono[i] = ( temp_fft_left[i] + temp_fft_right[i] ) * 0.5f;
+
+				std::copy( temp_fft_left.begin(), temp_fft_left.begin() + m_fft_bands, m_fft_left_in.begin() );
+				std::copy( temp_fft_right.begin(), temp_fft_right.begin() + m_fft_bands, m_fft_right_in.begin() );
+				std::copy( temp_fft_mono.begin(), temp_fft_mono.begin() + m_fft_bands, m_fft_mono_in.begin() );
+			}
 		}
 	}
 
+	publish_snapshot();
 	return false;
 }
 
@@ -369,8 +385,139 @@ void FeAudioVisualiser::reset()
 
 void FeAudioVisualiser::update()
 {
-	std::lock_guard<std::mutex> lock( m_mutex );
-	update_fall();
+	// Let go of a texture nothing holds any more, so analysis can stop
+	if ( m_texture && ( m_texture.use_count() == 1 ))
+		m_texture.reset();
+
+	update_fall( take_snapshot() );
+
+	if ( m_texture )
+		update_texture();
+}
+
+//
+// Audio thread: copy the accumulated values into the back snapshot and swap
+// it with the shared one
+//
+void FeAudioVisualiser::publish_snapshot()
+{
+	Snapshot &snap = m_snapshots[ m_snapshot_back ];
+	snap.vu[0] = m_vu_mono_in;
+	snap.vu[1] = m_vu_left_in;
+	snap.vu[2] = m_vu_right_in;
+	std::copy( m_fft_mono_in.begin(), m_fft_mono_in.end(), snap.fft[0] );
+	std::copy( m_fft_left_in.begin(), m_fft_left_in.end(), snap.fft[1] );
+	std::copy( m_fft_right_in.begin(), m_fft_right_in.end(), snap.fft[2] );
+
+	int prev = m_snapshot_shared.exchange( m_snapshot_back | SNAPSHOT_FRESH, std::memory_order_acq_rel );
+	m_snapshot_back = prev & ~SNAPSHOT_FRESH;
+}
+
+//
+// Main thread: swap the front snapshot for the shared one if a new one has
+// been published since the last call
+//
+bool FeAudioVisualiser::take_snapshot()
+{
+	if ( !( m_snapshot_shared.load( std::memory_order_acquire ) & SNAPSHOT_FRESH ))
+		return false;
+
+	int prev = m_snapshot_shared.exchange( m_snapshot_front, std::memory_order_acq_rel );
+	m_snapshot_front = prev & ~SNAPSHOT_FRESH;
+	m_snapshot_taken = true;
+	return true;
+}
+
+std::shared_ptr<const sf::Texture> FeAudioVisualiser::get_texture()
+{
+	if ( !m_texture )
+	{
+		m_texture = std::make_shared<sf::Texture>();
+		update_texture();
+	}
+
+	m_vu_requested = true;
+	m_fft_requested = true;
+	return m_texture;
+}
+
+void FeAudioVisualiser::update_texture()
+{
+	const unsigned int rows = 6;
+	std::vector<std::uint8_t> pixels( m_fft_bands * rows * 4, 255 );
+
+	const std::vector<float> *fft[3] = { &m_fft_mono_out, &m_fft_left_out, &m_fft_right_out };
+	const float vu[3] = { m_vu_mono_out, m_vu_left_out, m_vu_right_out };
+
+	for ( unsigned int row = 0; row < rows; row++ )
+	{
+		for ( int i = 0; i < m_fft_bands; i++ )
+		{
+			float v = ( row < 3 ) ? (*fft[row])[i] : vu[row - 3];
+			std::uint8_t c = static_cast<std::uint8_t>( std::max( 0.0f, std::min( 1.0f, v )) * 255.0f + 0.5f );
+			std::uint8_t *p = &pixels[( row * m_fft_bands + i ) * 4];
+			p[0] = p[1] = p[2] = c;
+		}
+	}
+
+	if ( m_texture->getSize() != sf::Vector2u( m_fft_bands, rows ))
+	{
+		if ( !m_texture->resize({ static_cast<unsigned int>( m_fft_bands ), rows }))
+			return;
+
+		m_texture_pixels.clear();
+	}
+
+	if ( pixels != m_texture_pixels )
+	{
+		m_texture->update( pixels.data() );
+		m_texture_pixels.swap( pixels );
+		FePresent::script_flag_redraw();
+	}
+}
+
+SQInteger FeAudioVisualiser::script_copy_fft( HSQUIRRELVM vm, SQInteger idx, int channel ) const
+{
+	const std::vector<float> *src = get_fft_mono_ptr();
+	if ( channel == 1 )
+		src = get_fft_left_ptr();
+	else if ( channel == 2 )
+		src = get_fft_right_ptr();
+
+	const int count = m_fft_bands;
+
+	if ( sq_gettype( vm, idx ) == OT_ARRAY )
+	{
+		if ( sq_getsize( vm, idx ) != count )
+		{
+			sq_push( vm, idx );
+			sq_arrayresize( vm, -1, count );
+			sq_pop( vm, 1 );
+		}
+
+		sq_push( vm, idx );
+		for ( int i = 0; i < count; i++ )
+		{
+			sq_pushinteger( vm, i );
+			sq_pushfloat( vm, (*src)[i] );
+			sq_set( vm, -3 );
+		}
+		sq_pop( vm, 1 );
+	}
+	else
+	{
+		SQUserPointer data = NULL;
+		if ( SQ_FAILED( sqstd_getblob( vm, idx, &data )))
+			return sq_throwerror( vm, _SC("fft_copy() target must be an array or blob") );
+
+		if ( sqstd_getblobsize( vm, idx ) < (SQInteger)( count * sizeof( float )))
+			return sq_throwerror( vm, _SC("fft_copy() blob is smaller than fft_bands floats") );
+
+		std::memcpy( data, src->data(), count * sizeof( float ));
+	}
+
+	sq_pushinteger( vm, count );
+	return 1;
 }
 
 float FeAudioVisualiser::get_vu_mono() const
@@ -620,7 +767,7 @@ bool FeAudioVisualiser::resample_and_buffer_audio( const float* input_frames, un
 	return ( m_buffer_samples_count >= FFT_BUFFER_SIZE && samples_added > 0 );
 }
 
-void FeAudioVisualiser::update_fall() const
+void FeAudioVisualiser::update_fall( bool fresh ) const
 {
 	sf::Time current_time =  sf::Time::Zero;
 	float frame_time = 0.0;
@@ -642,36 +789,32 @@ void FeAudioVisualiser::update_fall() const
 		else output_value = std::max( input_value, std::max( 0.0f, output_value - fall_amount ));
 	};
 
-	apply_vu_fall( m_vu_mono_in, m_vu_mono_out, vu_fall_amount );
-	apply_vu_fall( m_vu_left_in, m_vu_left_out, vu_fall_amount );
-	apply_vu_fall( m_vu_right_in, m_vu_right_out, vu_fall_amount );
+	// Without a new snapshot everything falls towards zero
+	static const Snapshot zero = {};
+	const Snapshot &snap = fresh ? m_snapshots[ m_snapshot_front ] : zero;
 
-	m_vu_mono_in = 0.0f;
-	m_vu_left_in = 0.0f;
-	m_vu_right_in = 0.0f;
+	apply_vu_fall( snap.vu[0], m_vu_mono_out, vu_fall_amount );
+	apply_vu_fall( snap.vu[1], m_vu_left_out, vu_fall_amount );
+	apply_vu_fall( snap.vu[2], m_vu_right_out, vu_fall_amount );
 
 	// Clear flags if 100ms has passed since last request
 	const float REQUEST_TIMEOUT_MS = 100.0f;
 	float vu_time_since_request = ( current_time - m_vu_request_time ).asMilliseconds();
 	float fft_time_since_request = ( current_time - m_fft_request_time ).asMilliseconds();
 
-	if ( vu_time_since_request > REQUEST_TIMEOUT_MS )
+	// A texture someone holds keeps analysis running
+	if (( vu_time_since_request > REQUEST_TIMEOUT_MS ) && !m_texture )
 		m_vu_requested = false;
 
-	if ( fft_time_since_request > REQUEST_TIMEOUT_MS )
+	if (( fft_time_since_request > REQUEST_TIMEOUT_MS ) && !m_texture )
 		m_fft_requested = false;
 
 	for ( int i = 0; i < m_fft_bands; ++i )
 	{
-		apply_vu_fall( m_fft_mono_in[i], m_fft_mono_out[i], fft_fall_amount );
-		apply_vu_fall( m_fft_left_in[i], m_fft_left_out[i], fft_fall_amount );
-		apply_vu_fall( m_fft_right_in[i], m_fft_right_out[i], fft_fall_amount );
+		apply_vu_fall( snap.fft[0][i], m_fft_mono_out[i], fft_fall_amount );
+		apply_vu_fall( snap.fft[1][i], m_fft_left_out[i], fft_fall_amount );
+		apply_vu_fall( snap.fft[2][i], m_fft_right_out[i], fft_fall_amount );
 	}
-
-	// Reset FFT input values so they can fall properly when no audio is present
-	m_fft_mono_in.assign( m_fft_bands, 0.0f );
-	m_fft_left_in.assign( m_fft_bands, 0.0f );
-	m_fft_right_in.assign( m_fft_bands, 0.0f );
 }
 
 FeAudioNormaliser::FeAudioNormaliser()
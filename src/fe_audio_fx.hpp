@@ -24,6 +24,7 @@
 #define FE_AUDIO_FX_HPP
 
 #include <SFML/System.hpp>
+#include <SFML/Graphics/Texture.hpp>
 #include <vector>
 #include <memory>
 #include <mutex>
@@ -129,12 +130,51 @@ public:
 	void set_fft_bands( int count );
 	int get_fft_bands() const { return m_fft_bands; }
 
+	// Copy the current bands of a channel (0=mono, 1=left, 2=right) into the
+	// squirrel array or blob at idx.  Returns the band count to squirrel.
+	SQInteger script_copy_fft( HSQUIRRELVM vm, SQInteger idx, int channel ) const;
+
+	// Texture holding the current values for use in shaders, one texel per
+	// band.  Rows are mono, left and right fft, then mono, left and right vu.
+	// Created on first use.  Analysis stays on while a caller holds on to it,
+	// once none do the texture is dropped by the next update()
+	std::shared_ptr<const sf::Texture> get_texture();
+
 private:
 	static void initialise_window_lut();
 
+	//
+	// Results of each audio block are handed from the audio thread to update()
+	// without locking.  Each side owns one snapshot and swaps it with the
+	// shared one, the FRESH bit flagging a snapshot update() hasn't taken.
+	//
+	struct Snapshot
+	{
+		float vu[3];
+		float fft[3][FFT_BANDS_MAX];
+	};
+
+	static constexpr int SNAPSHOT_FRESH = 4;
+
+	Snapshot m_snapshots[3];
+	std::atomic<int> m_snapshot_shared;
+	int m_snapshot_back; // audio thread
+	int m_snapshot_front; // main thread
+	std::atomic<bool> m_snapshot_taken;
+
+	void publish_snapshot();
+	bool take_snapshot();
+	void update_texture();
+
+	std::shared_ptr<sf::Texture> m_texture;
+	std::vector<std::uint8_t> m_texture_pixels;
+
+	// Guards the rolling buffers and the audio thread's accumulated values
 	mutable std::mutex m_mutex;
 
 	// VU meter data
+	// - The _in values accumulate on the audio thread until a snapshot is taken
+	// - The _out values are owned by the main thread
 	mutable float m_vu_mono_in;
 	mutable float m_vu_mono_out;
 	mutable float m_vu_left_in;
@@ -152,8 +192,8 @@ private:
 
 	mutable sf::Time m_last_frame_time;
 	mutable sf::Clock m_system_clock;
-	mutable bool m_vu_requested;
-	mutable bool m_fft_requested;
+	mutable std::atomic<bool> m_vu_requested;
+	mutable std::atomic<bool> m_fft_requested;
 	mutable sf::Time m_vu_request_time;
 	mutable sf::Time m_fft_request_time;
 	int m_fft_bands;
@@ -174,7 +214,7 @@ private:
 
 	void calculate_fft_channel( const float *samples , unsigned int sample_count ,
 	                            std::vector<float> &fft_bands , float sample_rate ) const;
-	void update_fall() const;
+	void update_fall( bool fresh ) const;
 	float convert_to_log_scale( float linear_value, float amplitude_linearity ) const;
 	bool resample_and_buffer_audio( const float* input_frames, unsigned int input_frame_count,
 	                                unsigned int frame_channel_count );
@@ -83,6 +83,7 @@ namespace {
 #endif
 	enum FeLogLevel g_log_level=FeLog_Info;
 	std::mutex g_log_mutex;
+	thread_local std::ostream *g_log_capture=NULL;
 
 #ifndef NO_MOVIE
 	void ffmpeg_log_callback( void *ptr, int level, const char *fmt, va_list vargs )
@@ -110,6 +111,9 @@ std::ostream &FeLog()
 	if ( g_log_level == FeLog_Silent )
 		return g_nullstream;
 
+	if ( g_log_capture )
+		return *g_log_capture;
+
 	if ( g_logfile.is_open() )
 		return g_logfile;
 	else
@@ -134,6 +138,17 @@ void fe_log_threadsafe( const std::string &msg )
 }
 
 
+FeLogCapture::FeLogCapture()
+	: m_prev( g_log_capture )
+{
+	g_log_capture = &m_buff;
+}
+
+FeLogCapture::~FeLogCapture()
+{
+	g_log_capture = m_prev;
+}
+
 void fe_set_log_level( enum FeLogLevel f )
 {
 	g_log_level = f;
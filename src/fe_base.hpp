@@ -25,6 +25,7 @@
 
 #include <string>
 #include <ostream>
+#include <sstream>
 #include <cstdint>
 
 extern const char *FE_NAME;
@@ -73,6 +74,27 @@ void fe_print_version();
 const char *fe_get_log_level_string();
 void fe_log_threadsafe( const std::string & );
 
+//
+// While one of these exists, FeLog() and FeDebug() output from the thread
+// that created it is collected here instead of being written out, so that
+// a worker thread's log can be passed back and written by the main thread
+//
+class FeLogCapture
+{
+public:
+	FeLogCapture();
+	~FeLogCapture();
+
+	std::string str() const { return m_buff.str(); }
+
+private:
+	FeLogCapture( const FeLogCapture & );
+	FeLogCapture &operator=( const FeLogCapture & );
+
+	std::ostringstream m_buff;
+	std::ostream *m_prev;
+};
+
 class FeBaseConfigurable
 {
 protected:
@@ -0,0 +1,556 @@
+/*
+ *
+ *  Attract-Mode Plus frontend
+ *  Copyright (C) 2025 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode Plus
+ *
+ *  Attract-Mode Plus is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode Plus is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode Plus.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+//
+// Micro-benchmarks for the romlist, filter, cache and text hot paths.
+// Built as a separate program with "make bench".
+//
+// A synthetic romlist (100000 entries by default), a display with a set of
+// representative filters, an artwork directory and a zip archive are
+// generated into a scratch config directory from a fixed seed, so that
+// results can be compared between builds and machines.  Each case is then
+// run a number of times and the min/median/max times are reported.
+//
+#include "fe_settings.hpp"
+#include "fe_romlist.hpp"
+#include "fe_cache.hpp"
+#include "fe_util.hpp"
+#include "path_cache.hpp"
+#include "zip.hpp"
+
+#ifndef USE_LIBARCHIVE
+#include "miniz.h"
+#endif
+
+#include "nowide/args.hpp"
+#include "nowide/fstream.hpp"
+
+#include <SFML/System/Clock.hpp>
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <algorithm>
+#include <random>
+#include <cstring>
+
+namespace
+{
+	const unsigned int SEED = 20250401;
+	const int DEFAULT_ROMS = 100000;
+	const int DEFAULT_RUNS = 5;
+	const char *DEFAULT_DIR = "./";
+
+	// Generated data goes in this subdirectory of --dir, which is marked with
+	// MARKER_FILE so that we never delete a directory we didn't create
+	const char *DATA_SUBDIR = "attractplus-bench-data/";
+	const char *MARKER_FILE = ".attractplus-bench";
+
+	const char *ROMLIST_NAME = "bench";
+	const int ARTWORK_EVERY = 20; // one artwork file per this many roms
+	const int ZIP_ENTRIES = 32;
+	const size_t ZIP_ENTRY_SIZE = 256 * 1024;
+
+	const char *WORDS[] =
+	{
+		"Space", "Dragon", "Galaxy", "Ninja", "Street", "Thunder", "Metal", "Star",
+		"Turbo", "Shadow", "Final", "Super", "Mega", "Power", "Cyber", "Crystal",
+		"Night", "Legend", "Fighter", "Force", "Racer", "Warrior", "Quest", "Blaster",
+		"Castle", "Jungle", "Ocean", "Robot", "Tiger", "Phoenix", "Storm", "Rally",
+		"Knight", "Wizard", "Pirate", "Rocket", "Zone", "Strike", "Hero", "Fury",
+		"Bubble", "Puzzle", "Pinball", "Soccer", "Boxing", "Golf", "Hunter", "Raider",
+		"Alpha", "Omega", "Delta", "Sigma", "Gold", "Silver", "Iron", "Steel",
+		"Blade", "Arrow", "Comet", "Meteor", "Nova", "Orbit", "Pulse", "Vector"
+	};
+
+	const char *MANUFACTURERS[] =
+	{
+		"Atari", "Capcom", "Konami", "Namco", "Nintendo", "Sega", "SNK", "Taito",
+		"Irem", "Data East", "Midway", "Williams", "Technos", "Jaleco", "Toaplan", "Cave",
+		"Psikyo", "Video System", "Kaneko", "Nichibutsu", "Universal", "Gottlieb", "Stern", "Bally"
+	};
+
+	const char *CATEGORIES[] =
+	{
+		"Shooter / Flying Vertical", "Shooter / Flying Horizontal", "Shooter / Gallery",
+		"Fighter / Versus", "Fighter / 2.5D", "Platform / Run Jump", "Platform / Shooter",
+		"Maze / Collect", "Maze / Digging", "Driving / Race", "Driving / Race 1st Person",
+		"Sports / Soccer", "Sports / Golf", "Sports / Boxing", "Puzzle / Drop",
+		"Puzzle / Match", "Beat'em Up", "Ball & Paddle / Breakout", "Climbing", "Casino / Cards"
+	};
+
+	const char *REGIONS[] = { "World", "USA", "Japan", "Europe", "Asia", "Korea" };
+	const char *STATUSES[] = { "good", "good", "good", "imperfect", "preliminary" };
+	const char *CONTROLS[] = { "joystick", "joystick,joystick", "dial", "trackball", "lightgun", "paddle" };
+
+	template <typename T, size_t N>
+	const char *pick( T (&list)[N], unsigned int r )
+	{
+		return list[ r % N ];
+	}
+
+	//
+	// The filters a typical display might use: plain lists, sorted lists,
+	// substring and regular expression rules, exceptions, and limits
+	//
+	const char *DISPLAY_CFG =
+		"display\tbench\n"
+		"\tlayout\tBasic\n"
+		"\tromlist\tbench\n"
+		"\tin_cycle\tyes\n"
+		"\tin_menu\tyes\n"
+		"\tfilter\tAll\n"
+		"\tfilter\tBy Title\n"
+		"\t\tsort_by\tTitle\n"
+		"\tfilter\tEighties\n"
+		"\t\trule\tYear contains 198\n"
+		"\t\tsort_by\tYear\n"
+		"\tfilter\tShooters\n"
+		"\t\trule\tCategory contains Shooter\n"
+		"\t\trule\tPlayers greater_than 1\n"
+		"\t\tsort_by\tManufacturer\n"
+		"\tfilter\tParents\n"
+		"\t\trule\tCloneOf equals ^$\n"
+		"\t\texception\tStatus equals preliminary\n"
+		"\tfilter\tCapcom Konami\n"
+		"\t\trule\tManufacturer equals Capcom|Konami\n"
+		"\t\trule\tTitle not_contains Soccer\n"
+		"\t\tsort_by\tTitle\n"
+		"\t\treverse_order\tyes\n"
+		"\tfilter\tLatest\n"
+		"\t\tsort_by\tYear\n"
+		"\t\treverse_order\tyes\n"
+		"\t\tlist_limit\t500\n";
+
+	// The kind of strings layouts show with their text objects
+	const char *SUBST_TEXT = "[Title] ([Year]) [Manufacturer] - [Category] - [ListEntry]/[ListSize] [Players]P [!nonexistent]";
+
+	struct Result
+	{
+		std::string name;
+		std::vector<double> ms;
+	};
+
+	double elapsed_ms( const sf::Clock &c )
+	{
+		return c.getElapsedTime().asMicroseconds() / 1000.0;
+	}
+
+	//
+	// Time "runs" calls of body.  setup is called before each run but
+	// isn't timed
+	//
+	void run_case( const std::string &name,
+		int runs,
+		const std::function<void()> &body,
+		const std::function<void()> &setup = std::function<void()>() )
+	{
+		Result r;
+		r.name = name;
+
+		for ( int i=0; i<runs; i++ )
+		{
+			if ( setup )
+				setup();
+
+			sf::Clock c;
+			body();
+			r.ms.push_back( elapsed_ms( c ));
+		}
+
+		std::sort( r.ms.begin(), r.ms.end() );
+
+		std::cout << std::left << std::setw( 32 ) << r.name << std::right
+			<< std::setw( 6 ) << r.ms.size()
+			<< std::fixed << std::setprecision( 2 )
+			<< std::setw( 12 ) << r.ms.front()
+			<< std::setw( 12 ) << r.ms[ r.ms.size() / 2 ]
+			<< std::setw( 12 ) << r.ms.back() << std::endl;
+	}
+
+	//
+	// Write the synthetic romlist.  About a quarter of the entries are
+	// clones of the entry before them
+	//
+	bool generate_romlist( const std::string &filename, int count )
+	{
+		nowide::ofstream f( filename.c_str(), std::ios::binary );
+		if ( !f.is_open() )
+			return false;
+
+		std::mt19937 rng( SEED );
+
+		f << "#Name;Title;Emulator;CloneOf;Year;Manufacturer;Category;Players;Rotation;Control;Status;"
+			<< "DisplayCount;DisplayType;AltRomname;AltTitle;Extra;Buttons;Series;Language;Region;Rating\n";
+
+		std::string parent, parent_title;
+		for ( int i=0; i<count; i++ )
+		{
+			std::string name = "rom" + as_str( i );
+			std::string title;
+			bool clone = !parent.empty() && ( rng() % 4 == 0 );
+
+			if ( clone )
+			{
+				title = parent_title + " (" + pick( REGIONS, rng() ) + ", set " + as_str( i % 7 ) + ")";
+			}
+			else
+			{
+				if ( rng() % 8 == 0 )
+					title = "The ";
+
+				int words = 2 + rng() % 3;
+				for ( int j=0; j<words; j++ )
+				{
+					if ( j ) title += " ";
+					title += pick( WORDS, rng() );
+				}
+
+				if ( rng() % 3 == 0 )
+					title += " " + as_str( (int)( 2 + rng() % 4 ));
+
+				parent = name;
+				parent_title = title;
+			}
+
+			unsigned int year = 1975 + rng() % 30;
+
+			f << name
+				<< ";" << title
+				<< ";" << ROMLIST_NAME
+				<< ";" << ( clone ? parent : "" )
+				<< ";" << (( rng() % 20 == 0 ) ? as_str( (int)( year / 10 )) + "?" : as_str( (int)year ))
+				<< ";" << pick( MANUFACTURERS, rng() )
+				<< ";" << pick( CATEGORIES, rng() )
+				<< ";" << 1 + rng() % 4
+				<< ";" << (( rng() % 4 == 0 ) ? "270" : "0")
+				<< ";" << pick( CONTROLS, rng() )
+				<< ";" << pick( STATUSES, rng() )
+				<< ";1"
+				<< ";" << (( rng() % 10 == 0 ) ? "vector" : "raster")
+				<< ";;;"
+				<< ";" << 1 + rng() % 6
+				<< ";"
+				<< ";English"
+				<< ";" << pick( REGIONS, rng() )
+				<< ";" << rng() % 11
+				<< "\n";
+		}
+
+		return true;
+	}
+
+	bool generate_config( const std::string &dir )
+	{
+		confirm_directory( dir, FE_CFG_SUBDIR );
+
+		nowide::ofstream f( ( dir + FE_CFG_SUBDIR + FE_CFG_FILE ).c_str() );
+		if ( !f.is_open() )
+			return false;
+
+		f << DISPLAY_CFG;
+		return true;
+	}
+
+	// Empty artwork files named after some of the roms
+	void generate_artwork( const std::string &path, int count )
+	{
+		confirm_directory( path, "" );
+		for ( int i=0; i<count; i+=ARTWORK_EVERY )
+			write_file_content( path + "rom" + as_str( i ) + ".png", "" );
+	}
+
+	//
+	// Zip archive of slices of the romlist, which compresses about as well
+	// as the text files layouts keep in archives
+	//
+	bool generate_zip( const std::string &filename, const std::string &romlist )
+	{
+#ifdef USE_LIBARCHIVE
+		return false;
+#else
+		std::string content;
+		if ( !read_file_content( romlist, content ) || content.empty() )
+			return false;
+
+		mz_zip_archive zip;
+		memset( &zip, 0, sizeof( zip ));
+
+		if ( !mz_zip_writer_init_file( &zip, filename.c_str(), 0 ))
+			return false;
+
+		bool ok = true;
+		for ( int i=0; ok && ( i<ZIP_ENTRIES ); i++ )
+		{
+			size_t start = ( i * ZIP_ENTRY_SIZE ) % content.size();
+			size_t len = std::min( ZIP_ENTRY_SIZE, content.size() - start );
+
+			std::string entry = "entry" + as_str( i ) + ".txt";
+			ok = mz_zip_writer_add_mem( &zip, entry.c_str(), content.data() + start, len, MZ_DEFAULT_COMPRESSION );
+		}
+
+		ok = mz_zip_writer_finalize_archive( &zip ) && ok;
+		mz_zip_writer_end( &zip );
+		return ok;
+#endif
+	}
+
+	//
+	// Create an empty data directory, replacing one left by an earlier run.
+	// Returns false if the directory exists with contents we didn't write
+	//
+	bool prepare_data_dir( const std::string &data_dir )
+	{
+		if ( directory_exists( data_dir ))
+		{
+			if ( file_exists( data_dir + MARKER_FILE ))
+				delete_dir( data_dir );
+			else
+			{
+				std::vector<std::string> files, dummy;
+				get_filename_from_base( files, dummy, data_dir, "", NULL );
+				if ( !files.empty() )
+					return false;
+			}
+		}
+
+		confirm_directory( data_dir, FE_ROMLIST_SUBDIR );
+		return write_file_content( data_dir + MARKER_FILE, "attractplus-bench data directory\n" );
+	}
+
+	void clear_cache( const std::string &dir )
+	{
+		delete_dir( dir + FE_CACHE_SUBDIR );
+		confirm_directory( dir, FE_CACHE_SUBDIR );
+	}
+
+	void print_usage()
+	{
+		std::cout << "Usage: attractplus-bench [--roms <count>] [--runs <count>] [--dir <path>] [--keep] [--loglevel <level>]" << std::endl
+			<< std::endl
+			<< "  --roms <count>     Number of roms in the synthetic romlist (default: " << DEFAULT_ROMS << ")" << std::endl
+			<< "  --runs <count>     Number of times each case is run (default: " << DEFAULT_RUNS << ")" << std::endl
+			<< "  --dir <path>       Generate data in <path>/" << DATA_SUBDIR << " (default: " << DEFAULT_DIR << ")" << std::endl
+			<< "  --keep             Don't delete the generated data when done" << std::endl
+			<< "  --loglevel <level> Frontend log level: silent, info or debug (default: silent)" << std::endl;
+	}
+};
+
+int main( int argc, char *argv[] )
+{
+	nowide::args a( argc, argv );
+
+	int roms = DEFAULT_ROMS;
+	int runs = DEFAULT_RUNS;
+	std::string dir = DEFAULT_DIR;
+	bool keep = false;
+	FeLogLevel log_level = FeLog_Silent;
+
+	for ( int i=1; i<argc; i++ )
+	{
+		bool has_val = ( i + 1 < argc );
+
+		if (( strcmp( argv[i], "--roms" ) == 0 ) && has_val )
+			roms = std::max( 1, as_int( argv[++i] ));
+		else if (( strcmp( argv[i], "--runs" ) == 0 ) && has_val )
+			runs = std::max( 1, as_int( argv[++i] ));
+		else if (( strcmp( argv[i], "--dir" ) == 0 ) && has_val )
+			dir = argv[++i];
+		else if ( strcmp( argv[i], "--keep" ) == 0 )
+			keep = true;
+		else if (( strcmp( argv[i], "--loglevel" ) == 0 ) && has_val )
+		{
+			std::string l = argv[++i];
+			log_level = ( l == "debug" ) ? FeLog_Debug : (( l == "info" ) ? FeLog_Info : FeLog_Silent );
+		}
+		else
+		{
+			print_usage();
+			return ( strcmp( argv[i], "--help" ) == 0 ) ? 0 : 1;
+		}
+	}
+
+	fe_set_log_level( log_level );
+
+	dir = absolute_path( clean_path( dir, true ));
+	if ( dir.empty() || ( dir[ dir.size() - 1 ] != '/' ))
+		dir += '/';
+
+	confirm_directory( dir, "" );
+	dir += DATA_SUBDIR;
+
+	if ( !prepare_data_dir( dir ))
+	{
+		std::cout << "Not using non-empty directory that wasn't created by this tool: " << dir << std::endl;
+		return 1;
+	}
+
+	const std::string romlist_file = dir + FE_ROMLIST_SUBDIR + ROMLIST_NAME + FE_ROMLIST_FILE_EXTENSION;
+	const std::string artwork_path = dir + "artwork/";
+	const std::string zip_file = dir + "bench.zip";
+
+	std::cout << "Attract-Mode Plus " << FE_VERSION << " benchmarks" << std::endl
+		<< roms << " roms, " << runs << " runs per case, data in: " << dir << std::endl << std::endl;
+
+	std::cout << std::left << std::setw( 32 ) << "case" << std::right
+		<< std::setw( 6 ) << "runs"
+		<< std::setw( 12 ) << "min ms"
+		<< std::setw( 12 ) << "median ms"
+		<< std::setw( 12 ) << "max ms" << std::endl;
+
+	//
+	// Dataset
+	//
+	bool generated = false;
+	run_case( "generate romlist", 1, [&]() { generated = generate_romlist( romlist_file, roms ); } );
+	if ( !generated || !generate_config( dir ))
+	{
+		std::cout << "Error writing benchmark data to: " << dir << std::endl;
+		return 1;
+	}
+
+	bool have_zip = generate_zip( zip_file, romlist_file );
+	generate_artwork( artwork_path, roms );
+
+	FeSettings fes( dir );
+	fes.load();
+
+	FeDisplayInfo *display = fes.get_display( 0 );
+	if ( !display )
+	{
+		std::cout << "Error loading benchmark display config" << std::endl;
+		return 1;
+	}
+
+	//
+	// Romlist text parse, with and without the cereal cache
+	//
+	run_case( "romlist parse", runs, [&]()
+	{
+		FeRomList rl( dir );
+		rl.load_romlist_file( romlist_file );
+	} );
+
+	run_case( "romlist parse (line by line)", runs, [&]()
+	{
+		FeRomList rl( dir );
+		rl.load_from_file( romlist_file, ";" );
+	} );
+
+	FeRomList rl( dir );
+	run_case( "romlist load (parse, save cache)", runs,
+		[&]() { rl.load_romlist( romlist_file, ROMLIST_NAME, *display, true, false ); },
+		[&]() { clear_cache( dir ); } );
+
+	run_case( "romlist load (cache)", runs,
+		[&]() { rl.load_romlist( romlist_file, ROMLIST_NAME, *display, true, false ); } );
+
+	//
+	// Filters
+	//
+	run_case( "create filters (build)", runs,
+		[&]() { rl.create_filters( *display ); },
+		[&]() { clear_cache( dir ); rl.load_romlist( romlist_file, ROMLIST_NAME, *display, true, false ); } );
+
+	run_case( "create filters (cache)", runs,
+		[&]() { rl.create_filters( *display ); } );
+
+	//
+	// Sorting
+	//
+	std::vector<FeRomInfo *> sort_list;
+	FeRomInfoListType &list = rl.get_list();
+	for ( FeRomInfoListType::iterator itr=list.begin(); itr!=list.end(); ++itr )
+		sort_list.push_back( &(*itr) );
+
+	const FeRomInfo::Index sort_by[] = { FeRomInfo::Title, FeRomInfo::Year, FeRomInfo::Manufacturer };
+	for ( size_t i=0; i<sizeof( sort_by ) / sizeof( sort_by[0] ); i++ )
+	{
+		std::vector<FeRomInfo *> sorted;
+		run_case( std::string( "sort by " ) + FeRomInfo::indexStrings[ sort_by[i] ], runs,
+			[&]() { std::stable_sort( sorted.begin(), sorted.end(), FeRomListSorter2( sort_by[i] )); },
+			[&]() { sorted = sort_list; } );
+	}
+
+	//
+	// Text substitutions, over every entry of the display's first filter
+	//
+	fes.set_display( 0 );
+	int subst_count = fes.get_filter_size( 0 );
+
+	run_case( "text substitutions", runs, [&]()
+	{
+		std::string s;
+		for ( int i=0; i<subst_count; i++ )
+		{
+			s = SUBST_TEXT;
+			fes.do_text_substitutions_absolute( s, 0, i );
+		}
+	} );
+
+	//
+	// Search as you type, one rule per letter of a word from the titles
+	//
+	const std::string search_word = WORDS[1];
+	run_case( "search as you type", runs, [&]()
+	{
+		for ( size_t i=1; i<=search_word.size(); i++ )
+			fes.set_search_rule( "Title contains " + search_word.substr( 0, i ));
+	},
+	[&]() { fes.set_search_rule( "" ); } );
+
+	fes.set_search_rule( "" );
+
+	//
+	// Artwork lookups, including the initial directory scan
+	//
+	run_case( "path cache lookups", runs, [&]()
+	{
+		FePathCache pc;
+		std::vector<std::string> in_list, out_list;
+		for ( int i=0; i<roms; i++ )
+		{
+			in_list.clear();
+			out_list.clear();
+			pc.get_filename_from_base( in_list, out_list, artwork_path, "rom" + as_str( i ), NULL );
+		}
+	} );
+
+	//
+	// Zip extraction
+	//
+	if ( have_zip )
+	{
+		run_case( "zip extraction", runs, [&]()
+		{
+			FeZipStream zs( zip_file );
+			for ( int i=0; i<ZIP_ENTRIES; i++ )
+				zs.open( "entry" + as_str( i ) + ".txt" );
+		} );
+	}
+	else
+		std::cout << "zip extraction skipped (no zip writer in this build)" << std::endl;
+
+	if ( !keep && file_exists( dir + MARKER_FILE ))
+		delete_dir( dir );
+
+	return 0;
+}
@@ -0,0 +1,308 @@
+/*
+ *
+ *  Attract-Mode Plus frontend
+ *  Copyright (C) 2025 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode Plus
+ *
+ *  Attract-Mode Plus is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode Plus is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode Plus.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "fe_benchmark.hpp"
+#include "fe_settings.hpp"
+#include "fe_window.hpp"
+#include "fe_vm.hpp"
+#include "fe_util.hpp"
+#include "image_loader.hpp"
+#include "fe_texture_pool.hpp"
+#include "nowide/fstream.hpp"
+
+#include "rapidjson/stringbuffer.h"
+#include "rapidjson/prettywriter.h"
+
+#include <SFML/System/Clock.hpp>
+#include <SFML/OpenGL.hpp>
+#include <algorithm>
+
+#if defined(SFML_SYSTEM_WINDOWS)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+const char *FeBenchmark::DEFAULT_REPORT = "benchmark.json";
+
+namespace
+{
+	typedef rapidjson::PrettyWriter<rapidjson::StringBuffer> FeJsonWriter;
+
+	double elapsed_ms( const sf::Clock &c )
+	{
+		return c.getElapsedTime().asMicroseconds() / 1000.0;
+	}
+
+	// Peak resident memory use of this process, in kilobytes
+	long get_peak_rss_kb()
+	{
+#if defined(SFML_SYSTEM_WINDOWS)
+		PROCESS_MEMORY_COUNTERS pmc;
+		if ( GetProcessMemoryInfo( GetCurrentProcess(), &pmc, sizeof( pmc )))
+			return (long)( pmc.PeakWorkingSetSize / 1024 );
+
+		return 0;
+#else
+		struct rusage ru;
+		if ( getrusage( RUSAGE_SELF, &ru ) != 0 )
+			return 0;
+
+ #if defined(SFML_SYSTEM_MACOS)
+		return ru.ru_maxrss / 1024; // bytes on macOS
+ #else
+		return ru.ru_maxrss;
+ #endif
+#endif
+	}
+
+	// Nearest-rank percentile of a sorted list
+	double percentile( const std::vector<double> &sorted, double p )
+	{
+		if ( sorted.empty() )
+			return 0.0;
+
+		size_t i = (size_t)( p / 100.0 * sorted.size() + 0.5 );
+		i = std::min( std::max( i, (size_t)1 ), sorted.size() );
+		return sorted[ i - 1 ];
+	}
+
+	void write_times( FeJsonWriter &w, const char *key, const std::vector<double> &times )
+	{
+		std::vector<double> sorted( times );
+		std::sort( sorted.begin(), sorted.end() );
+
+		double total=0.0;
+		for ( size_t i=0; i<sorted.size(); i++ )
+			total += sorted[i];
+
+		w.Key( key );
+		w.StartObject();
+		w.Key( "count" ); w.Uint( (unsigned int)sorted.size() );
+		w.Key( "total" ); w.Double( total );
+		w.Key( "mean" ); w.Double( sorted.empty() ? 0.0 : total / sorted.size() );
+		w.Key( "p50" ); w.Double( percentile( sorted, 50 ));
+		w.Key( "p90" ); w.Double( percentile( sorted, 90 ));
+		w.Key( "p95" ); w.Double( percentile( sorted, 95 ));
+		w.Key( "p99" ); w.Double( percentile( sorted, 99 ));
+		w.Key( "max" ); w.Double( sorted.empty() ? 0.0 : sorted.back() );
+		w.EndObject();
+	}
+};
+
+FeBenchmark::FeBenchmark( FeSettings &fes, FeWindow &wnd, FeVM &vm )
+	: m_fes( fes ),
+	m_wnd( wnd ),
+	m_vm( vm )
+{
+}
+
+int FeBenchmark::run( const std::string &display, int frames, const std::string &report_file )
+{
+	int index = m_fes.get_display_index_from_name( display );
+	if (( index < 0 ) && ( as_str( as_int( display )) == display ))
+		index = as_int( display );
+
+	if (( index < 0 ) || ( index >= m_fes.displays_count() ))
+	{
+		FeLog() << "Benchmark: display not found: " << display << std::endl;
+		return 1;
+	}
+
+	if ( frames <= 0 )
+		frames = DEFAULT_FRAMES;
+
+	// noted now, since the "display" phase moves on to other displays
+	std::string layout = m_fes.get_display( index )->get_info( FeDisplayInfo::Layout );
+
+	FeStableClock::set_fixed_step( sf::microseconds( 1000000 / m_vm.get_refresh_rate() ));
+	FeImageLoader::get_ref().reset_stats();
+
+	FeLog() << "Benchmark: display " << index << " (" << display << "), "
+		<< frames << " frames per phase" << std::endl;
+
+	//
+	// Load the display and layout, waiting for the romlist if it
+	// is loaded in the background
+	//
+	sf::Clock load_clock;
+	m_fes.set_display( index );
+	m_vm.load_layout( true );
+	m_fes.finish_display_load();
+	double load_ms = elapsed_ms( load_clock );
+
+	run_phase( "idle", frames, FeInputMap::LAST_COMMAND, 0 );
+	run_phase( "scroll", frames, FeInputMap::NextGame, 1 );
+	run_phase( "page", frames, FeInputMap::NextPage, 10 );
+	run_phase( "filter", frames, FeInputMap::NextFilter, std::max( 1, frames / 4 ));
+	run_phase( "display", frames, FeInputMap::NextDisplay, frames );
+
+	return write_report( report_file, display, layout, frames, load_ms ) ? 0 : 1;
+}
+
+void FeBenchmark::run_phase( const char *name, int frames, FeInputMap::Command c, int every )
+{
+	m_phases.push_back( Phase() );
+	Phase &p = m_phases.back();
+	p.name = name;
+	p.frame_ms.reserve( frames );
+
+	sf::Clock wall;
+	for ( int i=0; i<frames; i++ )
+	{
+		if (( c != FeInputMap::LAST_COMMAND ) && ( i % every == 0 ))
+			p.event_ms.push_back( send_command( c ));
+
+		p.frame_ms.push_back( draw_frame() );
+	}
+
+	//
+	// Navigation ends the same way as when the user lets go of a held key
+	//
+	if ( FeInputMap::is_repeatable_command( c ))
+	{
+		sf::Clock t;
+		m_vm.update_to( EndNavigation, false );
+		m_vm.on_transition( EndNavigation, 0 );
+		p.event_ms.push_back( elapsed_ms( t ));
+
+		p.frame_ms.push_back( draw_frame() );
+	}
+
+	p.wall_ms = elapsed_ms( wall );
+
+	FeLog() << "Benchmark: " << name << " phase done in " << p.wall_ms << " ms" << std::endl;
+}
+
+double FeBenchmark::send_command( FeInputMap::Command c )
+{
+	sf::Clock t;
+
+	if ( !m_vm.script_handle_event( c ))
+		m_vm.handle_event( c );
+
+	return elapsed_ms( t );
+}
+
+double FeBenchmark::draw_frame()
+{
+	sf::Clock t;
+
+	m_vm.tick();
+	m_vm.redraw_surfaces();
+
+	m_wnd.clear();
+	m_wnd.draw( m_vm );
+	m_wnd.display();
+
+	// wait for the gpu, otherwise its work lands in whichever frame blocks next
+	glFinish();
+
+	m_vm.step_layout_time();
+	return elapsed_ms( t );
+}
+
+bool FeBenchmark::write_report( const std::string &report_file,
+	const std::string &display,
+	const std::string &layout,
+	int frames,
+	double load_ms )
+{
+	rapidjson::StringBuffer buff;
+	FeJsonWriter w( buff );
+
+	std::vector<double> all_frames;
+	for ( size_t i=0; i<m_phases.size(); i++ )
+		all_frames.insert( all_frames.end(), m_phases[i].frame_ms.begin(), m_phases[i].frame_ms.end() );
+
+	const char *renderer = (const char *)glGetString( GL_RENDERER );
+	sf::Vector2u size = m_wnd.get_size();
+
+	w.StartObject();
+	w.Key( "version" ); w.String( FE_VERSION );
+	w.Key( "display" ); w.String( display.c_str() );
+	w.Key( "layout" ); w.String( layout.c_str() );
+	w.Key( "renderer" ); w.String( renderer ? renderer : "" );
+	w.Key( "width" ); w.Uint( size.x );
+	w.Key( "height" ); w.Uint( size.y );
+	w.Key( "timestep_ms" ); w.Double( 1000.0 / m_vm.get_refresh_rate() );
+	w.Key( "frames_per_phase" ); w.Int( frames );
+	w.Key( "load_ms" ); w.Double( load_ms );
+
+	w.Key( "phases" );
+	w.StartArray();
+	for ( size_t i=0; i<m_phases.size(); i++ )
+	{
+		const Phase &p = m_phases[i];
+		w.StartObject();
+		w.Key( "name" ); w.String( p.name.c_str() );
+		w.Key( "wall_ms" ); w.Double( p.wall_ms );
+		write_times( w, "event_ms", p.event_ms );
+		write_times( w, "frame_ms", p.frame_ms );
+		w.EndObject();
+	}
+	w.EndArray();
+
+	write_times( w, "frame_ms", all_frames );
+
+	FeImageLoader &il = FeImageLoader::get_ref();
+	int hits, misses;
+	il.get_stats( hits, misses );
+
+	w.Key( "image_loader" );
+	w.StartObject();
+	w.Key( "cache_hits" ); w.Int( hits );
+	w.Key( "cache_misses" ); w.Int( misses );
+	w.Key( "cached_images" ); w.Int( il.cache_count() );
+	w.Key( "cache_bytes" ); w.Int( il.cache_size() );
+	w.Key( "cache_max_bytes" ); w.Int( il.cache_max() );
+	w.EndObject();
+
+	FeTexturePool &tp = FeTexturePool::get_ref();
+	int created, reused, freed;
+	tp.get_stats( created, reused, freed );
+
+	w.Key( "texture_pool" );
+	w.StartObject();
+	w.Key( "created" ); w.Int( created );
+	w.Key( "reused" ); w.Int( reused );
+	w.Key( "freed" ); w.Int( freed );
+	w.Key( "pooled_textures" ); w.Int( tp.pool_count() );
+	w.Key( "pooled_bytes" ); w.Int( tp.pool_bytes() );
+	w.Key( "budget_bytes" ); w.Int( FeTexturePool::get_budget() );
+	w.EndObject();
+
+	w.Key( "peak_rss_kb" ); w.Int64( get_peak_rss_kb() );
+	w.EndObject();
+
+	nowide::ofstream file( report_file.c_str() );
+	if ( !file.is_open() )
+	{
+		FeLog() << "Error writing benchmark report: " << report_file << std::endl;
+		return false;
+	}
+
+	file << buff.GetString() << std::endl;
+	FeLog() << "Benchmark report written to: " << report_file << std::endl;
+	return true;
+}
@@ -0,0 +1,88 @@
+/*
+ *
+ *  Attract-Mode Plus frontend
+ *  Copyright (C) 2025 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode Plus
+ *
+ *  Attract-Mode Plus is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode Plus is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode Plus.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FE_BENCHMARK_HPP
+#define FE_BENCHMARK_HPP
+
+#include "fe_input.hpp"
+#include <string>
+#include <vector>
+
+class FeSettings;
+class FeWindow;
+class FeVM;
+
+//
+// Headless layout benchmark, run with the --benchmark command line option
+//
+// Loads a display and its layout into an offscreen render target and
+// replays a fixed input script (scrolling, paging, changing filters and
+// changing display) with the layout clock stepped at a fixed rate, so
+// that runs are comparable between builds and machines.  Timings for
+// each phase, frame time percentiles, image loader stats and peak memory
+// use are written to a JSON report.
+//
+class FeBenchmark
+{
+public:
+	static const int DEFAULT_FRAMES=300; // frames per phase
+	static const char *DEFAULT_REPORT;
+
+	FeBenchmark( FeSettings &fes, FeWindow &wnd, FeVM &vm );
+
+	// Returns the process exit code
+	int run( const std::string &display, int frames, const std::string &report_file );
+
+private:
+	FeBenchmark( const FeBenchmark & );
+	FeBenchmark &operator=( const FeBenchmark & );
+
+	struct Phase
+	{
+		std::string name;
+		std::vector<double> frame_ms;
+		std::vector<double> event_ms;
+		double wall_ms=0.0;
+	};
+
+	//
+	// Run frames frames, sending command c before every "every" frames
+	// (c=LAST_COMMAND for none)
+	//
+	void run_phase( const char *name, int frames, FeInputMap::Command c, int every );
+
+	double send_command( FeInputMap::Command c );
+	double draw_frame();
+
+	bool write_report( const std::string &report_file,
+		const std::string &display,
+		const std::string &layout,
+		int frames,
+		double load_ms );
+
+	FeSettings &m_fes;
+	FeWindow &m_wnd;
+	FeVM &m_vm;
+	std::vector<Phase> m_phases;
+};
+
+#endif
@@ -1,5 +1,7 @@
 #include "fe_cache.hpp"
 #include <ctime>
+#include <sstream>
+#include <iomanip>
 
 // Enable the romlist cache
 // - disabling prevents all caching
@@ -74,8 +76,13 @@ const char *FE_CACHE_DISPLAY = "display";
 const char *FE_CACHE_EMULATOR = "emulator";
 const char *FE_CACHE_AVAILABLE = "available";
 const char *FE_CACHE_ROMLIST = "romlist";
+const char *FE_CACHE_EXTRA = "extra";
+const char *FE_CACHE_EXTRA_EXT = ".dat";
 const char *FE_CACHE_CONFIG = "config";
 const char *FE_CACHE_GLOBALFILTER = "globalfilter";
+const char *FE_CACHE_SCRIPT = "script";
+const char *FE_CACHE_SCRIPT_EXT = ".cnut";
+const char *FE_CACHE_HASHES = "hashes";
 const std::string FE_EMPTY_STRING;
 
 FeSettings* FeCache::m_feSettings = nullptr;
@@ -131,14 +138,19 @@ bool FeCache::load_available( const FeRomList &romlist, std::map<std::string, st
 bool FeCache::validate_available( FeRomList &romlist, std::map<std::string, std::vector<std::string>> &emu_roms ) { return false; }
 bool FeCache::save_romlist( const FeRomList &romlist ) { return false; }
 bool FeCache::load_romlist( FeRomList &romlist ) { return false; }
+std::string FeCache::get_romlist_extra_filename( const FeRomList &romlist, std::uint64_t stamp ) { return FE_EMPTY_STRING; }
+void FeCache::delete_romlist_extra( const FeRomList &romlist, std::uint64_t keep_stamp ) {}
 bool FeCache::save_globalfilter( const FeDisplayInfo &display, const FeRomList &romlist ) { return false; }
 bool FeCache::load_globalfilter( const FeDisplayInfo &display, FeRomList &romlist ) { return false; }
 bool FeCache::save_filter( FeDisplayInfo &display, const FeFilterEntry &entry, const int filter_index ) { return false; }
-bool FeCache::load_filter( FeDisplayInfo &display, FeFilterEntry &entry, const int filter_index, const std::map<int, FeRomInfo*> &lookup ) { return false; }
+bool FeCache::load_filter( FeDisplayInfo &display, FeFilterEntry &entry, const int filter_index, const std::vector<FeRomInfo*> &lookup ) { return false; }
 void FeCache::invalidate_rominfo( const FeRomList &romlist, const std::set<FeRomInfo::Index> targets ) {}
 void FeCache::clear_stats() {}
 bool FeCache::set_stats_info( const std::string &path, const std::vector<std::string> &rominfo ) { return false; }
 bool FeCache::get_stats_info( const std::string &path, std::vector<std::string> &rominfo ) { return false; }
+std::string FeCache::get_script_filename( const std::string &path ) { return FE_EMPTY_STRING; }
+bool FeCache::save_hashes( std::map<std::string, std::vector<std::string>> &hashes ) { return false; }
+bool FeCache::load_hashes( std::map<std::string, std::vector<std::string>> &hashes ) { return false; }
 
 #else
 
@@ -198,6 +210,55 @@ std::string FeCache::get_romlist_filename(
 		: m_cache_path + FE_CACHE_ROMLIST + "." + sanitize_filename( name ) + FE_CACHE_EXT;
 }
 
+std::string FeCache::get_romlist_extra_filename(
+	const FeRomList &romlist,
+	std::uint64_t stamp
+)
+{
+	std::string name = romlist.get_romlist_name();
+	if ( name.empty() )
+		return FE_EMPTY_STRING;
+
+	std::ostringstream ss;
+	ss << std::hex << std::setw( 16 ) << std::setfill( '0' ) << stamp;
+
+	return m_cache_path + FE_CACHE_ROMLIST + "." + sanitize_filename( name ) + "." + FE_CACHE_EXTRA
+		+ "." + ss.str() + FE_CACHE_EXTRA_EXT;
+}
+
+//
+// Segments still open by roms that are in use can't be deleted on Windows,
+// those are picked up by a later call
+//
+void FeCache::delete_romlist_extra(
+	const FeRomList &romlist,
+	std::uint64_t keep_stamp
+)
+{
+	std::string name = romlist.get_romlist_name();
+	if ( name.empty() )
+		return;
+
+	std::string base = std::string( FE_CACHE_ROMLIST ) + "." + sanitize_filename( name ) + "." + FE_CACHE_EXTRA + ".";
+	std::string keep = get_romlist_extra_filename( romlist, keep_stamp );
+
+	std::vector<std::string> files, dummy;
+	get_filename_from_base( files, dummy, m_cache_path, base, NULL );
+
+	for ( std::vector<std::string>::const_iterator itr=files.begin(); itr!=files.end(); ++itr )
+	{
+		if (( *itr == keep ) || ( (*itr).compare( m_cache_path.size(), base.size(), base ) != 0 ))
+			continue;
+
+		// The base match is case insensitive and also catches romlists whose
+		// names start with this one's, so only take "<stamp>.dat" names
+		std::string rest = (*itr).substr( m_cache_path.size() + base.size() );
+		if (( rest.find_first_not_of( "0123456789abcdef" ) == 16 )
+				&& ( rest.compare( 16, std::string::npos, FE_CACHE_EXTRA_EXT ) == 0 ))
+			delete_cache( *itr );
+	}
+}
+
 std::string FeCache::get_globalfilter_filename(
 	const FeDisplayInfo &display
 )
@@ -228,6 +289,32 @@ std::string FeCache::get_stats_filename(
 		: m_cache_path + FE_CACHE_EMULATOR + "." + sanitize_filename( emulator ) + "." + FE_CACHE_STATS + FE_CACHE_EXT;
 }
 
+std::string FeCache::get_hashes_filename()
+{
+	return m_cache_path.empty()
+		? FE_EMPTY_STRING
+		: m_cache_path + FE_CACHE_HASHES + FE_CACHE_EXT;
+}
+
+//
+// Compiled script bytecode, written and validated by FeVM
+// - Named after a hash of the full path, since sanitize_filename() maps
+//   different paths (i.e. "a-b/x.nut" and "a/b/x.nut") to the same name
+//
+std::string FeCache::get_script_filename(
+	const std::string &path
+)
+{
+	if ( path.empty() || m_cache_path.empty() )
+		return FE_EMPTY_STRING;
+
+	std::ostringstream ss;
+	ss << std::hex << std::setw( 16 ) << std::setfill( '0' ) << fnv1a_hash( path );
+
+	return m_cache_path + FE_CACHE_SCRIPT + "." + sanitize_filename( path_filename( path ) )
+		+ "." + ss.str() + FE_CACHE_SCRIPT_EXT;
+}
+
 // -------------------------------------------------------------------------------------
 
 template <typename T>
@@ -676,7 +763,7 @@ bool FeCache::load_filter(
 	FeDisplayInfo &display,
 	FeFilterEntry &entry,
 	const int filter_index,
-	const std::map<int, FeRomInfo*> &lookup
+	const std::vector<FeRomInfo*> &lookup
 )
 {
 	// Special case - filters using Shuffle will always invalidate (their content changes every load)
@@ -916,8 +1003,46 @@ bool FeCache::set_stats_info(
 	for ( std::vector<FeRomInfo::Index>::const_iterator its=FeRomInfo::Stats.begin(); its != FeRomInfo::Stats.end(); ++its )
 		m_stats_cache[emulator][romname].push_back( rominfo[ *its ] );
 
-	// Save the updated stats cache
-	return save_stats( emulator );
+	// Save the updated stats cache in the background, a newer copy replaces
+	// one that is still waiting to be written
+	std::string filename = get_stats_filename( emulator );
+	FeStatsWriter::get_ref().queue( filename, [filename, stats=m_stats_cache[emulator]]() mutable
+	{
+		FeCacheList cacheList( stats );
+		if ( !save_cache( filename, cacheList ) )
+			delete_cache( filename );
+	});
+
+	return true;
+}
+
+// -------------------------------------------------------------------------------------
+//
+// Hashes cache stores the scraper's rom file hashes
+// - Keyed by path, each entry holds size, mtime and the hashes, validated by the scraper
+//
+
+bool FeCache::save_hashes(
+	std::map<std::string, std::vector<std::string>> &hashes
+)
+{
+	FeCacheList cacheList( hashes );
+	bool success = save_cache( get_hashes_filename(), cacheList );
+	debug( "Save Hashes Cache", "", success );
+	_debug();
+	return success;
+}
+
+bool FeCache::load_hashes(
+	std::map<std::string, std::vector<std::string>> &hashes
+)
+{
+	FeCacheList cacheList( hashes );
+	bool success = load_cache( get_hashes_filename(), cacheList );
+	debug( "Load Hashes Cache", "", success );
+	if ( !success ) hashes.clear();
+	_debug();
+	return success;
 }
 
 #endif
\ No newline at end of file
@@ -12,6 +12,8 @@
 #include <cereal/types/map.hpp>
 #include <cereal/types/vector.hpp>
 
+extern const char *FE_CACHE_SUBDIR;
+
 class FeCache
 {
 private:
@@ -57,6 +59,8 @@ private:
 		const std::string &emulator
 	);
 
+	static std::string get_hashes_filename();
+
 	// ----------------------------------------------------------------------------------
 
 	template <typename T>
@@ -211,6 +215,19 @@ public:
 		FeRomList &romlist
 	);
 
+	// Segment file holding the romlist's cold fields, see FeRomColdStore.
+	// Every segment written gets its own file, named after its stamp
+	static std::string get_romlist_extra_filename(
+		const FeRomList &romlist,
+		std::uint64_t stamp
+	);
+
+	// Delete the romlist's segment files other than the one with keep_stamp
+	static void delete_romlist_extra(
+		const FeRomList &romlist,
+		std::uint64_t keep_stamp
+	);
+
 	// ----------------------------------------------------------------------------------
 
 	static bool save_globalfilter(
@@ -235,7 +252,7 @@ public:
 		FeDisplayInfo &display,
 		FeFilterEntry &entry,
 		const int filter_index,
-		const std::map<int, FeRomInfo*> &lookup
+		const std::vector<FeRomInfo*> &lookup
 	);
 
 	// ----------------------------------------------------------------------------------
@@ -259,6 +276,22 @@ public:
 		std::vector<std::string> &rominfo
 	);
 
+	// ----------------------------------------------------------------------------------
+
+	static std::string get_script_filename(
+		const std::string &path
+	);
+
+	// ----------------------------------------------------------------------------------
+
+	static bool save_hashes(
+		std::map<std::string, std::vector<std::string>> &hashes
+	);
+
+	static bool load_hashes(
+		std::map<std::string, std::vector<std::string>> &hashes
+	);
+
 };
 
 // Cache class used to save versioned map<string,string> data
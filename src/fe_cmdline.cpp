@@ -52,7 +52,11 @@ void process_args( int argc, char *argv[],
 			std::string &log_file,
 			FeLogLevel &log_level,
 			bool &window_topmost,
-			std::vector<int> &window_args )
+			std::vector<int> &window_args,
+			std::string &profile_file,
+			std::string &benchmark_display,
+			int &benchmark_frames,
+			std::string &benchmark_report )
 {
 	//
 	// Deal with command line arguments
@@ -331,6 +335,45 @@ void process_args( int argc, char *argv[],
 			if ( window_args.size() != 4 )
 				window_args.clear();
 		}
+		else if ( strcmp( argv[next_arg], "--profile-scripts" ) == 0 )
+		{
+			next_arg++;
+			if ( next_arg < argc )
+			{
+				profile_file = argv[next_arg];
+				next_arg++;
+			}
+			else
+			{
+				FeLog() << "Error, no report file specified with --profile-scripts option." << std::endl;
+				exit(1);
+			}
+		}
+		else if ( strcmp( argv[next_arg], "--benchmark" ) == 0 )
+		{
+			next_arg++;
+			if ( next_arg < argc )
+			{
+				benchmark_display = argv[next_arg];
+				next_arg++;
+			}
+			else
+			{
+				FeLog() << "Error, no display specified with --benchmark option." << std::endl;
+				exit(1);
+			}
+
+			if ( next_arg < argc && argv[next_arg][0] != '-' )
+			{
+				benchmark_frames = as_int( argv[next_arg] );
+				next_arg++;
+			}
+			if ( next_arg < argc && argv[next_arg][0] != '-' )
+			{
+				benchmark_report = argv[next_arg];
+				next_arg++;
+			}
+		}
 #ifndef SFML_SYSTEM_WINDOWS
 		else if (( strcmp( argv[next_arg], "-n" ) == 0 )
 				|| ( strcmp( argv[next_arg], "--console" ) == 0 ))
@@ -375,6 +418,8 @@ void process_args( int argc, char *argv[],
 			write_option( "-d, --display <display> [filter] [rom]", "Show the given Display, Filter, and Rom on startup" );
 			write_option( "-w, --window <x> <y> <w> <h>", "Set the position and size for window modes" );
 			write_option( "-t, --topmost", "Keep the window always on top" );
+			write_option( "--profile-scripts <file>", "Profile layout and plugin scripts, writing a report to the given file on exit" );
+			write_option( "--benchmark <display> [frames] [file]", "Run a headless benchmark of the given Display, writing a JSON report (default benchmark.json)" );
 			write_option( "-v, --version", "Show version information" );
 			write_option( "-h, --help", "Show this message" );
 
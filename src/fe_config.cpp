@@ -1718,6 +1718,7 @@ void FeScraperMenu::get_options( FeConfigContext &ctx )
 	ctx.add_opt( Opt::TOGGLE, _( "Scrape Fanart" ), ctx.fe_settings.get_info_bool( FeSettings::ScrapeFanArt ), _( "_help_scraper_fanart" ) );
 	ctx.add_opt( Opt::TOGGLE, _( "Scrape Videos" ), ctx.fe_settings.get_info_bool( FeSettings::ScrapeVids ), _( "_help_scraper_vids" ) );
 	ctx.add_opt( Opt::TOGGLE, _( "Scrape Overview" ), ctx.fe_settings.get_info_bool( FeSettings::ScrapeOverview ), _( "_help_scraper_overview" ) );
+	ctx.add_opt( Opt::TOGGLE, _( "Send MD5/SHA-1 Hashes" ), ctx.fe_settings.get_info_bool( FeSettings::ScrapeFullHashes ), _( "_help_scraper_full_hashes" ) );
 	ctx.add_opt( Opt::EDIT, _( "ScreenScraper Username" ), ctx.fe_settings.get_info( FeSettings::ScreenScraperUser ), _( "_help_screenscraper_user" ) );
 	ctx.add_opt( Opt::EDIT, _( "ScreenScraper Password" ), ctx.fe_settings.get_info( FeSettings::ScreenScraperPass ), _( "_help_screenscraper_pass" ) );
 	FeBaseConfigMenu::get_options( ctx );
@@ -1732,8 +1733,9 @@ bool FeScraperMenu::save( FeConfigContext &ctx )
 	ctx.fe_settings.set_info( FeSettings::ScrapeFanArt, ctx.opt_list[4].get_bool() );
 	ctx.fe_settings.set_info( FeSettings::ScrapeVids, ctx.opt_list[5].get_bool() );
 	ctx.fe_settings.set_info( FeSettings::ScrapeOverview, ctx.opt_list[6].get_bool() );
-	ctx.fe_settings.set_info( FeSettings::ScreenScraperUser, ctx.opt_list[7].get_value() );
-	ctx.fe_settings.set_info( FeSettings::ScreenScraperPass, ctx.opt_list[8].get_value() );
+	ctx.fe_settings.set_info( FeSettings::ScrapeFullHashes, ctx.opt_list[7].get_bool() );
+	ctx.fe_settings.set_info( FeSettings::ScreenScraperUser, ctx.opt_list[8].get_value() );
+	ctx.fe_settings.set_info( FeSettings::ScreenScraperPass, ctx.opt_list[9].get_value() );
 	return true;
 }
 
@@ -1830,6 +1832,9 @@ void FeMiscMenu::get_options( FeConfigContext &ctx )
 	ctx.add_opt( Opt::LIST, _( "Screen Rotation" ), rot_mode, _( "_help_misc_screen_rotation" ) )->append_vlist( rot_modes );
 
 	ctx.add_opt( Opt::EDIT, _( "Image Cache Size" ), ctx.fe_settings.get_info( FeSettings::ImageCacheMBytes ), _( "_help_misc_image_cache_mbytes" ) );
+	ctx.add_opt( Opt::EDIT, _( "Image Atlas Size" ), ctx.fe_settings.get_info( FeSettings::ImageAtlasSize ), _( "_help_misc_image_atlas_size" ) );
+	ctx.add_opt( Opt::EDIT, _( "Texture Pool Size" ), ctx.fe_settings.get_info( FeSettings::TexturePoolMBytes ), _( "_help_misc_texture_pool_mbytes" ) );
+	ctx.add_opt( Opt::TOGGLE, _( "Background Shader Compiling" ), ctx.fe_settings.get_info_bool( FeSettings::AsyncShaders ), _( "_help_misc_async_shaders" ) );
 	std::vector<std::string> decoders;
 	std::string vid_dec;
 #ifdef NO_MOVIE
@@ -1881,6 +1886,9 @@ bool FeMiscMenu::save( FeConfigContext &ctx )
 #endif
 	ctx.fe_settings.set_info( FeSettings::ScreenRotation, FeSettings::screenRotationTokens[ ctx.opt_list[i++].get_vindex() ] );
 	ctx.fe_settings.set_info( FeSettings::ImageCacheMBytes, ctx.opt_list[i++].get_value() );
+	ctx.fe_settings.set_info( FeSettings::ImageAtlasSize, ctx.opt_list[i++].get_value() );
+	ctx.fe_settings.set_info( FeSettings::TexturePoolMBytes, ctx.opt_list[i++].get_value() );
+	ctx.fe_settings.set_info( FeSettings::AsyncShaders, ctx.opt_list[i++].get_bool() );
 	ctx.fe_settings.set_info( FeSettings::VideoDecoder, ctx.opt_list[i++].get_value() );
 	ctx.fe_settings.set_info( FeSettings::QuickMenu, ctx.opt_list[i++].get_bool() );
 	ctx.fe_settings.set_info( FeSettings::LayoutPreview, ctx.opt_list[i++].get_bool() );
@@ -0,0 +1,249 @@
+/*
+ *
+ *  Attract-Mode Plus frontend
+ *  Copyright (C) 2025 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode Plus
+ *
+ *  Attract-Mode Plus is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode Plus is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode Plus.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "fe_hash.hpp"
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+	struct FeCrcTable
+	{
+		std::uint32_t t[256];
+
+		FeCrcTable()
+		{
+			for ( std::uint32_t i=0; i<256; i++ )
+			{
+				std::uint32_t c = i;
+				for ( int k=0; k<8; k++ )
+					c = ( c & 1 ) ? ( 0xedb88320 ^ ( c >> 1 )) : ( c >> 1 );
+				t[i] = c;
+			}
+		}
+	};
+
+	const FeCrcTable g_crc_table;
+
+	inline std::uint32_t rol( std::uint32_t x, int n )
+	{
+		return ( x << n ) | ( x >> ( 32 - n ));
+	}
+
+	void sha1_transform( std::uint32_t *h, const std::uint8_t *b )
+	{
+		std::uint32_t w[80];
+		for ( int i=0; i<16; i++ )
+			w[i] = ( (std::uint32_t)b[i*4] << 24 ) | ( (std::uint32_t)b[i*4+1] << 16 )
+				| ( (std::uint32_t)b[i*4+2] << 8 ) | b[i*4+3];
+
+		for ( int i=16; i<80; i++ )
+			w[i] = rol( w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1 );
+
+		std::uint32_t a=h[0], bb=h[1], c=h[2], d=h[3], e=h[4];
+		for ( int i=0; i<80; i++ )
+		{
+			std::uint32_t f, k;
+			if ( i < 20 ) { f = ( bb & c ) | ( ~bb & d ); k = 0x5a827999; }
+			else if ( i < 40 ) { f = bb ^ c ^ d; k = 0x6ed9eba1; }
+			else if ( i < 60 ) { f = ( bb & c ) | ( bb & d ) | ( c & d ); k = 0x8f1bbcdc; }
+			else { f = bb ^ c ^ d; k = 0xca62c1d6; }
+
+			std::uint32_t t = rol( a, 5 ) + f + e + k + w[i];
+			e = d; d = c; c = rol( bb, 30 ); bb = a; a = t;
+		}
+
+		h[0] += a; h[1] += bb; h[2] += c; h[3] += d; h[4] += e;
+	}
+
+	void md5_transform( std::uint32_t *h, const std::uint8_t *b )
+	{
+		static const std::uint32_t K[64] = {
+			0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+			0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+			0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+			0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+			0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+			0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+			0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+			0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391 };
+
+		static const int R[64] = {
+			7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+			5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+			4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+			6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21 };
+
+		std::uint32_t m[16];
+		for ( int i=0; i<16; i++ )
+			m[i] = b[i*4] | ( (std::uint32_t)b[i*4+1] << 8 )
+				| ( (std::uint32_t)b[i*4+2] << 16 ) | ( (std::uint32_t)b[i*4+3] << 24 );
+
+		std::uint32_t a=h[0], bb=h[1], c=h[2], d=h[3];
+		for ( int i=0; i<64; i++ )
+		{
+			std::uint32_t f;
+			int g;
+			if ( i < 16 ) { f = ( bb & c ) | ( ~bb & d ); g = i; }
+			else if ( i < 32 ) { f = ( d & bb ) | ( ~d & c ); g = ( 5 * i + 1 ) % 16; }
+			else if ( i < 48 ) { f = bb ^ c ^ d; g = ( 3 * i + 5 ) % 16; }
+			else { f = c ^ ( bb | ~d ); g = ( 7 * i ) % 16; }
+
+			std::uint32_t t = d;
+			d = c;
+			c = bb;
+			bb = bb + rol( a + f + K[i] + m[g], R[i] );
+			a = t;
+		}
+
+		h[0] += a; h[1] += bb; h[2] += c; h[3] += d;
+	}
+
+	std::string to_hex( const std::uint8_t *d, size_t len )
+	{
+		static const char digits[] = "0123456789abcdef";
+		std::string retval;
+		retval.reserve( len * 2 );
+
+		for ( size_t i=0; i<len; i++ )
+		{
+			retval += digits[ d[i] >> 4 ];
+			retval += digits[ d[i] & 0x0f ];
+		}
+
+		return retval;
+	}
+};
+
+FeHasher::FeHasher( int types )
+	: m_types( types ),
+	m_crc( 0xffffffff )
+{
+	const std::uint32_t sha1_init[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+
+	memset( &m_sha1, 0, sizeof( m_sha1 ));
+	memcpy( m_sha1.h, sha1_init, sizeof( sha1_init ));
+
+	// md5 shares its first four initial values with sha1
+	memset( &m_md5, 0, sizeof( m_md5 ));
+	memcpy( m_md5.h, sha1_init, 4 * sizeof( std::uint32_t ));
+}
+
+void FeHasher::update( const void *data, size_t len )
+{
+	const std::uint8_t *p = (const std::uint8_t *)data;
+
+	if ( m_types & Crc32 )
+	{
+		std::uint32_t c = m_crc;
+		for ( size_t i=0; i<len; i++ )
+			c = g_crc_table.t[ ( c ^ p[i] ) & 0xff ] ^ ( c >> 8 );
+		m_crc = c;
+	}
+
+	if ( m_types & Sha1 )
+		block_update( m_sha1, p, len, sha1_transform );
+
+	if ( m_types & Md5 )
+		block_update( m_md5, p, len, md5_transform );
+}
+
+void FeHasher::block_update( BlockState &s, const std::uint8_t *data, size_t len,
+	void (*transform)( std::uint32_t *, const std::uint8_t * ) )
+{
+	s.total += len;
+
+	if ( s.used )
+	{
+		size_t n = std::min( len, sizeof( s.block ) - s.used );
+		memcpy( s.block + s.used, data, n );
+		s.used += n;
+		data += n;
+		len -= n;
+
+		if ( s.used < sizeof( s.block ))
+			return;
+
+		transform( s.h, s.block );
+		s.used = 0;
+	}
+
+	while ( len >= sizeof( s.block ))
+	{
+		transform( s.h, data );
+		data += sizeof( s.block );
+		len -= sizeof( s.block );
+	}
+
+	memcpy( s.block, data, len );
+	s.used = len;
+}
+
+std::string FeHasher::block_finish( BlockState &s, bool big_endian, int words,
+	void (*transform)( std::uint32_t *, const std::uint8_t * ) )
+{
+	std::uint64_t bits = s.total * 8;
+
+	s.block[ s.used++ ] = 0x80;
+	if ( s.used > 56 )
+	{
+		memset( s.block + s.used, 0, sizeof( s.block ) - s.used );
+		transform( s.h, s.block );
+		s.used = 0;
+	}
+	memset( s.block + s.used, 0, 56 - s.used );
+
+	for ( int i=0; i<8; i++ )
+		s.block[ big_endian ? 63 - i : 56 + i ] = (std::uint8_t)( bits >> ( i * 8 ));
+
+	transform( s.h, s.block );
+
+	std::uint8_t out[20];
+	for ( int i=0; i<words; i++ )
+	{
+		for ( int j=0; j<4; j++ )
+			out[ i*4 + j ] = (std::uint8_t)( s.h[i] >> ( big_endian ? 24 - j*8 : j*8 ));
+	}
+
+	return to_hex( out, words * 4 );
+}
+
+void FeHasher::finish( std::string &crc, std::string &sha1, std::string &md5 )
+{
+	crc.clear();
+	sha1.clear();
+	md5.clear();
+
+	if ( m_types & Crc32 )
+	{
+		std::uint32_t c = m_crc ^ 0xffffffff;
+		std::uint8_t out[4] = { (std::uint8_t)( c >> 24 ), (std::uint8_t)( c >> 16 ),
+			(std::uint8_t)( c >> 8 ), (std::uint8_t)c };
+		crc = to_hex( out, 4 );
+	}
+
+	if ( m_types & Sha1 )
+		sha1 = block_finish( m_sha1, true, 5, sha1_transform );
+
+	if ( m_types & Md5 )
+		md5 = block_finish( m_md5, false, 4, md5_transform );
+}
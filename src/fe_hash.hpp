@@ -0,0 +1,73 @@
+/*
+ *
+ *  Attract-Mode Plus frontend
+ *  Copyright (C) 2025 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode Plus
+ *
+ *  Attract-Mode Plus is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode Plus is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode Plus.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FE_HASH_HPP
+#define FE_HASH_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+//
+// Streaming file hasher.  Data is fed in with update() as it is read and
+// any combination of CRC32, SHA-1 and MD5 digests are computed in the same
+// pass.  Digests are returned as lower case hex strings.
+//
+class FeHasher
+{
+public:
+	enum Type
+	{
+		Crc32=0x01,
+		Sha1=0x02,
+		Md5=0x04
+	};
+
+	FeHasher( int types=Crc32 );
+
+	void update( const void *data, size_t len );
+
+	// Finish hashing.  Digests that were not requested are left empty
+	void finish( std::string &crc, std::string &sha1, std::string &md5 );
+
+private:
+	struct BlockState
+	{
+		std::uint32_t h[5];
+		std::uint8_t block[64];
+		size_t used;
+		std::uint64_t total;
+	};
+
+	void block_update( BlockState &s, const std::uint8_t *data, size_t len,
+		void (*transform)( std::uint32_t *, const std::uint8_t * ) );
+
+	std::string block_finish( BlockState &s, bool big_endian, int words,
+		void (*transform)( std::uint32_t *, const std::uint8_t * ) );
+
+	int m_types;
+	std::uint32_t m_crc;
+	BlockState m_sha1;
+	BlockState m_md5;
+};
+
+#endif
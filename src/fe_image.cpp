@@ -30,6 +30,8 @@
 #include "fe_audio_fx.hpp"
 #include "zip.hpp"
 #include "image_loader.hpp"
+#include "fe_atlas.hpp"
+#include "fe_texture_pool.hpp"
 
 #include <algorithm>
 #include <cmath>
@@ -51,6 +53,15 @@ bool FeBaseTextureContainer::get_visible() const
 	return true;
 }
 
+sf::FloatRect FeBaseTextureContainer::get_texture_rect()
+{
+	return sf::FloatRect( { 0, 0 }, sf::Vector2f( get_texture().getSize() ));
+}
+
+void FeBaseTextureContainer::disable_atlas()
+{
+}
+
 void FeBaseTextureContainer::set_play_state( bool play )
 {
 }
@@ -271,22 +282,25 @@ FeTextureContainer::FeTextureContainer(
 	m_volume( 100.0 ),
 	m_pan( 0.0 ),
 	m_fft_bands( 32 ),
-	m_entry( NULL )
+	m_entry( NULL ),
+	m_slot( NULL ),
+	m_no_atlas( false ),
+	m_audio_effects( std::make_unique<FeAudioEffectsManager>() )
 {
 #ifndef NO_MOVIE
-	m_audio_effects.add_effect( std::make_unique<FeAudioDCFilter>() );
-	m_audio_effects.add_effect( std::make_unique<FeAudioNormaliser>() );
-	m_audio_effects.add_effect( std::make_unique<FeAudioVisualiser>() );
+	m_audio_effects->add_effect( std::make_unique<FeAudioDCFilter>() );
+	m_audio_effects->add_effect( std::make_unique<FeAudioNormaliser>() );
+	m_audio_effects->add_effect( std::make_unique<FeAudioVisualiser>() );
 
 	FePresent *fep = FePresent::script_get_fep();
 	if ( fep )
 	{
-		auto* normaliser = m_audio_effects.get_effect<FeAudioNormaliser>();
+		auto* normaliser = m_audio_effects->get_effect<FeAudioNormaliser>();
 		if ( normaliser )
 			normaliser->set_media_volume( fep->get_fes()->get_play_volume( FeSoundInfo::Movie ) / 100.0f );
 	}
 
-	m_audio_effects.set_ready_for_processing();
+	m_audio_effects->set_ready_for_processing();
 #endif
 
 	if ( is_artwork )
@@ -318,6 +332,11 @@ FeTextureContainer::~FeTextureContainer()
 		FeImageLoader &il = FeImageLoader::get_ref();
 		il.release_entry( &m_entry );
 	}
+
+	if ( m_slot )
+		FeTextureAtlas::get_ref().release( m_slot );
+
+	FeTexturePool::get_ref().release( m_texture );
 }
 
 bool FeTextureContainer::get_visible() const
@@ -332,6 +351,13 @@ bool FeTextureContainer::fix_masked_image()
 {
 	bool retval=false;
 
+	if ( m_slot )
+	{
+		// the mask has to be applied to a texture of our own
+		m_no_atlas = true;
+		reload_image();
+	}
+
 	sf::Image tmp_img = m_texture.copyToImage();
 	sf::Vector2u tmp_s = tmp_img.getSize();
 
@@ -380,11 +406,11 @@ bool FeTextureContainer::load_with_ffmpeg(
 
 	if ( !file_exists( loaded_name ) )
 	{
-		m_texture = sf::Texture();
+		FeTexturePool::get_ref().release( m_texture );
 		return false;
 	}
 
-	m_movie = new FeMedia( FeMedia::AudioVideo, m_audio_effects );
+	m_movie = new FeMedia( FeMedia::AudioVideo, *m_audio_effects );
 	res = m_movie->open( "", loaded_name, &m_texture );
 
 	if ( !res )
@@ -392,7 +418,7 @@ bool FeTextureContainer::load_with_ffmpeg(
 		FeLog() << "ERROR loading video: "
 			<< loaded_name << std::endl;
 
-		m_texture = sf::Texture();
+		FeTexturePool::get_ref().release( m_texture );
 		delete m_movie;
 		m_movie = NULL;
 		return false;
@@ -450,7 +476,7 @@ bool FeTextureContainer::try_to_load(
 
 	if ( !file_exists( loaded_name ) )
 	{
-		m_texture = sf::Texture();
+		FeTexturePool::get_ref().release( m_texture );
 		return false;
 	}
 
@@ -459,9 +485,32 @@ bool FeTextureContainer::try_to_load(
 
 	m_file_name = loaded_name;
 
+	//
+	// Small images go into the texture atlas if it is enabled.  If the image
+	// is still there from when it was last shown then it is ready to draw now
+	//
+	unsigned int w = m_entry->get_width();
+	unsigned int h = m_entry->get_height();
+
+	if ( !m_no_atlas && !m_mipmap && FeTextureAtlas::is_candidate( w, h ))
+		m_slot = FeTextureAtlas::get_ref().acquire( loaded_name, w, h, m_smooth );
+
+	if ( m_slot )
+	{
+		FeTexturePool::get_ref().release( m_texture );
+
+		if ( !m_slot->loaded && data )
+			FeTextureAtlas::get_ref().update( m_slot, data );
+
+		if ( m_slot->loaded )
+			il.release_entry( &m_entry );
+
+		return true;
+	}
+
 	// resize our texture accordingly
 	if ( m_texture.getSize() != sf::Vector2u( m_entry->get_width(), m_entry->get_height() ))
-		std::ignore = m_texture.resize({ static_cast<unsigned int>( m_entry->get_width() ), static_cast<unsigned int>( m_entry->get_height() )});
+		FeTexturePool::get_ref().resize( m_texture, { static_cast<unsigned int>( m_entry->get_width() ), static_cast<unsigned int>( m_entry->get_height() )});
 
 	if ( data )
 	{
@@ -476,19 +525,52 @@ bool FeTextureContainer::try_to_load(
 
 const sf::Texture &FeTextureContainer::get_texture()
 {
+	if ( m_slot )
+		return FeTextureAtlas::get_ref().get_texture( m_slot );
+
 	return m_texture;
 }
 
+sf::FloatRect FeTextureContainer::get_texture_rect()
+{
+	if ( m_slot )
+		return sf::FloatRect( m_slot->rect );
+
+	return FeBaseTextureContainer::get_texture_rect();
+}
+
+void FeTextureContainer::disable_atlas()
+{
+	if ( m_no_atlas )
+		return;
+
+	m_no_atlas = true;
+	reload_image();
+}
+
+void FeTextureContainer::reload_image()
+{
+	if ( !m_slot )
+		return;
+
+	std::string name = m_file_name;
+	clear();
+	try_to_load( name, true );
+	notify_texture_change();
+}
+
 void FeTextureContainer::on_new_selection( FeSettings *feSettings )
 {
 	if (( m_type != IsStatic ) && ( m_art_update_trigger == ToNewSelection ))
 		internal_update_selection( feSettings );
 }
 
-void FeTextureContainer::on_new_list( FeSettings *feSettings, bool new_display )
+void FeTextureContainer::on_new_list( FeSettings *feSettings, bool )
 {
-	if ( new_display )
-		m_current_filter_index=-1;
+	// The rom we were showing may be at another index in the new list (or gone),
+	// so forget it.  The artwork is reloaded, and isn't handed off meanwhile
+	m_current_rom_index=-1;
+	m_current_filter_index=-1;
 
 	if (( m_type != IsStatic ) && ( m_art_update_trigger == EndNavigation ))
 		internal_update_selection( feSettings );
@@ -506,8 +588,8 @@ void FeTextureContainer::internal_update_selection( FeSettings *feSettings )
 	int rom_index = feSettings->get_rom_index( filter_index, m_index_offset );
 
 	//
-	// Optimization opportunity: We could already be showing the artwork for rom_index if the
-	// layout uses the image swap() function... if we are, then there is no need to do anything...
+	// We could already be showing the artwork for rom_index, either from before or
+	// because hand_off_artwork() gave it to us.  If we are there is nothing to do
 	//
 	if (( m_current_rom_index == rom_index )
 				&& ( m_current_filter_index == filter_index ))
@@ -577,7 +659,7 @@ void FeTextureContainer::internal_update_selection( FeSettings *feSettings )
 		if ( image_list.empty() )
 		{
 			clear();
-			m_texture = sf::Texture();
+			FeTexturePool::get_ref().release( m_texture );
 		}
 		else
 		{
@@ -600,6 +682,121 @@ void FeTextureContainer::internal_update_selection( FeSettings *feSettings )
 	notify_texture_change();
 }
 
+bool FeTextureContainer::can_hand_off( const FeTextureContainer &o ) const
+{
+	return ( m_type == IsArtwork ) && ( o.m_type == IsArtwork )
+		&& ( m_art_update_trigger == o.m_art_update_trigger )
+		&& ( m_filter_offset == o.m_filter_offset )
+		&& ( m_art_name == o.m_art_name )
+		&& ( m_video_flags == o.m_video_flags )
+		&& ( m_smooth == o.m_smooth )
+		&& ( m_mipmap == o.m_mipmap )
+		&& ( m_no_atlas == o.m_no_atlas )
+		&& ( m_fft_bands == o.m_fft_bands );
+}
+
+void FeTextureContainer::swap_content( FeTextureContainer &o )
+{
+	m_texture.swap( o.m_texture );
+	m_file_name.swap( o.m_file_name );
+	std::swap( m_current_rom_index, o.m_current_rom_index );
+	std::swap( m_current_filter_index, o.m_current_filter_index );
+	std::swap( m_movie, o.m_movie );
+	std::swap( m_movie_status, o.m_movie_status );
+	std::swap( m_entry, o.m_entry );
+	std::swap( m_slot, o.m_slot );
+	m_audio_effects.swap( o.m_audio_effects );
+
+#ifndef NO_MOVIE
+	// the videos now draw to the texture of the container they moved to
+	if ( m_movie )
+		m_movie->set_texture( &m_texture );
+
+	if ( o.m_movie )
+		o.m_movie->set_texture( &o.m_texture );
+#endif
+
+	notify_texture_change();
+	o.notify_texture_change();
+}
+
+void FeTextureContainer::hand_off_artwork(
+	const std::vector<FeBaseTextureContainer *> &pool,
+	FeSettings *feSettings,
+	int trigger )
+{
+	//
+	// Group the containers that can take each other's artwork
+	//
+	std::vector< std::vector<FeTextureContainer *> > groups;
+	for ( std::vector<FeBaseTextureContainer *>::const_iterator itr=pool.begin(); itr!=pool.end(); ++itr )
+	{
+		FeTextureContainer *t = (*itr)->get_derived_texture_container();
+		if ( !t || ( t->m_type != IsArtwork ) || ( t->m_art_update_trigger != trigger )
+				|| ( t->m_current_filter_index < 0 ))
+			continue;
+
+		size_t g=0;
+		while (( g < groups.size() ) && !groups[g].front()->can_hand_off( *t ))
+			g++;
+
+		if ( g == groups.size() )
+			groups.push_back( std::vector<FeTextureContainer *>() );
+
+		groups[g].push_back( t );
+	}
+
+	int moved=0;
+	for ( size_t g=0; g<groups.size(); g++ )
+	{
+		std::vector<FeTextureContainer *> &group = groups[g];
+		if ( group.size() < 2 )
+			continue;
+
+		int filter_index = feSettings->get_filter_index_from_offset( group.front()->m_filter_offset );
+
+		// the container showing each rom
+		std::map<int, FeTextureContainer *> showing;
+		for ( size_t i=0; i<group.size(); i++ )
+		{
+			if ( group[i]->m_current_filter_index == filter_index )
+				showing.insert( std::make_pair( group[i]->m_current_rom_index, group[i] ));
+		}
+
+		for ( size_t i=0; i<group.size(); i++ )
+		{
+			FeTextureContainer *t = group[i];
+			if ( t->m_current_filter_index != filter_index )
+				continue;
+
+			int rom_index = feSettings->get_rom_index( filter_index, t->m_index_offset );
+			if ( rom_index == t->m_current_rom_index )
+				continue;
+
+			std::map<int, FeTextureContainer *>::iterator its = showing.find( rom_index );
+			if ( its == showing.end() )
+				continue;
+
+			// leave it if the other container is going to keep showing it
+			FeTextureContainer *o = its->second;
+			if ( feSettings->get_rom_index( filter_index, o->m_index_offset ) == rom_index )
+				continue;
+
+			int old_index = t->m_current_rom_index;
+			t->swap_content( *o );
+
+			its->second = t;
+			showing[ old_index ] = o;
+			moved++;
+		}
+	}
+
+#ifdef FE_DEBUG
+	if ( moved )
+		FeDebug() << "Handed off artwork between " << moved << " container(s)" << std::endl;
+#endif
+}
+
 bool FeTextureContainer::tick( FeSettings *feSettings, bool play_movies )
 {
 	//
@@ -610,6 +807,13 @@ bool FeTextureContainer::tick( FeSettings *feSettings, bool play_movies )
 		FeImageLoader &il = FeImageLoader::get_ref();
 		if ( il.check_loaded( m_entry ) )
 		{
+			if ( m_slot )
+			{
+				FeTextureAtlas::get_ref().update( m_slot, m_entry->get_data() );
+				il.release_entry( &m_entry );
+				return true;
+			}
+
 			m_texture.update( m_entry->get_data() );
 			if ( m_mipmap ) std::ignore = m_texture.generateMipmap();
 			m_texture.setSmooth( m_smooth );
@@ -619,7 +823,7 @@ bool FeTextureContainer::tick( FeSettings *feSettings, bool play_movies )
 		}
 	}
 
-	m_audio_effects.update_all();
+	m_audio_effects->update_all();
 
 	if ( !play_movies || (m_video_flags & VF_DisableVideo) )
 		return false;
@@ -806,7 +1010,7 @@ void FeTextureContainer::load_file( const char *n )
 	if ( filename.empty() )
 	{
 		clear();
-		m_texture = sf::Texture();
+		FeTexturePool::get_ref().release( m_texture );
 		notify_texture_change();
 		return;
 	}
@@ -896,12 +1100,24 @@ void FeTextureContainer::clear()
 		FeImageLoader &il = FeImageLoader::get_ref();
 		il.release_entry( &m_entry );
 	}
+
+	if ( m_slot )
+	{
+		FeTextureAtlas::get_ref().release( m_slot );
+		m_slot = NULL;
+	}
 }
 
 void FeTextureContainer::set_smooth( bool s )
 {
+	bool changed = ( s != m_smooth );
+
 	m_smooth = s;
 	m_texture.setSmooth( s );
+
+	// atlas pages are either smooth or not, so move to a page that matches
+	if ( changed )
+		reload_image();
 }
 
 bool FeTextureContainer::get_smooth() const
@@ -912,6 +1128,9 @@ bool FeTextureContainer::get_smooth() const
 void FeTextureContainer::set_mipmap( bool m )
 {
 	m_mipmap = m;
+	if ( m_mipmap && m_slot )
+		reload_image();
+
 	if ( m_mipmap && !m_movie ) std::ignore = m_texture.generateMipmap();
 }
 
@@ -922,6 +1141,12 @@ bool FeTextureContainer::get_mipmap() const
 
 void FeTextureContainer::set_repeat( bool r )
 {
+	if ( r && !m_no_atlas )
+	{
+		m_no_atlas = true;
+		reload_image();
+	}
+
 	m_texture.setRepeated( r );
 }
 
@@ -1003,56 +1228,59 @@ void FeTextureContainer::release_audio( bool state )
 
 float FeTextureContainer::get_vu_mono() const
 {
-	auto* visualiser = m_audio_effects.get_effect<FeAudioVisualiser>();
+	auto* visualiser = m_audio_effects->get_effect<FeAudioVisualiser>();
 	return visualiser ? visualiser->get_vu_mono() : 0.0f;
 }
 
 float FeTextureContainer::get_vu_left() const
 {
-	auto* visualiser = m_audio_effects.get_effect<FeAudioVisualiser>();
+	auto* visualiser = m_audio_effects->get_effect<FeAudioVisualiser>();
 	return visualiser ? visualiser->get_vu_left() : 0.0f;
 }
 
 float FeTextureContainer::get_vu_right() const
 {
-	auto* visualiser = m_audio_effects.get_effect<FeAudioVisualiser>();
+	auto* visualiser = m_audio_effects->get_effect<FeAudioVisualiser>();
 	return visualiser ? visualiser->get_vu_right() : 0.0f;
 }
 
 const std::vector<float> *FeTextureContainer::get_fft_mono_ptr() const
 {
-	auto* visualiser = m_audio_effects.get_effect<FeAudioVisualiser>();
+	auto* visualiser = m_audio_effects->get_effect<FeAudioVisualiser>();
 	return visualiser ? visualiser->get_fft_mono_ptr() : nullptr;
 }
 
 const std::vector<float> *FeTextureContainer::get_fft_left_ptr() const
 {
-	auto* visualiser = m_audio_effects.get_effect<FeAudioVisualiser>();
+	auto* visualiser = m_audio_effects->get_effect<FeAudioVisualiser>();
 	return visualiser ? visualiser->get_fft_left_ptr() : nullptr;
 }
 
 const std::vector<float> *FeTextureContainer::get_fft_right_ptr() const
 {
-	auto* visualiser = m_audio_effects.get_effect<FeAudioVisualiser>();
+	auto* visualiser = m_audio_effects->get_effect<FeAudioVisualiser>();
 	return visualiser ? visualiser->get_fft_right_ptr() : nullptr;
 }
 
+FeAudioVisualiser *FeTextureContainer::get_audio_visualiser() const
+{
+	return m_audio_effects->get_effect<FeAudioVisualiser>();
+}
+
 FeSurfaceTextureContainer::FeSurfaceTextureContainer( int width, int height )
 	: m_clear( true ),
 	m_redraw( true ),
-	m_mipmap( false )
+	m_mipmap( false ),
+	m_antialiasing( 0 )
 {
-	sf::ContextSettings ctx;
 	FePresent *fep = FePresent::script_get_fep();
 	if ( fep )
 	{
 		FeSettings *fes = fep->get_fes();
-		if ( fes ) ctx.antiAliasingLevel = fes->get_antialiasing();
+		if ( fes ) m_antialiasing = fes->get_antialiasing();
 	}
-	if (( width > 0 )
-		&& ( height > 0 )
-		&& m_texture.resize({ static_cast<unsigned int>(width), static_cast<unsigned int>(height) }, ctx ) )
-		m_texture.clear( sf::Color::Transparent );
+	if (( width > 0 ) && ( height > 0 ))
+		FeTexturePool::get_ref().resize( m_texture, { static_cast<unsigned int>(width), static_cast<unsigned int>(height) }, m_antialiasing );
 }
 
 FeSurfaceTextureContainer::~FeSurfaceTextureContainer()
@@ -1063,6 +1291,8 @@ FeSurfaceTextureContainer::~FeSurfaceTextureContainer()
 		elements.pop_back();
 		delete p;
 	}
+
+	FeTexturePool::get_ref().release( m_texture, m_antialiasing );
 }
 
 const sf::Texture &FeSurfaceTextureContainer::get_texture()
@@ -1256,7 +1486,12 @@ FeImage::~FeImage() {}
 const sf::Texture *FeImage::get_texture()
 {
 	if ( m_tex )
+	{
+		// the texture is being handed to a shader, which needs the image on
+		// its own texture rather than an atlas page
+		m_tex->disable_atlas();
 		return &(m_tex->get_texture());
+	}
 	else
 		return NULL;
 }
@@ -1278,8 +1513,7 @@ void FeImage::texture_changed( FeBaseTextureContainer *new_tex )
 	m_sprite.setTexture( m_tex->get_texture() );
 
 	//  reset texture rect now to the one reported by the new texture object
-	m_sprite.setTextureRect(
-		sf::FloatRect({ 0, 0 }, { static_cast<float>( m_tex->get_texture().getSize().x ), static_cast<float>( m_tex->get_texture().getSize().y )}));
+	m_sprite.setTextureRect( m_tex->get_texture_rect() );
 
 	scale();
 }
@@ -1319,15 +1553,27 @@ bool FeImage::fix_masked_image()
 	return m_tex->fix_masked_image();
 }
 
+void FeImage::script_set_shader( FeShader *sh )
+{
+	// shaders expect texture coordinates for the whole image texture
+	if ( sh && ( sh->get_type() != FeShader::Empty ))
+		m_tex->disable_atlas();
+
+	FeBasePresentable::script_set_shader( sh );
+}
+
 
 void FeImage::draw(sf::RenderTarget& target, sf::RenderStates states) const
 {
 	FeShader *s = get_shader();
 	if ( s )
 	{
+		// Draw with the blend mode's shader until a background compile is done
 		const sf::Shader *sh = s->get_shader();
 		if ( sh )
 			states.shader = sh;
+		else if ( s->is_compiling() )
+			states.shader = FeBlend::get_default_shader( m_blend_mode, true );
 	}
 	else
 		states.shader = FeBlend::get_default_shader( m_blend_mode, true );
@@ -1604,16 +1850,41 @@ void FeImage::setColor( sf::Color c )
 
 sf::Vector2u FeImage::getTextureSize() const
 {
-	return m_tex->get_texture().getSize();
+	return sf::Vector2u( m_tex->get_texture_rect().size );
 }
 
+//
+// The texture rect is reported relative to the image, which is offset from
+// the texture origin if the image is in the texture atlas
+//
 sf::FloatRect FeImage::getTextureRect() const
 {
-	return m_sprite.getTextureRect();
+	sf::FloatRect r = m_sprite.getTextureRect();
+	r.position -= m_tex->get_texture_rect().position;
+	return r;
 }
 
-void FeImage::setTextureRect( const sf::FloatRect &r )
+void FeImage::setTextureRect( const sf::FloatRect &in )
 {
+	sf::FloatRect r = in;
+	sf::FloatRect img = m_tex->get_texture_rect();
+	if ( img.position != sf::Vector2f( 0, 0 ))
+	{
+		// a rect that reaches outside the image would show its atlas neighbours
+		float x1 = std::min( r.position.x, r.position.x + r.size.x );
+		float x2 = std::max( r.position.x, r.position.x + r.size.x );
+		float y1 = std::min( r.position.y, r.position.y + r.size.y );
+		float y2 = std::max( r.position.y, r.position.y + r.size.y );
+
+		if (( x1 < 0 ) || ( y1 < 0 ) || ( x2 > img.size.x ) || ( y2 > img.size.y ))
+		{
+			m_tex->disable_atlas();
+			img = m_tex->get_texture_rect();
+		}
+
+		r.position += img.position;
+	}
+
 	if ( r != m_sprite.getTextureRect() )
 	{
 		m_sprite.setTextureRect( r );
@@ -2279,6 +2550,12 @@ const SqratArrayWrapper& FeImage::get_fft_array_right() const
 	return m_fft_zero_wrapper;
 }
 
+FeAudioVisualiser *FeImage::get_audio_visualiser() const
+{
+	FeTextureContainer *tc = dynamic_cast<FeTextureContainer*>( m_tex );
+	return tc ? tc->get_audio_visualiser() : nullptr;
+}
+
 void FeImage::transition_swap( FeImage *o )
 {
 	// if we're pointing at the same texture, don't do anything
@@ -40,6 +40,7 @@ class FeListBox;
 class FeRectangle;
 class FeTextureContainer;
 class FeImageLoaderEntry;
+struct FeAtlasSlot;
 
 enum FeVideoFlags
 {
@@ -57,6 +58,14 @@ public:
 
 	virtual const sf::Texture &get_texture()=0;
 
+	// The area of get_texture() that holds the image.  This is the whole
+	// texture unless the image has been packed into a texture atlas
+	virtual sf::FloatRect get_texture_rect();
+
+	// Stop using the texture atlas for this image (i.e. when a shader needs
+	// texture coordinates that cover the whole texture)
+	virtual void disable_atlas();
+
 	virtual void on_new_selection( FeSettings *feSettings )=0;
 	virtual void on_end_navigation( FeSettings *feSettings )=0;
 
@@ -147,12 +156,26 @@ public:
 	~FeTextureContainer();
 
 	const sf::Texture &get_texture();
+	sf::FloatRect get_texture_rect();
+	void disable_atlas();
 	bool get_visible() const;
 
 	void on_new_selection( FeSettings *feSettings );
 	void on_end_navigation( FeSettings *feSettings );
 	void on_new_list( FeSettings *, bool );
 
+	//
+	// Artwork containers that only differ in their index offset (i.e. a wheel)
+	// form a sliding window over the list.  Before the containers with the
+	// given update trigger are updated, this passes each loaded image or video
+	// on to the container that is going to show it, so that only artwork new
+	// to the window needs to be loaded.  Videos keep playing as they move.
+	// Only used when the selection moves, a new list forgets what is showing.
+	//
+	static void hand_off_artwork( const std::vector<FeBaseTextureContainer *> &pool,
+		FeSettings *feSettings,
+		int trigger );
+
 	bool tick( FeSettings *feSettings, bool play_movies ); // returns true if redraw required
 	void set_play_state( bool play );
 	bool get_play_state() const;
@@ -203,10 +226,11 @@ public:
 	const std::vector<float> *get_fft_mono_ptr() const;
 	const std::vector<float> *get_fft_left_ptr() const;
 	const std::vector<float> *get_fft_right_ptr() const;
+	FeAudioVisualiser *get_audio_visualiser() const;
 
 	float get_sample_aspect_ratio() const;
 
-	FeAudioEffectsManager& get_audio_effects() { return m_audio_effects; };
+	FeAudioEffectsManager& get_audio_effects() { return *m_audio_effects; };
 	FeMedia *get_media() const;
 	int get_type() const;
 	bool get_magic() const;
@@ -227,7 +251,10 @@ private:
 		bool is_image=false );
 
 	void internal_update_selection( FeSettings *feSettings );
+	bool can_hand_off( const FeTextureContainer &o ) const;
+	void swap_content( FeTextureContainer &o );
 	void clear();
+	void reload_image(); // reload the current image, i.e. after m_no_atlas changes
 
 	sf::Texture m_texture;
 
@@ -250,7 +277,9 @@ private:
 	float m_pan;
 	int m_fft_bands;
 	FeImageLoaderEntry *m_entry;
-	FeAudioEffectsManager m_audio_effects;
+	FeAtlasSlot *m_slot; // set if the image is in the texture atlas
+	bool m_no_atlas;
+	std::unique_ptr<FeAudioEffectsManager> m_audio_effects; // on the heap so it can move with m_movie
 };
 
 class FeSurfaceTextureContainer : public FeBaseTextureContainer, public FePresentableParent
@@ -292,6 +321,7 @@ private:
 	bool m_clear;
 	bool m_redraw;
 	bool m_mipmap;
+	unsigned int m_antialiasing;
 };
 
 class FeImage : public sf::Drawable, public FeBasePresentable
@@ -324,6 +354,7 @@ public:
 
 	void transition_swap( FeImage * );
 	bool fix_masked_image();
+	void script_set_shader( FeShader *s );
 	FePresentableParent *get_presentable_parent();
 	const sf::Drawable &drawable() const { return (const sf::Drawable &)*this; };
 
@@ -389,6 +420,7 @@ public:
 	const SqratArrayWrapper& get_fft_array_mono() const;
 	const SqratArrayWrapper& get_fft_array_left() const;
 	const SqratArrayWrapper& get_fft_array_right() const;
+	FeAudioVisualiser *get_audio_visualiser() const;
 	void set_fft_bands( int count );
 	int get_fft_bands() const;
 
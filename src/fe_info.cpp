@@ -24,12 +24,27 @@
 #include "fe_util.hpp"
 #include "fe_util_sq.hpp"
 #include "fe_cache.hpp"
+#include "path_cache.hpp"
+#include "nowide/cstdio.hpp"
 #include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <ctime>
 
 #include <iomanip>
+#include <thread>
+#include <atomic>
+
+#include <SFML/Config.hpp>
+
+#ifdef SFML_SYSTEM_WINDOWS
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 
 const char *FE_STAT_FILE_EXTENSION = ".stat";
 const char FE_TAGS_SEP = ';';
@@ -118,16 +133,240 @@ const std::vector<FeRomInfo::Index> FeRomInfo::Stats = {
 	FeRomInfo::Votes
 };
 
+namespace
+{
+	const char FE_COLD_MAGIC[] = { 'A', 'M', 'C', 'F' };
+	const size_t FE_COLD_LRU_SIZE = 64;
+	const size_t FE_STATS_MAX_PENDING = 64;
+
+	//
+	// Write a stat file and sync it to disk, so stats survive a power cut
+	// soon after a game (the caches can be rebuilt from these files).  The
+	// content goes to a temporary file that replaces the original once it is
+	// safely written, so a failed write never leaves a truncated stat file
+	//
+	bool write_stat_file( const std::string &filename, const std::string &content )
+	{
+		std::string temp = filename + ".tmp";
+
+		FILE *f = nowide::fopen( temp.c_str(), "w" );
+		if ( !f )
+		{
+			FeLog() << "Error writing stat file: " << filename << std::endl;
+			return false;
+		}
+
+		bool ok = ( fwrite( content.data(), 1, content.size(), f ) == content.size() )
+			&& ( fflush( f ) == 0 );
+#ifdef SFML_SYSTEM_WINDOWS
+		ok = ok && ( _commit( _fileno( f ) ) == 0 );
+#else
+		ok = ok && ( fsync( fileno( f ) ) == 0 );
+#endif
+		ok = ( fclose( f ) == 0 ) && ok;
+
+#ifdef SFML_SYSTEM_WINDOWS
+		ok = ok && MoveFileExW( FeUtil::widen( temp ).c_str(), FeUtil::widen( filename ).c_str(),
+			MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH );
+#else
+		ok = ok && ( nowide::rename( temp.c_str(), filename.c_str() ) == 0 );
+#endif
+
+		if ( !ok )
+		{
+			FeLog() << "Error writing stat file: " << filename << std::endl;
+			delete_file( temp );
+		}
+
+		return ok;
+	}
+}
+
+FeStatsWriter &FeStatsWriter::get_ref()
+{
+	static FeStatsWriter writer;
+	return writer;
+}
+
+FeStatsWriter::FeStatsWriter()
+	: m_busy( false ),
+	m_stop( false )
+{
+}
+
+FeStatsWriter::~FeStatsWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_stop = true;
+	}
+
+	m_queued.notify_one();
+	if ( m_thread.joinable() )
+		m_thread.join();
+}
+
+void FeStatsWriter::queue( const std::string &key, std::function<void()> job )
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+
+	if ( !m_thread.joinable() )
+		m_thread = std::thread( &FeStatsWriter::run, this );
+
+	m_written.wait( lock, [&]{
+		return ( m_pending.size() < FE_STATS_MAX_PENDING ) || ( m_pending.count( key ) > 0 );
+	});
+
+	m_pending[ key ] = job;
+	m_queued.notify_one();
+}
+
+void FeStatsWriter::flush()
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	m_written.wait( lock, [this]{ return m_pending.empty() && !m_busy; } );
+}
+
+void FeStatsWriter::run()
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+	while ( true )
+	{
+		m_queued.wait( lock, [this]{ return m_stop || !m_pending.empty(); } );
+		if ( m_pending.empty() )
+			break;
+
+		std::map<std::string, std::function<void()>> jobs;
+		jobs.swap( m_pending );
+		m_busy = true;
+
+		lock.unlock();
+		m_written.notify_all();
+
+		for ( std::map<std::string, std::function<void()>>::iterator itr=jobs.begin(); itr!=jobs.end(); ++itr )
+			itr->second();
+
+		lock.lock();
+		m_busy = false;
+		m_written.notify_all();
+	}
+}
+
+FeRomColdStore::FeRomColdStore( const std::string &path, std::uint64_t stamp )
+	: m_path( path ),
+	m_stamp( stamp )
+{
+}
+
+bool FeRomColdStore::open( nowide::ifstream &file ) const
+{
+	file.open( m_path, std::ios::binary );
+	if ( !file.is_open() )
+		return false;
+
+	char magic[ sizeof( FE_COLD_MAGIC ) ];
+	std::uint64_t stamp( 0 );
+	file.read( magic, sizeof( magic ) );
+	file.read( (char *)&stamp, sizeof( stamp ) );
+
+	return file.good()
+		&& ( memcmp( magic, FE_COLD_MAGIC, sizeof( magic ) ) == 0 )
+		&& ( stamp == m_stamp );
+}
+
+bool FeRomColdStore::read( nowide::ifstream &file, std::int64_t offset, std::string &value )
+{
+	std::uint32_t len( 0 );
+	file.seekg( offset );
+	file.read( (char *)&len, sizeof( len ) );
+	if ( !file.good() )
+		return false;
+
+	value.resize( len );
+	if ( len > 0 )
+		file.read( &value[0], len );
+
+	if ( file.good() )
+		return true;
+
+	file.clear();
+	value.clear();
+	return false;
+}
+
+bool FeRomColdStore::open()
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+
+	if ( m_file.is_open() )
+		return true;
+
+	if ( open( m_file ) )
+		return true;
+
+	m_file.close();
+	return false;
+}
+
+const std::string &FeRomColdStore::fetch( std::int64_t offset )
+{
+	std::lock_guard<std::mutex> lock( m_mutex );
+
+	auto itr = m_lru_map.find( offset );
+	if ( itr != m_lru_map.end() )
+	{
+		m_lru.splice( m_lru.begin(), m_lru, itr->second );
+		return itr->second->second;
+	}
+
+	m_lru.emplace_front( offset, std::string() );
+
+	if ( !m_file.is_open() && !open( m_file ) )
+		m_file.close();
+
+	if ( !m_file.is_open() || !read( m_file, offset, m_lru.front().second ) )
+		FeLog() << "Error reading romlist extra info: " << m_path << std::endl;
+
+	m_lru_map[ offset ] = m_lru.begin();
+
+	if ( m_lru.size() > FE_COLD_LRU_SIZE )
+	{
+		m_lru_map.erase( m_lru.back().first );
+		m_lru.pop_back();
+	}
+
+	return m_lru.front().second;
+}
+
+void FeRomColdStore::write_header( std::ostream &out, std::uint64_t stamp )
+{
+	out.write( FE_COLD_MAGIC, sizeof( FE_COLD_MAGIC ) );
+	out.write( (const char *)&stamp, sizeof( stamp ) );
+}
+
+std::int64_t FeRomColdStore::write_record( std::ostream &out, const std::string &value )
+{
+	std::int64_t offset = out.tellp();
+	std::uint32_t len = value.size();
+	out.write( (const char *)&len, sizeof( len ) );
+	out.write( value.data(), len );
+	return offset;
+}
+
 FeRomInfo::FeRomInfo():
+	index( -1 ),
 	m_display_title(""),
-	m_sort_title("")
+	m_sort_title(""),
+	m_cold_offset( -1 )
 {
 	m_info = std::vector<std::string>(LAST_INDEX);
 }
 
 FeRomInfo::FeRomInfo( const std::string &rn ):
+	index( -1 ),
 	m_display_title(""),
-	m_sort_title("")
+	m_sort_title(""),
+	m_cold_offset( -1 )
 {
 	m_info = std::vector<std::string>(LAST_INDEX);
 	m_info[Romname] = rn;
@@ -158,25 +397,35 @@ const bool FeRomInfo::isStat( Index index )
 
 const std::string &FeRomInfo::get_info( int i ) const
 {
+	if ( m_cold && isCold( (Index)i ) )
+		return m_cold->fetch( m_cold_offset );
+
 	return m_info[i];
 }
 
 std::string FeRomInfo::get_info_escaped( int i ) const
 {
-	if ( m_info[i].find_first_of( ';' ) != std::string::npos )
+	const std::string &v = get_info( i );
+	if ( v.find_first_of( ';' ) != std::string::npos )
 	{
-		std::string temp = m_info[i];
+		std::string temp = v;
 		perform_substitution( temp, "\"", "\\\"" );
 		return ( "\"" + temp + "\"" );
 	}
 	else
-		return m_info[i];
+		return v;
 }
 
 void FeRomInfo::set_info( Index i, const std::string &v )
 {
 	m_info[i] = v;
 
+	if ( isCold( i ) )
+	{
+		m_cold_offset = -1;
+		m_cold.reset();
+	}
+
 	if ( i == Title ) {
 		m_display_title = FeRomTitleFormatter::get_display_title( v );
 		m_sort_title = FeRomTitleFormatter::get_sort_title( v );
@@ -339,25 +588,25 @@ bool FeRomInfo::save_stats( const std::string &path )
 	// Save stats to cache, and continue to save original stat file as well
 	FeCache::set_stats_info( path, m_info );
 
-	confirm_directory( path, m_info[Emulator] );
-	std::string filename = path + m_info[Emulator] + "/" + m_info[Romname] + FE_STAT_FILE_EXTENSION;
-	nowide::ofstream myfile( filename.c_str() );
+	std::string emulator = m_info[Emulator];
+	std::string filename = path + emulator + "/" + m_info[Romname] + FE_STAT_FILE_EXTENSION;
 
-	if ( !myfile.is_open() )
+	// NOTE: this order must match `load_stats` order
+	std::string content = m_info[PlayedCount] + "\n"
+		+ m_info[PlayedTime] + "\n"
+		+ m_info[PlayedLast] + "\n"
+		+ m_info[Score] + "\n"
+		+ m_info[Votes] + "\n"
+		+ m_info[PlayedSession] + "\n"
+		+ m_info[PlayedLongest] + "\n";
+
+	// The file is written in the background, the in-memory stats are already current
+	FeStatsWriter::get_ref().queue( filename, [path, emulator, filename, content]()
 	{
-		FeLog() << "Error writing stat file: " << filename << std::endl;
-		return false;
-	}
+		confirm_directory( path, emulator );
+		write_stat_file( filename, content );
+	});
 
-	// NOTE: this order must match `load_stats` order
-	myfile << m_info[PlayedCount] << std::endl
-		<< m_info[PlayedTime] << std::endl
-		<< m_info[PlayedLast] << std::endl
-		<< m_info[Score] << std::endl
-		<< m_info[Votes] << std::endl
-		<< m_info[PlayedSession] << std::endl
-		<< m_info[PlayedLongest] << std::endl;
-	myfile.close();
 	return true;
 }
 
@@ -394,11 +643,32 @@ void FeRomInfo::clear()
 	m_sort_title.clear();
 	for ( int i=0; i < LAST_INDEX; i++ )
 		m_info[i].clear();
+
+	m_cold_offset = -1;
+	m_cold.reset();
 }
 
 void FeRomInfo::copy_info( const FeRomInfo &src, Index idx )
 {
-	set_info( idx, src.m_info[idx] );
+	set_info( idx, src.get_info( idx ) );
+}
+
+void FeRomInfo::set_cold( std::int64_t offset, const std::shared_ptr<FeRomColdStore> &store )
+{
+	m_cold_offset = offset;
+	m_cold = store;
+
+	if ( store )
+		std::string().swap( m_info[Extra] );
+}
+
+bool FeRomInfo::load_cold( nowide::ifstream &file )
+{
+	m_cold.reset();
+	if ( m_cold_offset < 0 )
+		return true;
+
+	return FeRomColdStore::read( file, m_cold_offset, m_info[Extra] );
 }
 
 bool FeRomInfo::operator==( const FeRomInfo &o ) const
@@ -416,7 +686,7 @@ bool FeRomInfo::full_comparison( const FeRomInfo &o ) const
 {
 	for ( int i=0; i<LAST_INFO; i++ )
 	{
-		if ( m_info[i].compare( o.m_info[i] ) != 0 )
+		if ( get_info( i ).compare( o.get_info( i ) ) != 0 )
 			return false;
 	}
 
@@ -1408,6 +1678,12 @@ std::string FeEmulatorInfo::vector_to_string( const std::vector< std::string > &
 	return ret_str;
 }
 
+namespace
+{
+	// Most rom paths that are read at once, the rest wait for a free thread
+	const size_t MAX_SCAN_THREADS = 4;
+};
+
 void FeEmulatorInfo::gather_rom_names( std::vector<std::string> &name_list ) const
 {
 	std::vector< std::string > ignored;
@@ -1418,40 +1694,86 @@ void FeEmulatorInfo::gather_rom_names(
 	std::vector<std::string> &name_list,
 	std::vector<std::string> &full_path_list ) const
 {
+	std::vector<std::string> paths;
 	for ( std::vector<std::string>::const_iterator itr=m_paths.begin();
 			itr!=m_paths.end(); ++itr )
+		paths.push_back( clean_path_with_wd( *itr, true ) );
+
+	// Each rom path is listed once (or not at all if it is unchanged since
+	// the last scan), paths are read concurrently since they are often on
+	// separate (and slow) devices.  A few threads share the paths between
+	// them, however many there are
+	std::vector<FeDirSnapshot::Listing> listings( paths.size() );
+	if ( paths.size() > 1 )
 	{
-		std::string path = clean_path_with_wd( *itr, true );
+		std::atomic<size_t> next( 0 );
+		auto worker = [&paths, &listings, &next]()
+		{
+			size_t i;
+			while (( i = next++ ) < paths.size() )
+				listings[i] = FeDirSnapshot::get( paths[i] );
+		};
+
+		std::vector<std::thread> threads;
+		for ( size_t i=0; i < std::min( paths.size(), MAX_SCAN_THREADS ); i++ )
+			threads.emplace_back( worker );
+
+		for ( std::vector<std::thread>::iterator itt=threads.begin(); itt!=threads.end(); ++itt )
+			(*itt).join();
+	}
+	else if ( !paths.empty() )
+		listings[0] = FeDirSnapshot::get( paths[0] );
 
-		for ( std::vector<std::string>::const_iterator ite = m_extensions.begin();
-				ite != m_extensions.end(); ++ite )
+	for ( size_t i=0; i < paths.size(); i++ )
+	{
+		const std::string &path = paths[i];
+
+		// Match every extension in a single pass over the listing, results
+		// are kept per-extension so that the output order is unchanged
+		std::vector< std::vector<std::string> > matches( m_extensions.size() );
+
+		for ( std::vector<FeDirSnapshot::Entry>::const_iterator itn=listings[i]->begin();
+				itn != listings[i]->end(); ++itn )
 		{
-			std::vector<std::string> temp_list;
-			std::vector<std::string>::iterator itn;
+			const std::string &what = (*itn).name;
 
-			if ( (*ite).compare( FE_DIR_TOKEN ) == 0 )
+			for ( size_t j=0; j < m_extensions.size(); j++ )
 			{
-				get_subdirectories( temp_list, path );
+				const std::string &ext = m_extensions[j];
+				std::vector<std::string> &temp_list = matches[j];
 
-				for ( itn = temp_list.begin(); itn != temp_list.end(); ++itn )
+				if ( ext.compare( FE_DIR_TOKEN ) == 0 )
 				{
-					full_path_list.push_back( path + *itn );
-					name_list.push_back( std::string() );
-					name_list.back().swap( *itn );
+					if ( (*itn).is_dir )
+						temp_list.push_back( what );
 				}
-			}
-			else
-			{
-				get_basename_from_extension( temp_list, path, (*ite), true );
-
-				for ( itn = temp_list.begin(); itn != temp_list.end(); ++itn )
+				else if ( tail_compare( what, ext ) )
 				{
-					full_path_list.push_back( path + *itn + *ite );
-					name_list.push_back( std::string() );
-					name_list.back().swap( *itn );
+					if ( what.size() > ext.size() )
+					{
+						std::string bname = what.substr( 0, what.size() - ext.size() );
+
+						// don't add duplicates, example: foo.zip and foo.ZIP
+						if ( temp_list.empty() || ( bname.compare( temp_list.back() ) != 0 ))
+							temp_list.push_back( bname );
+					}
+					else
+						temp_list.push_back( what );
 				}
 			}
 		}
+
+		for ( size_t j=0; j < m_extensions.size(); j++ )
+		{
+			bool is_dir = ( m_extensions[j].compare( FE_DIR_TOKEN ) == 0 );
+
+			for ( std::vector<std::string>::iterator itn = matches[j].begin(); itn != matches[j].end(); ++itn )
+			{
+				full_path_list.push_back( is_dir ? path + *itn : path + *itn + m_extensions[j] );
+				name_list.push_back( std::string() );
+				name_list.back().swap( *itn );
+			}
+		}
 	}
 }
 
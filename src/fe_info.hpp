@@ -28,6 +28,13 @@
 #include <map>
 #include <set>
 #include <vector>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+#include <unordered_map>
 #include "nowide/fstream.hpp"
 #include "cereal/cereal.hpp"
 #include <regex>
@@ -90,6 +97,81 @@ public:
 	}
 };
 
+//
+// Segment file holding the "cold" romlist fields (only Extra at present)
+// that are rarely read but can be long.  Roms keep an offset into the file
+// and fetch the value when asked for it.  Recently fetched values are kept
+// in a small LRU so references handed out by get_info() stay valid.  Each
+// segment is written once under a new name and the store keeps its file open,
+// so a newer segment never pulls the data out from under older roms
+//
+class FeRomColdStore
+{
+public:
+	FeRomColdStore( const std::string &path, std::uint64_t stamp );
+
+	const std::string &get_path() const { return m_path; }
+	std::uint64_t get_stamp() const { return m_stamp; }
+
+	// Open the segment file for reading, fails if the stamp doesn't match
+	bool open( nowide::ifstream &file ) const;
+
+	// Open the store's own file used by fetch()
+	bool open();
+
+	// Read the record at offset from a file returned by open()
+	static bool read( nowide::ifstream &file, std::int64_t offset, std::string &value );
+
+	// Read the record at offset through the LRU (thread safe)
+	const std::string &fetch( std::int64_t offset );
+
+	static void write_header( std::ostream &out, std::uint64_t stamp );
+	static std::int64_t write_record( std::ostream &out, const std::string &value );
+
+private:
+	typedef std::list< std::pair<std::int64_t, std::string> > LruList;
+
+	std::string m_path;
+	std::uint64_t m_stamp;
+	std::mutex m_mutex;
+	nowide::ifstream m_file;
+	LruList m_lru;
+	std::unordered_map<std::int64_t, LruList::iterator> m_lru_map;
+};
+
+//
+// Writes rom stats on a background thread so returning from a game doesn't
+// wait on the disk.  A write queued under the same key as a pending one
+// replaces it, and queue() blocks while the queue is full
+//
+class FeStatsWriter
+{
+public:
+	static FeStatsWriter &get_ref();
+	~FeStatsWriter();
+
+	void queue( const std::string &key, std::function<void()> job );
+
+	// Wait until every queued write is done, call before exiting or before
+	// reading stats back from disk
+	void flush();
+
+private:
+	FeStatsWriter();
+	FeStatsWriter( const FeStatsWriter & );
+	FeStatsWriter &operator=( const FeStatsWriter & );
+
+	void run();
+
+	std::mutex m_mutex;
+	std::condition_variable m_queued;
+	std::condition_variable m_written;
+	std::map<std::string, std::function<void()>> m_pending;
+	std::thread m_thread;
+	bool m_busy;
+	bool m_stop;
+};
+
 //
 // Class for storing information regarding a specific rom
 //
@@ -207,21 +289,39 @@ public:
 	bool operator==( const FeRomInfo & ) const;      // compares romname and emulator only
 	bool operator!=( const FeRomInfo & ) const;      // compares romname and emulator only
 	bool full_comparison( const FeRomInfo & ) const; // compares all fields that get loaded from the romlist file
-	int index; // Stores the m_list index, after global_filter applied
+	int index; // Dense id of the rom in its FeRomList (m_list position after the global filter), -1 if none
+
+	// Cold fields are kept in a FeRomColdStore segment rather than in memory
+	static bool isCold( Index index ) { return index == Extra; }
+
+	// Record that the cold fields were written to a segment at offset.  If
+	// store is set they are dropped from memory and fetched from it on demand
+	void set_cold( std::int64_t offset, const std::shared_ptr<FeRomColdStore> &store );
+	std::int64_t get_cold_offset() const { return m_cold_offset; }
+
+	// Read the cold fields back into memory from an open segment file
+	bool load_cold( nowide::ifstream &file );
 
 	// Save only the romlist info values (not the late-loaded stats data)
+	// Cold fields that live in a segment are saved as their offset
 	template<class Archive>
 	void save(Archive &archive, std::uint32_t const version) const
 	{
 		if ( version != FE_CACHE_VERSION ) throw "Invalid FeRomInfo cache";
-		archive( std::vector<std::string>( m_info.begin(), m_info.begin() + LAST_INFO ), index );
+		std::vector<std::string> info( m_info.begin(), m_info.begin() + LAST_INFO );
+		if ( m_cold_offset >= 0 )
+			info[ Extra ].clear();
+
+		archive( info, index, m_cold_offset );
 	}
 
 	template<class Archive>
 	void load(Archive &archive, std::uint32_t const version)
 	{
 		if ( version != FE_CACHE_VERSION ) throw "Invalid FeRomInfo cache";
-		archive( m_info, index );
+		archive( m_info, index, m_cold_offset );
+		m_info.resize( LAST_INDEX );
+		m_cold.reset();
 		m_display_title = FeRomTitleFormatter::get_display_title( m_info[ Title ] );
 		m_sort_title = FeRomTitleFormatter::get_sort_title( m_info[ Title ] );
 	}
@@ -236,6 +336,8 @@ private:
 	std::vector<std::string> m_info;
 	std::string m_display_title;
 	std::string m_sort_title;
+	std::int64_t m_cold_offset; // offset of the cold fields record, -1 if none
+	std::shared_ptr<FeRomColdStore> m_cold; // set while the cold fields are not in memory
 };
 
 CEREAL_CLASS_VERSION( FeRomInfo, FE_CACHE_VERSION );
@@ -22,32 +22,177 @@
 
 #include "fe_net.hpp"
 #include "fe_base.hpp"
+#include "fe_util.hpp"
 #include "nowide/fstream.hpp"
+#include "nowide/cstdio.hpp"
+#include "nowide/stat.hpp"
 #include "rapidjson/document.h"
 #include <iostream>
 #include <cstring>
 #include <chrono>
+#include <list>
+#include <algorithm>
 
 #include <curl/curl.h>
 
-static size_t write_curl_callback( void *contents, size_t size, size_t nmemb, void *userp )
+//
+// Where a transfer's data goes: buffer tasks collect it in memory, file
+// tasks write it straight to the ".part" file.  The url a ".part" file is
+// downloaded from is kept next to it in a ".part.url" file, so a partial
+// download is only ever resumed from the same url
+//
+struct FeNetSink
 {
-	size_t add_size = size * nmemb;
+	std::vector<char> buff;
+	nowide::ofstream file;
+	std::string part_name;
+	std::string url;
+	curl_off_t offset=0; // size of the ".part" file when the transfer started
+	CURL *handle=NULL;
+};
+
+namespace
+{
+	const char *PART_EXT = ".part";
+	const char *PART_URL_EXT = ".url";
 
-	std::vector<char> *mem = (std::vector<char> *)userp;
-	size_t old_size = mem->size();
+	std::string read_part_url( const std::string &part_name )
+	{
+		nowide::ifstream f( ( part_name + PART_URL_EXT ).c_str(), std::ios_base::binary );
+		std::string url;
+		std::getline( f, url );
+		return url;
+	}
 
-	mem->resize( old_size + add_size );
-	memcpy( &((*mem)[old_size]), contents, add_size );
+	bool write_part_url( const std::string &part_name, const std::string &url )
+	{
+		nowide::ofstream f( ( part_name + PART_URL_EXT ).c_str(), std::ios_base::binary | std::ios_base::trunc );
+		f << url;
+		return f.good();
+	}
 
-	return add_size;
-}
+	void delete_part( const std::string &part_name )
+	{
+		delete_file( part_name );
+		delete_file( part_name + PART_URL_EXT );
+	}
+
+	size_t write_curl_callback( void *contents, size_t size, size_t nmemb, void *userp )
+	{
+		size_t add_size = size * nmemb;
+
+		std::vector<char> *mem = &((FeNetSink *)userp)->buff;
+		size_t old_size = mem->size();
+
+		mem->resize( old_size + add_size );
+		memcpy( &((*mem)[old_size]), contents, add_size );
+
+		return add_size;
+	}
+
+	size_t write_file_callback( void *contents, size_t size, size_t nmemb, void *userp )
+	{
+		size_t add_size = size * nmemb;
+		FeNetSink *sink = (FeNetSink *)userp;
+
+		if ( !sink->file.is_open() )
+		{
+			// Only append if the server honoured our range request, some
+			// send the whole file again instead
+			long code( 0 );
+			curl_easy_getinfo( sink->handle, CURLINFO_RESPONSE_CODE, &code );
+
+			bool append = (( sink->offset > 0 ) && ( code == 206 ));
+			std::ios_base::openmode mode = std::ios_base::binary
+				| ( append ? std::ios_base::app : std::ios_base::trunc );
+
+			if ( !append && !write_part_url( sink->part_name, sink->url ))
+				return 0;
+
+			sink->file.open( sink->part_name.c_str(), mode );
+			if ( !sink->file.is_open() )
+				return 0; // aborts the transfer
+		}
+
+		sink->file.write( (const char *)contents, add_size );
+		return sink->file.good() ? add_size : 0;
+	}
+
+	//
+	// DNS results, TLS sessions and (on newer curl versions) open connections
+	// are shared by every request the frontend makes
+	//
+	CURLSH *g_share = NULL;
+	std::once_flag g_share_once;
+	std::mutex g_share_mutex[ CURL_LOCK_DATA_LAST ];
+
+	void share_lock( CURL *, curl_lock_data data, curl_lock_access, void * )
+	{
+		g_share_mutex[ data ].lock();
+	}
+
+	void share_unlock( CURL *, curl_lock_data data, void * )
+	{
+		g_share_mutex[ data ].unlock();
+	}
+
+	CURLSH *get_share()
+	{
+		std::call_once( g_share_once, []()
+		{
+			g_share = curl_share_init();
+			if ( !g_share )
+				return;
+
+			curl_share_setopt( g_share, CURLSHOPT_LOCKFUNC, share_lock );
+			curl_share_setopt( g_share, CURLSHOPT_UNLOCKFUNC, share_unlock );
+			curl_share_setopt( g_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS );
+			curl_share_setopt( g_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION );
+#if ( LIBCURL_VERSION_NUM >= 0x073900 )
+			curl_share_setopt( g_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT );
+#endif
+		});
+
+		return g_share;
+	}
+
+	//
+	// Get the host name from url, without the scheme, user info or port, so
+	// that the requests to a server share its limits however they are made
+	//
+	std::string get_url_host( const std::string &url )
+	{
+		size_t start = url.find( "://" );
+		start = ( start == std::string::npos ) ? 0 : start + 3;
+
+		size_t end = url.find_first_of( "/?#", start );
+		if ( end == std::string::npos )
+			end = url.size();
+
+		size_t at = url.rfind( '@', end );
+		if (( at != std::string::npos ) && ( at >= start ))
+			start = at + 1;
+
+		// skip over an IPv6 address in brackets before looking for the port
+		size_t port = url.find( ':', ( url.compare( start, 1, "[" ) == 0 ) ? url.find( ']', start ) : start );
+		if ( port < end )
+			end = port;
+
+		std::string host = url.substr( start, end - start );
+		std::transform( host.begin(), host.end(), host.begin(), ::tolower );
+		return host;
+	}
+
+	const int MAX_RETRIES = 3;
+	const int RETRY_DELAY_MS = 1000;
+};
 
 FeNetTask::FeNetTask( const std::string &url,
 		const std::string &filename,
 		TaskType t )
 	: m_type( t ),
 	m_url( url ),
+	m_host( get_url_host( url ) ),
 	m_filename( filename ),
 	m_id( FileTaskError )
 {
@@ -57,6 +202,7 @@ FeNetTask::FeNetTask( const std::string &url,
 		int id )
 	: m_type( BufferTask ),
 	m_url( url ),
+	m_host( get_url_host( url ) ),
 	m_id( id )
 {
 }
@@ -76,6 +222,7 @@ const FeNetTask &FeNetTask::operator=( const FeNetTask &o )
 {
 	m_type = o.m_type;
 	m_url = o.m_url;
+	m_host = o.m_host;
 	m_filename = o.m_filename;
 	m_result = o.m_result;
 	m_id = o.m_id;
@@ -83,20 +230,42 @@ const FeNetTask &FeNetTask::operator=( const FeNetTask &o )
 	return *this;
 }
 
-bool FeNetTask::do_task( long *code )
+void FeNetTask::setup( void *curl_handle, FeNetSink &sink )
 {
 	const char *UA_VALUE = "Attract-Mode-Plus/3.x";
 
-	std::vector<char> rbuff;
+	sink.buff.clear();
+	sink.handle = curl_handle;
+	sink.offset = 0;
 
-	CURL *curl_handle;
-	CURLcode res;
+	if (( m_type == FileTask ) || ( m_type == SpecialFileTask ))
+	{
+		sink.part_name = m_filename + PART_EXT;
+		sink.url = m_url;
 
-	// set up our http request
-	curl_handle = curl_easy_init();
+		nowide::stat_t st;
+		if (( nowide::stat( sink.part_name.c_str(), &st ) == 0 ) && ( st.st_size > 0 ))
+		{
+			if ( read_part_url( sink.part_name ) == m_url )
+			{
+				sink.offset = st.st_size;
+				curl_easy_setopt( curl_handle, CURLOPT_RESUME_FROM_LARGE, sink.offset );
+				FeDebug() << "Resuming download at " << sink.offset << " bytes: " << m_filename << std::endl;
+			}
+			else
+			{
+				// The partial file came from another url, start over
+				FeDebug() << "Discarding partial download: " << m_filename << std::endl;
+				delete_part( sink.part_name );
+			}
+		}
+
+		curl_easy_setopt( curl_handle, CURLOPT_WRITEFUNCTION, write_file_callback );
+	}
+	else
+		curl_easy_setopt( curl_handle, CURLOPT_WRITEFUNCTION, write_curl_callback );
 
-	curl_easy_setopt( curl_handle, CURLOPT_WRITEFUNCTION, write_curl_callback );
-	curl_easy_setopt( curl_handle, CURLOPT_WRITEDATA, (void *)&rbuff );
+	curl_easy_setopt( curl_handle, CURLOPT_WRITEDATA, (void *)&sink );
 	curl_easy_setopt( curl_handle, CURLOPT_USERAGENT, UA_VALUE );
 
 	// set to abort if slower than 30 bytes/sec during 60 seconds
@@ -112,9 +281,28 @@ bool FeNetTask::do_task( long *code )
 	// fail on 404 file not found messages
 	curl_easy_setopt( curl_handle, CURLOPT_FAILONERROR, 1L );
 
+	// prefer HTTP/2 so requests to one server can share a connection
+#ifdef CURL_HTTP_VERSION_2TLS
+	curl_easy_setopt( curl_handle, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS );
+#endif
+#if ( LIBCURL_VERSION_NUM >= 0x072b00 )
+	curl_easy_setopt( curl_handle, CURLOPT_PIPEWAIT, 1L );
+#endif
+
+	CURLSH *share = get_share();
+	if ( share )
+		curl_easy_setopt( curl_handle, CURLOPT_SHARE, share );
+
 	curl_easy_setopt( curl_handle, CURLOPT_URL, m_url.c_str() );
+}
+
+bool FeNetTask::complete( void *curl_handle, int r, FeNetSink &sink, long *code )
+{
+	CURLcode res = (CURLcode)r;
+	bool is_file = (( m_type == FileTask ) || ( m_type == SpecialFileTask ));
 
-		res = curl_easy_perform( curl_handle );
+	if ( sink.file.is_open() )
+		sink.file.close();
 
 	if ( res != CURLE_OK )
 	{
@@ -123,6 +311,11 @@ bool FeNetTask::do_task( long *code )
 			long rcode;
 			curl_easy_getinfo( curl_handle, CURLINFO_RESPONSE_CODE, &rcode );
 
+			// The server won't resume from where our partial download stopped,
+			// so start over
+			if ( is_file && ( rcode == 416 ))
+				delete_part( sink.part_name );
+
 			fe_log_threadsafe( " * Http error: " + std::to_string( rcode ) + " (" + m_url + ")" );
 
 			if ( code )
@@ -130,6 +323,10 @@ bool FeNetTask::do_task( long *code )
 		}
 		else
 		{
+			// The server doesn't support resuming, start over next time
+			if ( is_file && ( res == CURLE_RANGE_ERROR ))
+				delete_part( sink.part_name );
+
 			m_result = curl_easy_strerror( res );
 
 			if ( res == CURLE_COULDNT_RESOLVE_HOST ||
@@ -145,23 +342,27 @@ bool FeNetTask::do_task( long *code )
 			}
 		}
 
-		curl_easy_cleanup( curl_handle );
 		return false;
 	}
 
-	curl_easy_cleanup( curl_handle );
-
-	if (( m_type == FileTask ) || ( m_type == SpecialFileTask ))
+	if ( is_file )
 	{
-		nowide::ofstream outfile( m_filename.c_str(), std::ios_base::binary );
-		if ( !outfile.is_open() )
+		if ( !file_exists( sink.part_name ) )
+		{
+			// nothing was received, create an empty file
+			nowide::ofstream outfile( sink.part_name.c_str(), std::ios_base::binary );
+		}
+
+		if ( file_exists( m_filename ) )
+			delete_file( m_filename );
+
+		if ( nowide::rename( sink.part_name.c_str(), m_filename.c_str() ) != 0 )
 		{
 			fe_log_threadsafe( " ! Unable to open file for writing: " + m_filename );
 			return false;
 		}
 
-		outfile.write( &(rbuff[0]), rbuff.size() );
-		outfile.close();
+		delete_file( sink.part_name + PART_URL_EXT );
 
 		m_id=m_type;
 		m_result = m_filename;
@@ -169,12 +370,56 @@ bool FeNetTask::do_task( long *code )
 	else
 	{
 		m_result.clear();
-		m_result.append( &(rbuff[0]), rbuff.size() );
+		m_result.append( sink.buff.data(), sink.buff.size() );
 	}
 
 	return true;
 }
 
+bool FeNetTask::can_retry( int r, long code ) const
+{
+	CURLcode res = (CURLcode)r;
+
+	if ( res == CURLE_HTTP_RETURNED_ERROR )
+	{
+		// Server errors and rate limiting may pass, other http errors won't.
+		// 500 is left out since it aborts the whole queue.  416 means a
+		// partial download couldn't be resumed, it was removed in complete()
+		if (( code == 429 ) || ( code == 502 ) || ( code == 503 ) || ( code == 504 ))
+			return true;
+
+		if (( code == 416 ) && (( m_type == FileTask ) || ( m_type == SpecialFileTask )))
+			return true;
+
+		return false;
+	}
+
+	if (( m_type == FileTask ) || ( m_type == SpecialFileTask ))
+		return true;
+
+	return ( res == CURLE_COULDNT_RESOLVE_HOST )
+		|| ( res == CURLE_COULDNT_CONNECT )
+		|| ( res == CURLE_OPERATION_TIMEDOUT )
+		|| ( res == CURLE_RECV_ERROR )
+		|| ( res == CURLE_SEND_ERROR )
+		|| ( res == CURLE_GOT_NOTHING );
+}
+
+bool FeNetTask::do_task( long *code )
+{
+	FeNetSink sink;
+
+	// set up our http request
+	CURL *curl_handle = curl_easy_init();
+	setup( curl_handle, sink );
+
+	CURLcode res = curl_easy_perform( curl_handle );
+	bool retval = complete( curl_handle, res, sink, code );
+
+	curl_easy_cleanup( curl_handle );
+	return retval;
+}
+
 void FeNetTask::grab_result( int &id, std::string &result )
 {
 	id = m_id;
@@ -190,47 +435,145 @@ void FeNetQueue::add_file_task( const std::string &url,
 		const std::string &file_name,
 		bool flag_special )
 {
-	std::lock_guard<std::recursive_mutex> l( m_mutex );
-	m_in_queue.push_front( FeNetTask( url, file_name,
-		flag_special ? FeNetTask::SpecialFileTask : FeNetTask::FileTask ) );
+	{
+		std::lock_guard<std::recursive_mutex> l( m_mutex );
+		m_in_queue.push_front( FeNetTask( url, file_name,
+			flag_special ? FeNetTask::SpecialFileTask : FeNetTask::FileTask ) );
+	}
+	m_cond.notify_all();
 }
 
 void FeNetQueue::add_buffer_task( const std::string &url,
 		int id )
+{
+	{
+		std::lock_guard<std::recursive_mutex> l( m_mutex );
+		m_in_queue.push_back( FeNetTask( url, id ) );
+	}
+	m_cond.notify_all();
+}
+
+void FeNetQueue::set_host_limit( const std::string &url,
+		int max_requests,
+		int min_interval_ms )
 {
 	std::lock_guard<std::recursive_mutex> l( m_mutex );
-	m_in_queue.push_back( FeNetTask( url, id ) );
+
+	HostState &h = m_hosts[ get_url_host( url ) ];
+	h.max_requests = max_requests;
+	h.min_interval = std::chrono::milliseconds( min_interval_ms );
 }
 
 bool FeNetQueue::get_next_task( FeNetTask &t )
 {
-	// Grab next task from the input queue
+	// Grab next task from the input queue, skipping over tasks for hosts
+	// that are at their limit
 	//
 	std::lock_guard<std::recursive_mutex> l( m_mutex );
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
 
-	if ( m_in_queue.empty() )
-		return false;
+	for ( std::deque<FeNetTask>::iterator itr=m_in_queue.begin(); itr!=m_in_queue.end(); ++itr )
+	{
+		HostState &h = m_hosts[ (*itr).get_host() ];
 
-	t = m_in_queue.front();
-	m_in_queue.pop_front();
+		if (( h.max_requests > 0 ) && ( h.active >= h.max_requests ))
+			continue;
 
-	m_in_flight++;
-	return true;
+		if (( h.active > 0 || h.min_interval.count() > 0 )
+				&& ( now - h.last_start < h.min_interval ))
+			continue;
+
+		h.active++;
+		h.last_start = now;
+
+		t = *itr;
+		m_in_queue.erase( itr );
+
+		m_in_flight++;
+		return true;
+	}
+
+	return false;
 }
 
-void FeNetQueue::done_with_task( const FeNetTask &t, bool res )
+void FeNetQueue::done_with_task( const FeNetTask &t, bool res, long code )
 {
 	// Queue result
 	//
+	{
+		std::lock_guard<std::recursive_mutex> l( m_mutex );
+
+		if ( res )
+			m_out_queue.push( t );
+		else if ( code > 0 )
+			m_failed_queue.push( std::make_pair( t, code ) );
+
+		m_in_flight--;
+
+		std::map<std::string, HostState>::iterator itr = m_hosts.find( t.get_host() );
+		if (( itr != m_hosts.end() ) && ( itr->second.active > 0 ))
+			itr->second.active--;
+
+		FeDebug() << "WORKERS: queue_in=" << m_in_queue.size() << ", in_progress=" << m_in_flight
+			<< ", queue_out=" << m_out_queue.size() << std::endl;
+	}
+
+	m_cond.notify_all();
+}
+
+bool FeNetQueue::next_start_time( std::chrono::steady_clock::time_point &t )
+{
 	std::lock_guard<std::recursive_mutex> l( m_mutex );
+	bool retval = false;
+
+	for ( std::deque<FeNetTask>::iterator itr=m_in_queue.begin(); itr!=m_in_queue.end(); ++itr )
+	{
+		HostState &h = m_hosts[ (*itr).get_host() ];
 
-	if ( res )
-		m_out_queue.push( t );
+		// this one has to wait for a request to complete, which signals m_cond
+		if (( h.max_requests > 0 ) && ( h.active >= h.max_requests ))
+			continue;
 
-	m_in_flight--;
+		std::chrono::steady_clock::time_point start = h.last_start + h.min_interval;
+		if ( !retval || ( start < t ))
+			t = start;
 
-	FeDebug() << "WORKERS: queue_in=" << m_in_queue.size() << ", in_progress=" << m_in_flight
-		<< ", queue_out=" << m_out_queue.size() << std::endl;
+		retval = true;
+	}
+
+	return retval;
+}
+
+void FeNetQueue::wait_for_task( int timeout_ms )
+{
+	std::unique_lock<std::recursive_mutex> l( m_mutex );
+	std::chrono::steady_clock::time_point until = std::chrono::steady_clock::now()
+		+ std::chrono::milliseconds( timeout_ms );
+
+	//
+	// Sleep until a queued task is allowed to start.  Tasks held back by
+	// their host's min_interval are waited out here, rather than having the
+	// worker come back to check on them over and over
+	//
+	for ( ;; )
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if ( now >= until )
+			return;
+
+		std::chrono::steady_clock::time_point start = until;
+		if ( next_start_time( start ) && ( start <= now ))
+			return;
+
+		m_cond.wait_until( l, std::min( start, until ));
+	}
+}
+
+void FeNetQueue::wait_for_result( int timeout_ms )
+{
+	std::unique_lock<std::recursive_mutex> l( m_mutex );
+	m_cond.wait_for( l, std::chrono::milliseconds( timeout_ms ),
+		[this]{ return !m_out_queue.empty() || ( m_in_queue.empty() && ( m_in_flight == 0 )); } );
 }
 
 bool FeNetQueue::pop_completed_task( int &id,
@@ -246,12 +589,32 @@ bool FeNetQueue::pop_completed_task( int &id,
 	return false;
 }
 
-void FeNetQueue::abort()
+bool FeNetQueue::pop_failed_task( int &id,
+		std::string &target,
+		long &code )
 {
 	std::lock_guard<std::recursive_mutex> l( m_mutex );
+	if ( m_failed_queue.empty() )
+		return false;
+
+	const FeNetTask &t = m_failed_queue.front().first;
+	id = t.get_id();
+	target = ( id == FeNetTask::FileTaskError ) ? t.get_filename() : t.get_url();
+	code = m_failed_queue.front().second;
 
-	while ( !m_in_queue.empty() )
-		m_in_queue.pop_front();
+	m_failed_queue.pop();
+	return true;
+}
+
+void FeNetQueue::abort()
+{
+	{
+		std::lock_guard<std::recursive_mutex> l( m_mutex );
+
+		while ( !m_in_queue.empty() )
+			m_in_queue.pop_front();
+	}
+	m_cond.notify_all();
 }
 
 bool FeNetQueue::all_done()
@@ -270,67 +633,186 @@ bool FeNetQueue::output_done()
 	return retval;
 }
 
-FeNetWorker::FeNetWorker( FeNetQueue &queue )
+FeNetWorker::FeNetWorker( FeNetQueue &queue, int max_requests )
 	: m_queue( queue ),
-	m_thread( &FeNetWorker::work_process, this ),
-	m_proceed( true )
+	m_max_requests( std::max( 1, max_requests ) ),
+	m_proceed( true ),
+	m_multi( curl_multi_init() ),
+	m_thread( &FeNetWorker::work_process, this )
 {
 }
 
 FeNetWorker::~FeNetWorker()
 {
 	m_proceed = false;
+	m_queue.m_cond.notify_all();
+
+#if ( LIBCURL_VERSION_NUM >= 0x074400 )
+	if ( m_multi )
+		curl_multi_wakeup( m_multi );
+#endif
 
 	if ( m_thread.joinable() )
 		m_thread.join();
+
+	if ( m_multi )
+		curl_multi_cleanup( m_multi );
 }
 
+namespace
+{
+	//
+	// A task being processed by FeNetWorker
+	//
+	struct FeNetTransfer
+	{
+		FeNetTask task;
+		CURL *handle=NULL;
+		FeNetSink sink;
+		int attempts=0;
+		std::chrono::steady_clock::time_point retry_at;
+	};
+};
+
 void FeNetWorker::work_process()
 {
 	unsigned long thread_id = std::hash<std::thread::id>{}(std::this_thread::get_id());
 	fe_log_threadsafe( "WORKER thread " + std::to_string( thread_id ) + " started." );
 
-	while ( m_proceed && !m_queue.all_done() )
+	CURLM *multi = (CURLM *)m_multi;
+	if ( !multi )
 	{
-		bool res=false;
-		FeNetTask t;
+		fe_log_threadsafe( " ! Error initializing network worker" );
+		return;
+	}
+
+#if ( LIBCURL_VERSION_NUM >= 0x072b00 )
+	curl_multi_setopt( multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX );
+#endif
+	curl_multi_setopt( multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, (long)m_max_requests );
+
+	std::list<FeNetTransfer> active; // running or waiting to retry
+	int running_count = 0;
+
+	auto start_transfer = [&]( FeNetTransfer &x )
+	{
+		x.handle = curl_easy_init();
+		x.task.setup( x.handle, x.sink );
+		curl_easy_setopt( x.handle, CURLOPT_PRIVATE, (void *)&x );
+		curl_multi_add_handle( multi, x.handle );
+		x.attempts++;
+		running_count++;
+	};
+
+	while ( m_proceed )
+	{
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+		// Restart transfers whose retry delay has passed
+		for ( std::list<FeNetTransfer>::iterator itr=active.begin(); itr!=active.end(); ++itr )
+		{
+			if ( !(*itr).handle && ( (*itr).retry_at <= now ))
+				start_transfer( *itr );
+		}
+
+		// Start new tasks, up to our limit
+		while ( (int)active.size() < m_max_requests )
+		{
+			FeNetTask t;
+			if ( !m_queue.get_next_task( t ))
+				break;
+
+			active.emplace_back();
+			active.back().task = t;
+			start_transfer( active.back() );
+		}
 
-		if ( m_queue.get_next_task( t ) )
+		if ( active.empty() )
 		{
+			m_queue.wait_for_task( 100 );
+			continue;
+		}
+
+		int still_running=0;
+		curl_multi_perform( multi, &still_running );
+
+		CURLMsg *msg;
+		int msgs_left;
+		while (( msg = curl_multi_info_read( multi, &msgs_left )))
+		{
+			if ( msg->msg != CURLMSG_DONE )
+				continue;
+
+			FeNetTransfer *x = NULL;
+			curl_easy_getinfo( msg->easy_handle, CURLINFO_PRIVATE, (char **)&x );
+			CURLcode res = msg->data.result;
+
 			long code( 0 );
-			int retry_count = 0;
-			const int MAX_RETRIES = 3;
+			bool ok = x->task.complete( x->handle, res, x->sink, &code );
+
+			curl_multi_remove_handle( multi, x->handle );
+			curl_easy_cleanup( x->handle );
+			x->handle = NULL;
+			running_count--;
 
-			do
+			if ( !ok && m_proceed && ( x->attempts <= MAX_RETRIES ) && x->task.can_retry( res, code ))
 			{
-				res = t.do_task( &code );
+				// Back off a little longer after each failed attempt
+				int delay = RETRY_DELAY_MS << ( x->attempts - 1 );
+				x->retry_at = std::chrono::steady_clock::now() + std::chrono::milliseconds( delay );
 
-				if ( !res && ( t.m_type == FeNetTask::FileTask || t.m_type == FeNetTask::SpecialFileTask ) )
-				{
-					retry_count++;
-					if ( retry_count <= MAX_RETRIES )
-					{
-						fe_log_threadsafe( " - Retrying download (attempt " + std::to_string( retry_count + 1 ) + "/" + std::to_string( MAX_RETRIES + 1 ) + ")" );
-						std::this_thread::sleep_for( std::chrono::milliseconds( 1000 ) );
-					}
-				}
-			} while ( !res && ( t.m_type == FeNetTask::FileTask || t.m_type == FeNetTask::SpecialFileTask ) && retry_count <= MAX_RETRIES );
+				fe_log_threadsafe( " - Retrying request in " + std::to_string( delay ) + "ms (attempt "
+					+ std::to_string( x->attempts + 1 ) + "/" + std::to_string( MAX_RETRIES + 1 ) + ")" );
+				continue;
+			}
 
-			m_queue.done_with_task( t, res );
+			m_queue.done_with_task( x->task, ok, code );
 
-			if ( !res )
+			if ( !ok && ( code == 500 ))
 			{
-				if ( code == 500 )
+				FeLog() << "Aborting scrape of server, encountered http error code: " << code << std::endl;
+				m_queue.abort();
+			}
+
+			for ( std::list<FeNetTransfer>::iterator itr=active.begin(); itr!=active.end(); ++itr )
+			{
+				if ( &(*itr) == x )
 				{
-					FeLog() << "Aborting scrape of server, encountered http error code: " << code << std::endl;
-					m_queue.abort();
+					active.erase( itr );
+					break;
 				}
 			}
 		}
-		else
+
+		// Wait for network activity, or for a retry to come due
+		int timeout_ms = ( running_count > 0 ) ? 100 : 10;
+
+		// ...or for a queued task's host min_interval to pass, if there is room to start it
+		std::chrono::steady_clock::time_point start;
+		if (( (int)active.size() < m_max_requests ) && m_queue.next_start_time( start ))
+		{
+			long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+				start - std::chrono::steady_clock::now() ).count() + 1;
+
+			timeout_ms = (int)std::max( 0LL, std::min( (long long)timeout_ms, ms ));
+		}
+#if ( LIBCURL_VERSION_NUM >= 0x074200 )
+		curl_multi_poll( multi, NULL, 0, timeout_ms, NULL );
+#else
+		curl_multi_wait( multi, NULL, 0, timeout_ms, NULL );
+#endif
+	}
+
+	// Stopping, drop anything still in progress
+	for ( std::list<FeNetTransfer>::iterator itr=active.begin(); itr!=active.end(); ++itr )
+	{
+		if ( (*itr).handle )
 		{
-			std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+			curl_multi_remove_handle( multi, (*itr).handle );
+			curl_easy_cleanup( (*itr).handle );
 		}
+
+		m_queue.done_with_task( (*itr).task, false );
 	}
 
 	fe_log_threadsafe( "WORKER thread " + std::to_string( thread_id ) + " process completed." );
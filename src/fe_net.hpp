@@ -27,9 +27,16 @@
 #include <thread>
 #include <deque>
 #include <queue>
+#include <map>
+#include <memory>
 #include <string>
+#include <vector>
+#include <chrono>
+#include <condition_variable>
+#include <atomic>
 
 class FeNetWorker;
+struct FeNetSink;
 
 class FeNetTask
 {
@@ -59,15 +66,37 @@ public:
 
 	FeNetTask();
 
+	// Perform the task synchronously on the calling thread
 	bool do_task( long *code = NULL );
 
 	// this function consumes the task's result, so it will no longer be
 	// available for future calls to this function...
 	void grab_result( int &id, std::string &result );
 
+	const std::string &get_host() const { return m_host; }
+	const std::string &get_url() const { return m_url; }
+	const std::string &get_filename() const { return m_filename; }
+	int get_id() const { return m_id; }
+
 private:
+	//
+	// Configure a curl easy handle to perform this task.  File tasks are
+	// written to a ".part" file next to the target as they download, which
+	// is renamed once complete.  If a ".part" file is already there the
+	// download resumes from where it stopped.
+	//
+	void setup( void *curl_handle, FeNetSink &sink );
+
+	// Process the outcome of a transfer set up with setup().  res is the
+	// CURLcode result, code is set to the http response code on http errors
+	bool complete( void *curl_handle, int res, FeNetSink &sink, long *code );
+
+	// Whether a failed attempt at this task is worth retrying
+	bool can_retry( int res, long code ) const;
+
 	TaskType m_type;
 	std::string m_url;
+	std::string m_host;
 	std::string m_filename;
 	std::string m_result;
 	int m_id;
@@ -77,23 +106,59 @@ class FeNetQueue
 {
 	friend class FeNetWorker;
 private:
+	struct HostState
+	{
+		int max_requests=0; // 0 for no limit
+		std::chrono::milliseconds min_interval{ 0 };
+		int active=0;
+		std::chrono::steady_clock::time_point last_start;
+	};
+
 	std::recursive_mutex m_mutex;
+	std::condition_variable_any m_cond; // signalled when tasks are added or completed
 	std::deque < FeNetTask > m_in_queue;
 	std::queue < FeNetTask > m_out_queue;
+	std::queue < std::pair< FeNetTask, long > > m_failed_queue;
+	std::map < std::string, HostState > m_hosts;
 	int m_in_flight;
 
 	FeNetQueue( const FeNetQueue & );
 	FeNetQueue &operator=( const FeNetQueue & );
 
 protected:
+	// Get the next task whose host is under its limits
 	bool get_next_task( FeNetTask &t );
-	void done_with_task( const FeNetTask &t, bool queue_result );
+	void done_with_task( const FeNetTask &t, bool queue_result, long code=0 );
+
+	//
+	// Get the earliest time a queued task's host limits allow it to start.
+	// Returns false if there are none that could start before another
+	// request completes
+	//
+	bool next_start_time( std::chrono::steady_clock::time_point &t );
+
+	// Block until a queued task is allowed to start, for at most timeout_ms
+	void wait_for_task( int timeout_ms );
 
 	void abort();
 
 public:
 	FeNetQueue();
 
+	//
+	// Limit the requests made to the host of url to max_requests at a time,
+	// with at least min_interval_ms between the start of each request
+	//
+	void set_host_limit( const std::string &url,
+			int max_requests,
+			int min_interval_ms=0 );
+
+	//
+	// Block until a completed task is ready to pop or all tasks are done,
+	// for at most timeout_ms
+	//
+	void wait_for_result( int timeout_ms=100 );
+
 	void add_file_task( const std::string &url,
 			const std::string &file_name,
 			bool flag_special=false );
@@ -106,20 +171,37 @@ public:
 
 	bool all_done();
 	bool output_done();
+
+	//
+	// Get a task that failed with an http error.  id is the buffer task id
+	// (FileTaskError for file tasks), target is the file name for file tasks
+	// or the url for buffer tasks.  Failures are not counted by all_done()
+	// or output_done(), they are simply there for callers that want them
+	//
+	bool pop_failed_task( int &id, std::string &target, long &code );
 };
 
+//
+// Processes a queue's tasks on a single thread using curl's multi interface.
+// Connections, DNS lookups and TLS sessions are reused between requests and
+// requests to the same server are multiplexed over HTTP/2 where possible.
+// Up to max_requests tasks run at once, subject to the queue's host limits.
+// Failed requests are retried with an increasing delay.
+//
 class FeNetWorker
 {
 	FeNetQueue &m_queue;
+	int m_max_requests;
+	std::atomic<bool> m_proceed;
+	void *m_multi;
 	std::thread m_thread;
-	bool m_proceed;
 
 	FeNetWorker( const FeNetWorker & );
 	FeNetWorker &operator=( const FeNetWorker & );
 
 	void work_process();
 public:
-	FeNetWorker( FeNetQueue &q );
+	FeNetWorker( FeNetQueue &q, int max_requests=4 );
 	~FeNetWorker();
 };
 
@@ -0,0 +1,565 @@
+/*
+ *
+ *  Attract-Mode Plus frontend
+ *  Copyright (C) 2025 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode Plus
+ *
+ *  Attract-Mode Plus is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode Plus is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode Plus.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+//
+// Tests for the network engine (FeNetQueue and FeNetWorker), run against a
+// small HTTP server on the loopback interface.  Built as a separate program
+// with "make nettest", which exits with a non-zero status if a test fails.
+//
+// The server answers:
+//   /ok/<x>     200 "ok:<x>"
+//   /flaky/<x>  503 the first time it is asked for, then 200 "flaky:<x>"
+//   /missing    404
+//   /slow/<x>   200 "slow:<x>" after a short delay
+//   /file       FILE_SIZE bytes of a fixed pattern, honouring "Range: bytes=N-"
+//
+#include "fe_net.hpp"
+#include "fe_base.hpp"
+#include "fe_util.hpp"
+
+#include "nowide/args.hpp"
+#include "nowide/fstream.hpp"
+
+#include <SFML/Config.hpp>
+#include <curl/curl.h>
+
+#include <iostream>
+#include <sstream>
+#include <cstring>
+
+#ifdef SFML_SYSTEM_WINDOWS
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET FeSocket;
+#define FE_CLOSE_SOCKET closesocket
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int FeSocket;
+const FeSocket INVALID_SOCKET = -1;
+#define FE_CLOSE_SOCKET close
+#endif
+
+namespace
+{
+	const size_t FILE_SIZE = 64 * 1024;
+	const int SLOW_MS = 150;
+	const int TIMEOUT_MS = 15000;
+
+	std::string file_pattern()
+	{
+		std::string s( FILE_SIZE, ' ' );
+		for ( size_t i=0; i<s.size(); i++ )
+			s[i] = 'a' + ( i * 7 ) % 26;
+		return s;
+	}
+
+	//
+	// Minimal HTTP/1.1 server, one connection per request
+	//
+	class FeTestServer
+	{
+	public:
+		FeTestServer()
+			: m_listen( INVALID_SOCKET ),
+			m_port( 0 ),
+			m_stop( false ),
+			m_active( 0 ),
+			m_max_active( 0 )
+		{
+		}
+
+		~FeTestServer()
+		{
+			stop();
+		}
+
+		bool start()
+		{
+			m_listen = socket( AF_INET, SOCK_STREAM, 0 );
+			if ( m_listen == INVALID_SOCKET )
+				return false;
+
+			sockaddr_in addr;
+			memset( &addr, 0, sizeof( addr ));
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+			addr.sin_port = 0;
+
+			socklen_t len = sizeof( addr );
+			if (( bind( m_listen, (sockaddr *)&addr, sizeof( addr )) != 0 )
+					|| ( listen( m_listen, 32 ) != 0 )
+					|| ( getsockname( m_listen, (sockaddr *)&addr, &len ) != 0 ))
+				return false;
+
+			m_port = ntohs( addr.sin_port );
+			m_thread = std::thread( &FeTestServer::accept_loop, this );
+			return true;
+		}
+
+		void stop()
+		{
+			if ( m_listen == INVALID_SOCKET )
+				return;
+
+			m_stop = true;
+
+			// Connect to ourselves to wake up accept()
+			FeSocket s = socket( AF_INET, SOCK_STREAM, 0 );
+			sockaddr_in addr;
+			memset( &addr, 0, sizeof( addr ));
+			addr.sin_family = AF_INET;
+			addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+			addr.sin_port = htons( m_port );
+			connect( s, (sockaddr *)&addr, sizeof( addr ));
+			FE_CLOSE_SOCKET( s );
+
+			if ( m_thread.joinable() )
+				m_thread.join();
+
+			for ( std::vector<std::thread>::iterator itr=m_clients.begin(); itr!=m_clients.end(); ++itr )
+				(*itr).join();
+
+			FE_CLOSE_SOCKET( m_listen );
+			m_listen = INVALID_SOCKET;
+		}
+
+		std::string get_base() const
+		{
+			return "http://127.0.0.1:" + as_str( m_port );
+		}
+
+		int get_hits( const std::string &path )
+		{
+			std::lock_guard<std::mutex> l( m_mutex );
+			return m_hits[ path ];
+		}
+
+		std::string get_range( const std::string &path )
+		{
+			std::lock_guard<std::mutex> l( m_mutex );
+			return m_ranges[ path ];
+		}
+
+		int get_max_active()
+		{
+			std::lock_guard<std::mutex> l( m_mutex );
+			return m_max_active;
+		}
+
+		void reset_max_active()
+		{
+			std::lock_guard<std::mutex> l( m_mutex );
+			m_max_active = 0;
+		}
+
+	private:
+		FeSocket m_listen;
+		int m_port;
+		std::atomic<bool> m_stop;
+		std::thread m_thread;
+		std::vector<std::thread> m_clients;
+
+		std::mutex m_mutex;
+		std::map<std::string, int> m_hits;
+		std::map<std::string, std::string> m_ranges;
+		int m_active;
+		int m_max_active;
+
+		void accept_loop()
+		{
+			while ( !m_stop )
+			{
+				FeSocket c = accept( m_listen, NULL, NULL );
+				if ( c == INVALID_SOCKET )
+					continue;
+
+				if ( m_stop )
+				{
+					FE_CLOSE_SOCKET( c );
+					break;
+				}
+
+				m_clients.push_back( std::thread( &FeTestServer::handle, this, c ));
+			}
+		}
+
+		void handle( FeSocket c )
+		{
+			std::string req;
+			char buff[1024];
+			while ( req.find( "\r\n\r\n" ) == std::string::npos )
+			{
+				int n = recv( c, buff, sizeof( buff ), 0 );
+				if ( n <= 0 )
+					break;
+				req.append( buff, n );
+			}
+
+			std::string method, path, range;
+			std::istringstream ss( req );
+			ss >> method >> path;
+
+			size_t pos = req.find( "Range: bytes=" );
+			if ( pos != std::string::npos )
+				range = req.substr( pos + 13, req.find( "\r\n", pos ) - pos - 13 );
+
+			int hits;
+			{
+				std::lock_guard<std::mutex> l( m_mutex );
+				hits = ++m_hits[ path ];
+				m_ranges[ path ] = range;
+				m_max_active = std::max( m_max_active, ++m_active );
+			}
+
+			int code = 200;
+			std::string body, extra;
+
+			if ( path.compare( 0, 4, "/ok/" ) == 0 )
+				body = "ok:" + path.substr( 4 );
+			else if ( path.compare( 0, 7, "/flaky/" ) == 0 )
+			{
+				if ( hits == 1 )
+					code = 503;
+				else
+					body = "flaky:" + path.substr( 7 );
+			}
+			else if ( path.compare( 0, 6, "/slow/" ) == 0 )
+			{
+				std::this_thread::sleep_for( std::chrono::milliseconds( SLOW_MS ));
+				body = "slow:" + path.substr( 6 );
+			}
+			else if ( path == "/file" )
+			{
+				body = file_pattern();
+				size_t start = range.empty() ? 0 : as_int( range );
+				if ( start >= body.size() )
+				{
+					code = 416;
+					body.clear();
+				}
+				else if ( start > 0 )
+				{
+					code = 206;
+					extra = "Content-Range: bytes " + as_str( (int)start ) + "-"
+						+ as_str( (int)body.size() - 1 ) + "/" + as_str( (int)body.size() ) + "\r\n";
+					body = body.substr( start );
+				}
+			}
+			else
+				code = 404;
+
+			std::string reason = ( code == 200 ) ? "OK" : (( code == 206 ) ? "Partial Content" : "Error" );
+			std::string resp = "HTTP/1.1 " + as_str( code ) + " " + reason + "\r\n"
+				+ "Content-Length: " + as_str( (int)body.size() ) + "\r\n"
+				+ extra
+				+ "Connection: close\r\n\r\n"
+				+ body;
+
+			send( c, resp.data(), resp.size(), 0 );
+
+			{
+				std::lock_guard<std::mutex> l( m_mutex );
+				m_active--;
+			}
+
+			FE_CLOSE_SOCKET( c );
+		}
+	};
+
+	//
+	// Collect the queue's results until every task is done
+	//
+	bool run_queue( FeNetQueue &q, std::map<int, std::string> &results )
+	{
+		std::chrono::steady_clock::time_point end
+			= std::chrono::steady_clock::now() + std::chrono::milliseconds( TIMEOUT_MS );
+
+		while ( true )
+		{
+			q.wait_for_result( 100 );
+
+			int id;
+			std::string result;
+			while ( q.pop_completed_task( id, result ))
+				results[ id ] = result;
+
+			if ( q.all_done() )
+				return true;
+
+			if ( std::chrono::steady_clock::now() > end )
+				return false;
+		}
+	}
+
+	int g_failed = 0;
+
+	void check( bool ok, const std::string &test, const std::string &what )
+	{
+		if ( !ok )
+		{
+			std::cout << "FAIL " << test << ": " << what << std::endl;
+			g_failed++;
+		}
+	}
+
+	void test_completion( FeTestServer &server )
+	{
+		const int COUNT = 20;
+		FeNetQueue q;
+		for ( int i=0; i<COUNT; i++ )
+			q.add_buffer_task( server.get_base() + "/ok/" + as_str( i ), i );
+
+		std::map<int, std::string> results;
+		{
+			FeNetWorker worker( q, 4 );
+			check( run_queue( q, results ), "completion", "timed out" );
+		}
+
+		check( (int)results.size() == COUNT, "completion", "got " + as_str( (int)results.size() ) + " results" );
+		for ( int i=0; i<COUNT; i++ )
+			check( results[i] == "ok:" + as_str( i ), "completion", "wrong result for task " + as_str( i ));
+	}
+
+	void test_retry( FeTestServer &server )
+	{
+		FeNetQueue q;
+		q.add_buffer_task( server.get_base() + "/flaky/a", 1 );
+
+		std::map<int, std::string> results;
+		{
+			FeNetWorker worker( q, 4 );
+			check( run_queue( q, results ), "retry", "timed out" );
+		}
+
+		check( results[1] == "flaky:a", "retry", "request was not retried after a 503" );
+		check( server.get_hits( "/flaky/a" ) == 2, "retry", "expected 2 requests, got "
+			+ as_str( server.get_hits( "/flaky/a" )));
+	}
+
+	void test_failure( FeTestServer &server )
+	{
+		FeNetQueue q;
+		q.add_buffer_task( server.get_base() + "/missing", 1 );
+
+		std::map<int, std::string> results;
+		{
+			FeNetWorker worker( q, 4 );
+			check( run_queue( q, results ), "failure", "timed out" );
+		}
+
+		int id;
+		std::string target;
+		long code( 0 );
+		check( results.empty(), "failure", "a failed request completed" );
+		check( q.pop_failed_task( id, target, code ) && ( code == 404 ) && ( id == 1 ),
+			"failure", "404 was not reported" );
+		check( server.get_hits( "/missing" ) == 1, "failure", "a 404 was retried" );
+	}
+
+	void test_limits( FeTestServer &server )
+	{
+		const int COUNT = 8;
+
+		// Host limit below the worker's limit
+		{
+			server.reset_max_active();
+			FeNetQueue q;
+			q.set_host_limit( server.get_base(), 2 );
+			for ( int i=0; i<COUNT; i++ )
+				q.add_buffer_task( server.get_base() + "/slow/h" + as_str( i ), i );
+
+			std::map<int, std::string> results;
+			{
+				FeNetWorker worker( q, COUNT );
+				check( run_queue( q, results ), "host limit", "timed out" );
+			}
+
+			check( (int)results.size() == COUNT, "host limit", "not every request completed" );
+			check( server.get_max_active() <= 2, "host limit", as_str( server.get_max_active() )
+				+ " requests ran at once" );
+		}
+
+		// Worker limit with no host limit
+		{
+			server.reset_max_active();
+			FeNetQueue q;
+			for ( int i=0; i<COUNT; i++ )
+				q.add_buffer_task( server.get_base() + "/slow/w" + as_str( i ), i );
+
+			std::map<int, std::string> results;
+			{
+				FeNetWorker worker( q, 3 );
+				check( run_queue( q, results ), "worker limit", "timed out" );
+			}
+
+			check( (int)results.size() == COUNT, "worker limit", "not every request completed" );
+			check( server.get_max_active() <= 3, "worker limit", as_str( server.get_max_active() )
+				+ " requests ran at once" );
+		}
+
+		// Interval between requests, set with a url that only shares the host name
+		{
+			const int INTERVAL_MS = 100;
+			const int N = 4;
+
+			FeNetQueue q;
+			q.set_host_limit( "https://127.0.0.1/elsewhere", 0, INTERVAL_MS );
+			for ( int i=0; i<N; i++ )
+				q.add_buffer_task( server.get_base() + "/ok/i" + as_str( i ), i );
+
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			std::map<int, std::string> results;
+			{
+				FeNetWorker worker( q, N );
+				check( run_queue( q, results ), "interval", "timed out" );
+			}
+
+			long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+				std::chrono::steady_clock::now() - start ).count();
+
+			check( (int)results.size() == N, "interval", "not every request completed" );
+			check( ms >= ( N - 1 ) * INTERVAL_MS, "interval", "requests finished in " + as_str( (int)ms ) + "ms" );
+		}
+	}
+
+	void test_file( FeTestServer &server, const std::string &dir )
+	{
+		std::string full = file_pattern();
+
+		// Fresh download
+		std::string name = dir + "fe_net_test_file.bin";
+		delete_file( name );
+
+		FeNetQueue q;
+		q.add_file_task( server.get_base() + "/file", name );
+
+		std::map<int, std::string> results;
+		{
+			FeNetWorker worker( q, 4 );
+			check( run_queue( q, results ), "file", "timed out" );
+		}
+
+		std::string data;
+		{
+			nowide::ifstream f( name.c_str(), std::ios::binary );
+			std::ostringstream ss;
+			ss << f.rdbuf();
+			data = ss.str();
+		}
+
+		check( data == full, "file", "downloaded file doesn't match" );
+		check( !file_exists( name + ".part" ), "file", "part file left behind" );
+		check( !file_exists( name + ".part.url" ), "file", "part url file left behind" );
+		delete_file( name );
+	}
+
+	//
+	// Download over a ".part" file recorded as coming from part_url, which
+	// should only be resumed when part_url is the url being downloaded
+	//
+	void test_resume( FeTestServer &server, const std::string &dir,
+			const std::string &part_url, bool expect_resume )
+	{
+		std::string test = expect_resume ? "resume" : "resume other url";
+		std::string full = file_pattern();
+		std::string name = dir + "fe_net_test_resume.bin";
+		delete_file( name );
+
+		// The partial data only matches the file when it is meant to be resumed
+		const size_t HAVE = 4000;
+		{
+			std::string part = expect_resume ? full.substr( 0, HAVE ) : std::string( HAVE, '#' );
+			nowide::ofstream f( ( name + ".part" ).c_str(), std::ios::binary );
+			f.write( part.data(), part.size() );
+
+			nowide::ofstream u( ( name + ".part.url" ).c_str(), std::ios::binary );
+			u << part_url;
+		}
+
+		FeNetQueue q;
+		q.add_file_task( server.get_base() + "/file", name );
+
+		std::map<int, std::string> results;
+		{
+			FeNetWorker worker( q, 4 );
+			check( run_queue( q, results ), test, "timed out" );
+		}
+
+		std::string data;
+		{
+			nowide::ifstream f( name.c_str(), std::ios::binary );
+			std::ostringstream ss;
+			ss << f.rdbuf();
+			data = ss.str();
+		}
+
+		std::string range = server.get_range( "/file" );
+		if ( expect_resume )
+			check( range == as_str( (int)HAVE ) + "-", test, "download was not resumed" );
+		else
+			check( range.empty(), test, "download was resumed" );
+
+		check( data == full, test, "downloaded file doesn't match" );
+		check( !file_exists( name + ".part.url" ), test, "part url file left behind" );
+		delete_file( name );
+	}
+}
+
+int main( int argc, char *argv[] )
+{
+	nowide::args a( argc, argv );
+	std::string dir = ( argc > 1 ) ? argv[1] : "./";
+	if ( !dir.empty() && ( dir[ dir.size() - 1 ] != '/' ))
+		dir += '/';
+
+	fe_set_log_level( FeLog_Silent );
+
+#ifdef SFML_SYSTEM_WINDOWS
+	WSADATA wsa;
+	WSAStartup( MAKEWORD( 2, 2 ), &wsa );
+#endif
+	curl_global_init( CURL_GLOBAL_ALL );
+
+	FeTestServer server;
+	if ( !server.start() )
+	{
+		std::cout << "Unable to start the test server" << std::endl;
+		return 1;
+	}
+
+	test_completion( server );
+	test_retry( server );
+	test_failure( server );
+	test_limits( server );
+	test_file( server, dir );
+	test_resume( server, dir, server.get_base() + "/file", true );
+	test_resume( server, dir, server.get_base() + "/other", false );
+
+	server.stop();
+	curl_global_cleanup();
+
+	std::cout << ( g_failed ? "Network tests failed: " + as_str( g_failed ) : "Network tests passed" ) << std::endl;
+	return g_failed ? 1 : 0;
+}
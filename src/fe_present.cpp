@@ -33,6 +33,8 @@
 #include "zip.hpp"
 #include "base64.hpp"
 #include "image_loader.hpp"
+#include "fe_texture_pool.hpp"
+#include "fe_profiler.hpp"
 
 #include "BarlowCJK.ttf.h"
 #include "Logo.png.h"
@@ -43,6 +45,7 @@
 #include <limits>
 #include <cstring>
 #include <algorithm>
+#include <future>
 
 #include <SFML/Audio.hpp>
 
@@ -114,9 +117,25 @@ void FeFontContainer::set_font( const std::string &n )
 		FeLog() << "Error loading font from file: " << n << std::endl;
 }
 
+namespace
+{
+	std::future< std::vector<unsigned char> > g_default_font_decode;
+};
+
+void FeFontContainer::start_default_font_decode()
+{
+	if ( !g_default_font_decode.valid() )
+		g_default_font_decode = std::async( std::launch::async,
+			[]{ return base64_decode( _binary_resources_fonts_BarlowCJK_ttf ); } );
+}
+
 void FeFontContainer::load_default_font()
 {
-	m_font_binary_data = base64_decode( _binary_resources_fonts_BarlowCJK_ttf );
+	if ( g_default_font_decode.valid() )
+		m_font_binary_data = g_default_font_decode.get();
+	else
+		m_font_binary_data = base64_decode( _binary_resources_fonts_BarlowCJK_ttf );
+
 	std::ignore = m_font.openFromMemory( m_font_binary_data.data(), m_font_binary_data.size() );
 }
 
@@ -457,7 +476,7 @@ void FePresent::init_monitors()
  #endif
 #endif
 	{
-		FeMonitor mc( 0, m_window.get_win().getSize().x, m_window.get_win().getSize().y );
+		FeMonitor mc( 0, m_window.get_size().x, m_window.get_size().y );
 
 #ifdef SFML_SYSTEM_WINDOWS
 		//
@@ -507,6 +526,9 @@ void FePresent::clear_resources()
 	m_logo_image = NULL;
 	delete m_logo_full_image;
 	m_logo_full_image = NULL;
+
+	// the layout's shaders are gone, so this frees all cached programs
+	FeShaderCache::get_ref().purge_unused();
 }
 
 //
@@ -559,6 +581,19 @@ void FePresent::clear_layout()
 		delete t;
 	}
 
+	{
+		FeTexturePool &tp = FeTexturePool::get_ref();
+		int created, reused, freed;
+		tp.get_stats( created, reused, freed );
+		FeDebug() << "Texture pool: " << created << " created, " << reused << " reused, "
+			<< freed << " freed, " << tp.pool_count() << " pooled ("
+			<< tp.pool_bytes() / 1024 << " KBytes)" << std::endl;
+
+		int compiled;
+		FeShaderCache::get_ref().get_stats( compiled, reused );
+		FeDebug() << "Shader cache: " << compiled << " compiled, " << reused << " reused" << std::endl;
+	}
+
 	while ( !m_sounds.empty() )
 	{
 		FeSound *s = m_sounds.back();
@@ -694,6 +729,18 @@ void FePresent::draw( sf::RenderTarget& target, sf::RenderStates states ) const
 
 	if ( m_layout_crop )
 		target.setView( previous_view );
+
+	if ( !m_profile_summary.empty() && m_defaultFont )
+	{
+		sf::Text text( m_defaultFont->get_font(), m_profile_summary, 12 );
+		text.setOutlineColor( sf::Color::Black );
+		text.setOutlineThickness( 1.0f );
+		text.setPosition({ 4.0f, 4.0f });
+
+		target.setView( target.getDefaultView() );
+		target.draw( text );
+		target.setView( previous_view );
+	}
 }
 
 FeImage *FePresent::add_image( bool is_artwork,
@@ -1327,6 +1374,11 @@ int FePresent::get_current_filter_size() const
 	return m_feSettings->get_filter_size( m_feSettings->get_current_filter_index() );
 }
 
+bool FePresent::get_list_loading() const
+{
+	return m_feSettings->is_display_loading();
+}
+
 bool FePresent::get_clones_list_showing() const
 {
 	if ( m_feSettings->get_clone_index() >= 0 )
@@ -1470,7 +1522,7 @@ bool FePresent::handle_event( FeInputMap::Command c )
 
 	case FeInputMap::NextDisplay:
 	case FeInputMap::PrevDisplay:
-		if ( m_feSettings->navigate_display( ( c == FeInputMap::NextDisplay ) ? 1 : -1 ) )
+		if ( m_feSettings->navigate_display( ( c == FeInputMap::NextDisplay ) ? 1 : -1, false, true ) )
 			load_layout();
 		else
 		{
@@ -1573,6 +1625,7 @@ void FePresent::update_to( FeTransitionType type, bool reset_display )
 			// Fallthrough intended
 
 		case ToNewSelection:
+			FeTextureContainer::hand_off_artwork( m_texturePool, m_feSettings, ToNewSelection );
 			for ( itc = m_texturePool.begin(); itc != m_texturePool.end(); ++itc )
 				(*itc)->on_new_selection( m_feSettings );
 
@@ -1582,6 +1635,7 @@ void FePresent::update_to( FeTransitionType type, bool reset_display )
 			break;
 
 		case EndNavigation:
+			FeTextureContainer::hand_off_artwork( m_texturePool, m_feSettings, EndNavigation );
 			for ( itc = m_texturePool.begin(); itc != m_texturePool.end(); ++itc )
 				(*itc)->on_end_navigation( m_feSettings );
 			break;
@@ -1611,6 +1665,8 @@ bool FePresent::load_intro()
 	if ( !on_new_layout() )
 		return false;
 
+	FeShaderCache::get_ref().purge_unused();
+
 	update_to( ToNewList, true );
 	m_layout_time.start();
 	return ( !m_mon[0].elements.empty() );
@@ -1628,6 +1684,7 @@ void FePresent::load_screensaver()
 	//
 	m_layout_time.reset();
 	on_new_layout();
+	FeShaderCache::get_ref().purge_unused();
 
 	//
 	// if there is no screen saver script then do a blank screen
@@ -1666,6 +1723,9 @@ void FePresent::load_layout( bool initial_load )
 
 	on_new_layout();
 
+	// Free the previous layout's shader programs that weren't reused
+	FeShaderCache::get_ref().purge_unused();
+
 	// make things usable if the layout is empty
 	if ( !m_layout_has_content )
 	{
@@ -1687,15 +1747,46 @@ bool FePresent::tick()
 	m_frame_time = delta_time.asSeconds() * 1000.0f;
 
 	bool ret_val = false;
+
+	// Show the list once a background display load has it ready
+	if ( m_feSettings->poll_display_load() )
+	{
+		update_to( ToNewList, true );
+		on_transition( ToNewList, 0 );
+		ret_val = true;
+	}
+
 	if ( on_tick())
 		ret_val = true;
 
 	if ( video_tick() )
 		ret_val = true;
 
+	// Redraw once shaders compiled in the background are ready
+	if ( FeShaderCache::get_ref().poll() )
+		ret_val = true;
+
+	if ( FeScriptProfiler::is_enabled() )
+		FeScriptProfiler::count_frame();
+
+	// Refresh the on-screen script profile once a second
+	if ( FeScriptProfiler::is_enabled()
+			&& ( m_profile_clock.getElapsedTime() >= sf::seconds( 1 ) ))
+	{
+		get_default_font_container();
+		m_profile_summary = FeScriptProfiler::get_summary();
+		m_profile_clock.restart();
+		ret_val = true;
+	}
+
 	return ret_val;
 }
 
+void FePresent::step_layout_time()
+{
+	m_layout_time.tick();
+}
+
 bool FePresent::video_tick()
 {
 	bool ret_val=false;
@@ -2253,8 +2344,21 @@ void FeStableClock::reset()
 	m_time = sf::Time::Zero;
 }
 
+sf::Time FeStableClock::s_fixed_step = sf::Time::Zero;
+
+void FeStableClock::set_fixed_step( sf::Time step )
+{
+	s_fixed_step = step;
+}
+
 void FeStableClock::tick()
 {
+	if ( s_fixed_step != sf::Time::Zero )
+	{
+		m_time += s_fixed_step;
+		return;
+	}
+
 	if ( !m_real_timer.isRunning() )
 		m_real_timer.start();
 
@@ -2273,6 +2377,9 @@ void FeStableClock::tick()
 
 sf::Time FeStableClock::getElapsedTime()
 {
+	if ( s_fixed_step != sf::Time::Zero )
+		return m_time;
+
 	if ( !m_real_timer.isRunning() )
 		m_real_timer.start();
 
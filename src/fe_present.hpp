@@ -73,6 +73,10 @@ public:
 	void set_font( const std::string &n );
 	void load_default_font();
 
+	// Start decoding the built-in font on a background thread during start-up,
+	// load_default_font() picks up the result
+	static void start_default_font_decode();
+
 	const sf::Font &get_font() const;
 	const std::string &get_name() const { return m_name; };
 
@@ -120,9 +124,16 @@ public:
 	void tick();
 	sf::Time getElapsedTime();
 
+	// Set a fixed timestep (used by --benchmark).  When set, the clock only
+	// advances by exactly step on each tick() and never catches up with
+	// real time, so runs are reproducible however long frames take
+	static void set_fixed_step( sf::Time step );
+
 private:
 	sf::Clock m_real_timer;
 	sf::Time m_time;
+
+	static sf::Time s_fixed_step;
 };
 
 class FePresent
@@ -152,6 +163,8 @@ protected:
 	sf::Time m_layout_time_old;
 	float m_frame_time;
 	sf::Time m_lastInput;
+	std::string m_profile_summary; // on-screen script profile (--profile-scripts)
+	sf::Clock m_profile_clock;
 
 	FeSettings::RotationState m_baseRotation;
 	FeSettings::RotationState m_toggleRotation;
@@ -223,6 +236,7 @@ protected:
 	void set_filter_index( int );
 	int get_current_filter_size() const;
 	bool get_clones_list_showing() const;
+	bool get_list_loading() const;
 	Sqrat::Array get_tags_available() const;
 	int get_selection_index() const;
 	int get_sort_by() const;
@@ -268,6 +282,7 @@ public:
 	void redraw_surfaces();
 
 	bool tick(); // run vm on_tick and update videos.  return true if redraw required
+	void step_layout_time(); // advance the layout clock by one frame
 	bool video_tick(); // update videos only. return true if redraw required
 	void redraw(); // redraw the screen while doing computationally intensive loops
 
@@ -168,7 +168,7 @@ public:
 
 	FeShader *get_shader() const;
 	FeShader *script_get_shader() const;
-	void script_set_shader( FeShader *s );
+	virtual void script_set_shader( FeShader *s );
 
 	int get_zorder();
 	void set_zorder( int );
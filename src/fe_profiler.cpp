@@ -0,0 +1,338 @@
+/*
+ *
+ *  Attract-Mode Plus frontend
+ *  Copyright (C) 2025 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode Plus
+ *
+ *  Attract-Mode Plus is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode Plus is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode Plus.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "fe_profiler.hpp"
+#include "fe_base.hpp" // logging
+#include "fe_util.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include "nowide/fstream.hpp"
+
+bool FeScriptProfiler::s_enabled = false;
+
+namespace
+{
+	// Running count of squirrel allocations, see sq_vm_malloc() below
+	SQUnsignedInteger sq_vm_alloc_count = 0;
+
+	typedef std::chrono::steady_clock fe_clock;
+
+	struct FeProfileStat
+	{
+		unsigned int calls=0;
+		fe_clock::duration total=fe_clock::duration::zero();
+		fe_clock::duration self=fe_clock::duration::zero();
+		fe_clock::duration max=fe_clock::duration::zero();
+		SQUnsignedInteger allocs=0;
+	};
+
+	struct FeProfileFrame
+	{
+		std::string key;
+		fe_clock::time_point start;
+		fe_clock::duration children;
+		SQUnsignedInteger allocs;
+		size_t fn_depth;
+	};
+
+	typedef std::map<std::string, FeProfileStat> FeProfileMap;
+
+	std::string g_report_file;
+	fe_clock::time_point g_start;
+
+	FeProfileMap g_callbacks;
+	FeProfileMap g_functions;
+	std::vector<FeProfileFrame> g_cb_stack;
+	std::vector<FeProfileFrame> g_fn_stack;
+
+	// callbacks since the last on-screen summary
+	FeProfileMap g_window;
+	fe_clock::duration g_window_total=fe_clock::duration::zero();
+	int g_window_frames=0;
+
+	double to_ms( fe_clock::duration d )
+	{
+		return std::chrono::duration<double, std::milli>( d ).count();
+	}
+
+	void push_frame( std::vector<FeProfileFrame> &stack, const std::string &key )
+	{
+		FeProfileFrame f;
+		f.key = key;
+		f.children = fe_clock::duration::zero();
+		f.allocs = sq_vm_alloc_count;
+		f.fn_depth = g_fn_stack.size();
+		f.start = fe_clock::now();
+		stack.push_back( f );
+	}
+
+	//
+	// Pop the top frame off the stack, add it to the stats in m and
+	// return its total duration
+	//
+	fe_clock::duration pop_frame( std::vector<FeProfileFrame> &stack, FeProfileMap &m )
+	{
+		const FeProfileFrame &f = stack.back();
+		fe_clock::duration elapsed = fe_clock::now() - f.start;
+
+		FeProfileStat &s = m[ f.key ];
+		s.calls++;
+		s.total += elapsed;
+		s.self += elapsed - f.children;
+		s.allocs += sq_vm_alloc_count - f.allocs;
+		if ( elapsed > s.max )
+			s.max = elapsed;
+
+		stack.pop_back();
+		if ( !stack.empty() )
+			stack.back().children += elapsed;
+
+		return elapsed;
+	}
+
+	void profile_hook( HSQUIRRELVM,
+		SQInteger type,
+		const SQChar *src,
+		SQInteger line,
+		const SQChar *fname )
+	{
+		if ( type == 'c' )
+		{
+			// line is the first line of the function at this point, which
+			// tells apart anonymous functions from the same file
+			std::string key = fname ? fname : "(anonymous)";
+			key += " (";
+			key += src ? path_filename( src ) : "?";
+			key += ":";
+			key += as_str( (int)line );
+			key += ")";
+
+			push_frame( g_fn_stack, key );
+		}
+		else if (( type == 'r' ) && !g_fn_stack.empty() )
+			pop_frame( g_fn_stack, g_functions );
+	}
+
+	template <class T>
+	void sorted_by( const FeProfileMap &m,
+		T cmp,
+		std::vector<FeProfileMap::const_iterator> &out )
+	{
+		out.clear();
+		out.reserve( m.size() );
+		for ( FeProfileMap::const_iterator itr=m.begin(); itr!=m.end(); ++itr )
+			out.push_back( itr );
+
+		std::sort( out.begin(), out.end(), cmp );
+	}
+
+	bool total_cmp( FeProfileMap::const_iterator a, FeProfileMap::const_iterator b )
+	{
+		return a->second.total > b->second.total;
+	}
+
+	bool self_cmp( FeProfileMap::const_iterator a, FeProfileMap::const_iterator b )
+	{
+		return a->second.self > b->second.self;
+	}
+};
+
+void FeScriptProfiler::enable( const std::string &report_file )
+{
+	s_enabled = true;
+	g_report_file = report_file;
+	g_start = fe_clock::now();
+
+	FeLog() << " - Script profiling enabled, report file: " << report_file << std::endl;
+}
+
+void FeScriptProfiler::attach( HSQUIRRELVM vm )
+{
+	if ( !s_enabled )
+		return;
+
+	// Any frames left over belong to the vm that was just closed
+	g_fn_stack.clear();
+	sq_setnativedebughook( vm, profile_hook );
+}
+
+void FeScriptProfiler::begin_callback( const char *kind,
+	const std::string &name,
+	const std::string &source )
+{
+	std::string key = kind;
+	key += ": ";
+	key += name;
+	if ( !source.empty() )
+	{
+		key += " (";
+		key += source;
+		key += ")";
+	}
+
+	push_frame( g_cb_stack, key );
+}
+
+void FeScriptProfiler::end_callback()
+{
+	if ( g_cb_stack.empty() )
+		return;
+
+	// Drop any function frames that did not see a return (vm closed or
+	// replaced from inside the callback)
+	if ( g_fn_stack.size() > g_cb_stack.back().fn_depth )
+		g_fn_stack.resize( g_cb_stack.back().fn_depth );
+
+	FeProfileFrame f = g_cb_stack.back();
+	fe_clock::duration elapsed = pop_frame( g_cb_stack, g_callbacks );
+
+	FeProfileStat &s = g_window[ f.key ];
+	s.calls++;
+	s.total += elapsed;
+	s.allocs += sq_vm_alloc_count - f.allocs;
+
+	if ( g_cb_stack.empty() )
+		g_window_total += elapsed;
+}
+
+void FeScriptProfiler::count_frame()
+{
+	g_window_frames++;
+}
+
+std::string FeScriptProfiler::get_summary( int max_lines )
+{
+	double frames = std::max( 1, g_window_frames );
+
+	std::ostringstream ss;
+	ss << std::fixed << std::setprecision( 2 )
+		<< "Script: " << to_ms( g_window_total ) / frames << " ms/frame (average of "
+		<< g_window_frames << " frames)";
+
+	std::vector<FeProfileMap::const_iterator> order;
+	sorted_by( g_window, total_cmp, order );
+
+	for ( int i=0; ( i < max_lines ) && ( i < (int)order.size() ); i++ )
+	{
+		const FeProfileStat &s = order[i]->second;
+		ss << "\n" << to_ms( s.total ) / frames << " ms  " << s.calls / frames << " calls  "
+			<< s.allocs / frames << " allocs  " << order[i]->first;
+	}
+
+	g_window.clear();
+	g_window_total = fe_clock::duration::zero();
+	g_window_frames = 0;
+
+	return ss.str();
+}
+
+bool FeScriptProfiler::write_report()
+{
+	if ( !s_enabled )
+		return false;
+
+	nowide::ofstream file( g_report_file.c_str() );
+	if ( !file.is_open() )
+	{
+		FeLog() << "Error writing script profile: " << g_report_file << std::endl;
+		return false;
+	}
+
+	std::vector<FeProfileMap::const_iterator> order;
+
+	file << std::fixed << std::setprecision( 3 )
+		<< "# Attract-Mode Plus script profile" << std::endl
+		<< "# session: " << to_ms( fe_clock::now() - g_start ) / 1000.0 << " s" << std::endl
+		<< "# times are in milliseconds, allocs counts squirrel vm allocations" << std::endl
+		<< std::endl
+		<< "## Callbacks (inclusive)" << std::endl
+		<< std::setw( 10 ) << "calls"
+		<< std::setw( 12 ) << "total"
+		<< std::setw( 10 ) << "avg"
+		<< std::setw( 10 ) << "max"
+		<< std::setw( 12 ) << "allocs"
+		<< "  name" << std::endl;
+
+	sorted_by( g_callbacks, total_cmp, order );
+	for ( size_t i=0; i<order.size(); i++ )
+	{
+		const FeProfileStat &s = order[i]->second;
+		file << std::setw( 10 ) << s.calls
+			<< std::setw( 12 ) << to_ms( s.total )
+			<< std::setw( 10 ) << to_ms( s.total ) / s.calls
+			<< std::setw( 10 ) << to_ms( s.max )
+			<< std::setw( 12 ) << s.allocs
+			<< "  " << order[i]->first << std::endl;
+	}
+
+	file << std::endl
+		<< "## Functions (by self time)" << std::endl
+		<< std::setw( 10 ) << "calls"
+		<< std::setw( 12 ) << "self"
+		<< std::setw( 12 ) << "total"
+		<< std::setw( 10 ) << "max"
+		<< std::setw( 12 ) << "allocs"
+		<< "  function" << std::endl;
+
+	sorted_by( g_functions, self_cmp, order );
+	for ( size_t i=0; i<order.size(); i++ )
+	{
+		const FeProfileStat &s = order[i]->second;
+		file << std::setw( 10 ) << s.calls
+			<< std::setw( 12 ) << to_ms( s.self )
+			<< std::setw( 12 ) << to_ms( s.total )
+			<< std::setw( 10 ) << to_ms( s.max )
+			<< std::setw( 12 ) << s.allocs
+			<< "  " << order[i]->first << std::endl;
+	}
+
+	FeLog() << "Wrote script profile: " << g_report_file << std::endl;
+	return true;
+}
+
+//
+// Squirrel's allocation functions, which the vm calls for all of its
+// memory.  Defined here in place of extlibs' sqmem.cpp (left out of the
+// squirrel library by the Makefile) so that allocations can be counted
+//
+void *sq_vm_malloc( SQUnsignedInteger size )
+{
+	sq_vm_alloc_count++;
+	return malloc( size );
+}
+
+void *sq_vm_realloc( void *p, SQUnsignedInteger, SQUnsignedInteger size )
+{
+	sq_vm_alloc_count++;
+	return realloc( p, size );
+}
+
+void sq_vm_free( void *p, SQUnsignedInteger )
+{
+	free( p );
+}
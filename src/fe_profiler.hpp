@@ -0,0 +1,90 @@
+/*
+ *
+ *  Attract-Mode Plus frontend
+ *  Copyright (C) 2025 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode Plus
+ *
+ *  Attract-Mode Plus is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode Plus is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode Plus.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FE_PROFILER_HPP
+#define FE_PROFILER_HPP
+
+#include <string>
+#include <squirrel.h>
+
+//
+// Script profiler, enabled with the --profile-scripts command line option
+//
+// Times each script callback made by the frontend (ticks, transitions,
+// signal handlers, magic tokens and script loads) and, using the vm's
+// native debug hook, every squirrel function called while they run.
+// Squirrel allocations are counted against both.  The full report is
+// written when the frontend exits.
+//
+class FeScriptProfiler
+{
+public:
+	static void enable( const std::string &report_file );
+	static bool is_enabled() { return s_enabled; }
+
+	// Install the call/return hook on a newly opened vm
+	static void attach( HSQUIRRELVM vm );
+
+	static void begin_callback( const char *kind,
+		const std::string &name,
+		const std::string &source );
+	static void end_callback();
+
+	// Called once a frame, so that get_summary() can give per-frame figures
+	static void count_frame();
+
+	// Returns a few lines describing the costliest callbacks since the
+	// previous call, averaged per frame, for on-screen display
+	static std::string get_summary( int max_lines=5 );
+
+	static bool write_report();
+
+private:
+	static bool s_enabled;
+};
+
+class FeProfileScope
+{
+public:
+	FeProfileScope( const char *kind,
+			const std::string &name,
+			const std::string &source="" )
+		: m_active( FeScriptProfiler::is_enabled() )
+	{
+		if ( m_active )
+			FeScriptProfiler::begin_callback( kind, name, source );
+	}
+
+	~FeProfileScope()
+	{
+		if ( m_active )
+			FeScriptProfiler::end_callback();
+	}
+
+private:
+	FeProfileScope( const FeProfileScope & );
+	FeProfileScope &operator=( const FeProfileScope & );
+
+	bool m_active;
+};
+
+#endif
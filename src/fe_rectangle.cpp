@@ -621,9 +621,12 @@ void FeRectangle::draw( sf::RenderTarget &target, sf::RenderStates states ) cons
 	FeShader *s = get_shader();
 	if ( s )
 	{
+		// Draw with the blend mode's shader until a background compile is done
 		const sf::Shader *sh = s->get_shader();
 		if ( sh )
 			states.shader = sh;
+		else if ( s->is_compiling() )
+			states.shader = FeBlend::get_default_shader( m_blend_mode, false );
 	}
 	else
 		states.shader = FeBlend::get_default_shader( m_blend_mode, false );
@@ -30,6 +30,10 @@
 #include <algorithm>
 #include <numeric>
 #include <random>
+#include <cstring>
+#include <atomic>
+#include <cctype>
+#include <chrono>
 
 #include <squirrel.h>
 #include <sqstdstring.h>
@@ -43,12 +47,82 @@ const char *FE_STATS_SUBDIR				= "stats/";
 
 namespace
 {
+	// Source of FeRomList filter versions, shared so that lists swapped in
+	// by the background loader never reuse a version
+	std::atomic<unsigned int> g_filters_version( 0 );
+
 	std::mt19937 rnd{ std::random_device{}() };
 
 	bool fe_not_clone( const FeRomInfo &r )
 	{
 		return r.get_info( FeRomInfo::Cloneof ).empty();
 	}
+
+	inline bool is_romlist_whitespace( const char c )
+	{
+		return ( c == ' ' ) || ( c == '\t' ) || ( c == '\r' );
+	}
+
+	//
+	// Read the next ';' separated field of [p,end) into token, using the same
+	// rules as token_helper(): surrounding whitespace is trimmed, and a field
+	// starting with a quote runs to the closing quote (unescaping \") with
+	// anything after it up to the separator ignored.
+	//
+	// Returns the position after the field's separator, or end if there is none
+	//
+	const char *read_romlist_field( const char *p, const char *end, std::string &token )
+	{
+		token.clear();
+
+		while (( p < end ) && is_romlist_whitespace( *p )) p++;
+		if ( p >= end )
+			return end;
+
+		if ( *p != '"' )
+		{
+			const char *sep = (const char *)memchr( p, ';', end - p );
+			const char *e = sep ? sep : end;
+
+			while (( e > p ) && is_romlist_whitespace( e[-1] )) e--;
+			token.assign( p, e - p );
+
+			return sep ? sep + 1 : end;
+		}
+
+		p++;
+		while (( p < end ) && is_romlist_whitespace( *p )) p++;
+
+		while ( p < end )
+		{
+			const char *q = (const char *)memchr( p, '"', end - p );
+			if ( !q )
+			{
+				token.append( p, end - p );
+				p = end;
+				break;
+			}
+
+			if (( q > p ) && ( q[-1] == '\\' ))
+			{
+				// escaped quote
+				token.append( p, q - p - 1 );
+				token += '"';
+				p = q + 1;
+				continue;
+			}
+
+			token.append( p, q - p );
+			p = q;
+			break;
+		}
+
+		while ( !token.empty() && is_romlist_whitespace( token.back() ))
+			token.pop_back();
+
+		const char *sep = (const char *)memchr( p, ';', end - p );
+		return sep ? sep + 1 : end;
+	}
 };
 
 FeRomListSorter::FeRomListSorter( FeRomInfo::Index c, bool rev )
@@ -79,12 +153,17 @@ bool FeRomListSorter::operator()( const FeRomInfo &one_obj, const FeRomInfo &two
 }
 
 FeRomList::FeRomList( const std::string &config_path )
-	: m_config_path( config_path ),
+	: m_global_filter_ptr( NULL ),
+	m_config_path( config_path ),
 	m_fav_changed( false ),
 	m_tags_changed( false ),
 	m_availability_checked( false ),
 	m_played_stats_checked( false ),
-	m_group_clones( true )
+	m_group_clones( true ),
+	m_comparisons( 0 ),
+	m_filters_version( ++g_filters_version ),
+	m_cold_resident( true ),
+	m_cold_stamp( 0 )
 {
 }
 
@@ -99,15 +178,19 @@ void FeRomList::init_as_empty_list()
 	m_list.clear();
 	m_filtered_list.clear();
 	m_filtered_list.push_back( FeFilterEntry() ); // there always has to be at least one filter
+	m_filters_version = ++g_filters_version;
 	m_tags.clear();
 	m_extra_favs.clear();
 	m_extra_tags.clear();
+	m_rom_ids.clear();
 
 	m_availability_checked = false;
 	m_played_stats_checked = false;
 	m_group_clones = true;
 	m_fav_changed = false;
 	m_tags_changed = false;
+	m_cold_resident = true;
+	m_cold_stamp = 0;
 }
 
 void FeRomList::mark_favs_and_tags_changed()
@@ -175,6 +258,9 @@ int FeRomList::load_romlist_data(
 	FeFilter *global_filter = display.get_global_filter();
 	bool has_global_rules = global_filter && ( global_filter->get_rule_count() > 0 );
 
+	// Cold fields are only read on demand unless a filter or sort needs them
+	m_cold_resident = display.test_for_targets({ FeRomInfo::Extra });
+
 	// Load globalfilter cache ( if has global rules )
 	if ( has_global_rules && FeCache::load_globalfilter( display, *this ) )
 		return RomlistResponse::Loaded_Global;
@@ -189,7 +275,7 @@ int FeRomList::load_romlist_data(
 	FeCache::save_display( display, *this );
 
 	// Load romlist from file
-	if ( !FeBaseConfigurable::load_from_file( m_romlist_path, ";" ) )
+	if ( !load_romlist_file( m_romlist_path ) )
 		return RomlistResponse::Loaded_None;
 
 	// If grouping by clones, partition the list so masters are ordered before clones
@@ -197,11 +283,163 @@ int FeRomList::load_romlist_data(
 	if ( m_group_clones )
 		std::stable_partition( m_list.begin(), m_list.end(), fe_not_clone );
 
+	save_cold_fields();
+
 	return FeCache::save_romlist( *this )
 		? RomlistResponse::Loaded_File | RomlistResponse::Saved_Romlist
 		: RomlistResponse::Loaded_File;
 }
 
+bool FeRomList::save_cold_fields()
+{
+	m_cold_stamp = 0;
+
+	// Each segment gets a new file, so roms of a romlist loaded earlier keep
+	// reading the one they point into.  Offsets are only handed to the roms
+	// once the whole segment is written
+	std::uint64_t stamp = std::chrono::system_clock::now().time_since_epoch().count() | 1;
+	std::string path = FeCache::get_romlist_extra_filename( *this, stamp );
+	if ( path.empty() )
+		return false;
+
+	std::vector<std::int64_t> offsets;
+	offsets.reserve( m_list.size() );
+
+	nowide::ofstream file( path, std::ios::binary );
+	if ( !file.is_open() )
+		return false;
+
+	FeRomColdStore::write_header( file, stamp );
+	for ( FeRomInfoListType::const_iterator itr=m_list.begin(); itr!=m_list.end(); ++itr )
+	{
+		const std::string &extra = (*itr).get_info( FeRomInfo::Extra );
+		offsets.push_back( extra.empty() ? -1 : FeRomColdStore::write_record( file, extra ) );
+	}
+
+	file.close();
+	if ( file.fail() )
+	{
+		FeLog() << "Error writing romlist extra info: " << path << std::endl;
+		delete_file( path );
+		return false;
+	}
+
+	std::shared_ptr<FeRomColdStore> store;
+	if ( !m_cold_resident )
+	{
+		store = std::make_shared<FeRomColdStore>( path, stamp );
+		if ( !store->open() )
+		{
+			FeLog() << "Error reading romlist extra info: " << path << std::endl;
+			delete_file( path );
+			return false;
+		}
+	}
+
+	std::vector<std::int64_t>::const_iterator ito = offsets.begin();
+	for ( FeRomInfoListType::iterator itr=m_list.begin(); itr!=m_list.end(); ++itr, ++ito )
+		(*itr).set_cold( *ito, ( *ito >= 0 ) ? store : nullptr );
+
+	m_cold_stamp = stamp;
+	FeCache::delete_romlist_extra( *this, stamp );
+	return true;
+}
+
+bool FeRomList::load_cold_fields( std::uint64_t stamp )
+{
+	m_cold_stamp = stamp;
+	if ( stamp == 0 )
+		return true;
+
+	std::shared_ptr<FeRomColdStore> store = std::make_shared<FeRomColdStore>(
+		FeCache::get_romlist_extra_filename( *this, stamp ), stamp );
+
+	if ( m_cold_resident )
+	{
+		nowide::ifstream file;
+		if ( !store->open( file ) )
+			return false;
+
+		for ( FeRomInfoListType::iterator itr=m_list.begin(); itr!=m_list.end(); ++itr )
+		{
+			if ( !(*itr).load_cold( file ) )
+				return false;
+		}
+		return true;
+	}
+
+	if ( !store->open() )
+		return false;
+
+	for ( FeRomInfoListType::iterator itr=m_list.begin(); itr!=m_list.end(); ++itr )
+	{
+		std::int64_t offset = (*itr).get_cold_offset();
+		if ( offset >= 0 )
+			(*itr).set_cold( offset, store );
+	}
+
+	return true;
+}
+
+//
+// Read the whole file in one go and parse it in place.  Lines are split the
+// same way load_from_file() does with the ";" separator, and fields the same
+// way as FeRomInfo::process_setting(), but without copying each line and each
+// value into strings first
+//
+bool FeRomList::load_romlist_file( const std::string &filename )
+{
+	nowide::ifstream file( filename, std::ios::binary );
+	if ( !file.is_open() )
+		return false;
+
+	file.seekg( 0, std::ios::end );
+	std::streamoff size = file.tellg();
+	file.seekg( 0, std::ios::beg );
+
+	if ( size < 0 )
+		return false;
+
+	std::vector<char> buff( (size_t)size );
+	if (( size > 0 ) && !file.read( buff.data(), size ))
+		return false;
+
+	file.close();
+
+	const char *p = buff.data();
+	const char *end = p + buff.size();
+	std::string name, token;
+
+	while ( p < end )
+	{
+		const char *eol = (const char *)memchr( p, '\n', end - p );
+		if ( !eol )
+			eol = end;
+
+		const char *f = read_romlist_field( p, eol, name );
+
+		// skip empty lines and comments
+		if ( !name.empty() && ( name[0] != '#' ))
+		{
+			m_list.emplace_back( name );
+			FeRomInfo &rom = m_list.back();
+
+			for ( int i=1; i < FeRomInfo::LAST_INFO; i++ )
+			{
+				f = read_romlist_field( f, eol, token );
+				if ( !token.empty() )
+					rom.set_info( (FeRomInfo::Index)i, token );
+			}
+
+			rom.index = m_list.size() - 1; // index for filter cache
+		}
+
+		p = eol + 1;
+	}
+
+	return true;
+}
+
 //
 // Used during load_from_file to append rom to m_list
 //
@@ -383,6 +621,11 @@ int FeRomList::apply_global_filter(
 	if ( last_it != m_list.end() )
 		m_list.erase( last_it, m_list.end() );
 
+	// Renumber the remaining roms so their ids stay dense
+	int index = 0;
+	for ( FeRomInfoListType::iterator it=m_list.begin(); it!=m_list.end(); ++it )
+		it->index = index++;
+
 	// Save globalfilter cache for next time
 	return FeCache::save_globalfilter( display, *this )
 		? RomlistResponse::Filtered_Global | RomlistResponse::Saved_Global
@@ -414,6 +657,8 @@ bool FeRomList::load_romlist(
 	bool test_shuffle = display.test_for_targets({ FeRomInfo::Shuffle });
 	std::map<std::string, std::vector<std::string>> emu_roms;
 
+	// Stats are read back from disk below, so wait for pending writes
+	FeStatsWriter::get_ref().flush();
 	FeCache::clear_stats();
 	if ( FeCache::validate_romlistmeta( *this ) && FeCache::validate_display( display, *this ) && test_available )
 		FeCache::validate_available( *this, emu_roms );
@@ -458,6 +703,7 @@ void FeRomList::build_single_filter_list(
 	build_filter_entry( f, result );
 	if ( f ) f->set_size( result.filter_list.size() ); // Store size of pre-limited list
 	sort_filter_entry( f, result );
+	result.build_indexes();
 }
 
 inline void FeRomList::add_group_entry(
@@ -605,8 +851,28 @@ void FeRomList::get_clone_group(
 	}
 }
 
+int FeRomList::find_rom( int filter_idx, const FeRomInfo &rom ) const
+{
+	if (( filter_idx < 0 ) || ( filter_idx >= (int)m_filtered_list.size() ))
+		return -1;
+
+	if (( rom.index >= 0 ) && ( rom.index < (int)m_rom_ids.size() ) && ( m_rom_ids[ rom.index ] == &rom ))
+		return m_filtered_list[filter_idx].get_position( rom.index );
+
+	return m_filtered_list[filter_idx].find( rom );
+}
+
+int FeRomList::get_letter_offset( int filter_idx, int idx, int step ) const
+{
+	if (( filter_idx < 0 ) || ( filter_idx >= (int)m_filtered_list.size() ))
+		return 0;
+
+	return m_filtered_list[filter_idx].get_letter_offset( idx, step );
+}
+
 void FeRomList::create_filters(
-	FeDisplayInfo &display )
+	FeDisplayInfo &display,
+	const std::atomic<bool> *cancel )
 {
 	// create_filters may be called by update_romlist_after_edit
 	// - we must validate AGAIN to clear any filters the rom may now appear in
@@ -615,51 +881,128 @@ void FeRomList::create_filters(
 
 	sf::Clock load_timer;
 
-	// Prepare an indexed lookup for filter cache loading
-	std::map<int, FeRomInfo*> lookup;
-	for ( FeRomInfoListType::iterator it=m_list.begin(); it!=m_list.end(); ++it )
-		lookup[it->index] = &(*it);
+	// Prepare the id lookup for filter cache loading
+	build_rom_ids();
 
 	// If no filters configured create a single filter containing entire romlist
 	int filters_count = std::max( display.get_filter_count(), 1 );
+	int filters_built = 0;
 	int filters_cached = 0;
 	m_comparisons = 0;
 
 	// Apply filters
 	m_filtered_list.clear();
-	m_filtered_list.reserve( filters_count );
+	m_filtered_list.resize( filters_count );
+	m_filters_version = ++g_filters_version;
 	for ( int i=0; i<filters_count; i++ )
 	{
-		m_filtered_list.push_back( FeFilterEntry() );
+		if ( cancel && *cancel )
+			break;
 
-		// Attempt to load filter from cache
-		if ( FeCache::load_filter( display, m_filtered_list[i], i, lookup ) )
-		{
+		if ( load_filter_entry( display, i, m_filtered_list[i], m_rom_ids ) )
 			filters_cached++;
-			continue;
-		}
 
-		// If no cache, build and save the filter from scratch
-		build_single_filter_list( display.get_filter( i ), m_filtered_list[i] );
-		FeCache::save_filter( display, m_filtered_list[i], i );
-	}
-
-	// Keep the rom_index for each filter in-range by wrapping it
-	// - This feature is used by show_random_selection which set a random index before knowing the list size
-	for ( int i=0; i<filters_count; i++ )
-	{
-		int filter_list_count = (int)m_filtered_list[i].filter_list.size();
-		display.set_rom_index( i, filter_list_count ? display.get_rom_index( i ) % filter_list_count : 0 );
+		wrap_rom_index( display, i );
+		filters_built++;
 	}
 
 	FeLog() << " - Loaded filters in "
 		<< load_timer.getElapsedTime().asMilliseconds() << " ms ("
-		<< filters_count << " filters, "
+		<< filters_built << " of " << filters_count << " filters, "
 		<< filters_cached << " from cache, "
 		<< m_comparisons << " comparisons"
 		<< ")" << std::endl;
 }
 
+//
+// Populate the entry for the given filter from cache, or build it from scratch (and cache it)
+// - Returns true if the entry was loaded from cache
+//
+bool FeRomList::load_filter_entry(
+	FeDisplayInfo &display,
+	int filter_idx,
+	FeFilterEntry &entry,
+	const std::vector<FeRomInfo*> &lookup )
+{
+	if ( FeCache::load_filter( display, entry, filter_idx, lookup ) )
+		return true;
+
+	build_single_filter_list( display.get_filter( filter_idx ), entry );
+	FeCache::save_filter( display, entry, filter_idx );
+	return false;
+}
+
+//
+// Map each FeRomInfo::index to its rom in m_list.  Ids are dense unless the
+// list was loaded from an older cache, roms without a usable id (i.e. copies
+// inserted by an edit) are given a fresh one
+//
+void FeRomList::build_rom_ids()
+{
+	int max_index = -1;
+	for ( FeRomInfoListType::const_iterator it=m_list.begin(); it!=m_list.end(); ++it )
+		max_index = std::max( max_index, it->index );
+
+	m_rom_ids.assign( max_index + 1, NULL );
+
+	std::vector<FeRomInfo*> unassigned;
+	for ( FeRomInfoListType::iterator it=m_list.begin(); it!=m_list.end(); ++it )
+	{
+		if (( it->index >= 0 ) && !m_rom_ids[ it->index ] )
+			m_rom_ids[ it->index ] = &(*it);
+		else
+			unassigned.push_back( &(*it) );
+	}
+
+	for ( std::vector<FeRomInfo*>::iterator it=unassigned.begin(); it!=unassigned.end(); ++it )
+		add_rom_id( **it );
+}
+
+void FeRomList::add_rom_id( FeRomInfo &rom )
+{
+	rom.index = m_rom_ids.size();
+	m_rom_ids.push_back( &rom );
+}
+
+void FeRomList::clear_rom_id( const FeRomInfo &rom )
+{
+	if (( rom.index >= 0 ) && ( rom.index < (int)m_rom_ids.size() ) && ( m_rom_ids[ rom.index ] == &rom ))
+		m_rom_ids[ rom.index ] = NULL;
+}
+
+//
+// Keep the rom_index for the filter in-range by wrapping it
+// - This feature is used by show_random_selection which set a random index before knowing the list size
+//
+void FeRomList::wrap_rom_index( FeDisplayInfo &display, int filter_idx ) const
+{
+	int filter_list_count = filter_size( filter_idx );
+	display.set_rom_index( filter_idx, filter_list_count ? display.get_rom_index( filter_idx ) % filter_list_count : 0 );
+}
+
+void FeRomList::swap( FeRomList &o )
+{
+	m_list.swap( o.m_list );
+	m_filtered_list.swap( o.m_filtered_list );
+	m_emulators.swap( o.m_emulators );
+	m_tags.swap( o.m_tags );
+	m_extra_favs.swap( o.m_extra_favs );
+	m_extra_tags.swap( o.m_extra_tags );
+	std::swap( m_global_filter_ptr, o.m_global_filter_ptr );
+	m_romlist_path.swap( o.m_romlist_path );
+	m_romlist_name.swap( o.m_romlist_name );
+	std::swap( m_fav_changed, o.m_fav_changed );
+	std::swap( m_tags_changed, o.m_tags_changed );
+	std::swap( m_availability_checked, o.m_availability_checked );
+	std::swap( m_played_stats_checked, o.m_played_stats_checked );
+	std::swap( m_group_clones, o.m_group_clones );
+	std::swap( m_comparisons, o.m_comparisons );
+	std::swap( m_filters_version, o.m_filters_version );
+	m_rom_ids.swap( o.m_rom_ids );
+	std::swap( m_cold_resident, o.m_cold_resident );
+	std::swap( m_cold_stamp, o.m_cold_stamp );
+}
+
 //
 // Save changed favs and tags
 //
@@ -906,6 +1249,9 @@ bool FeRomList::fix_filters( FeDisplayInfo &display, std::set<FeRomInfo::Index>
 		}
 	}
 
+	if ( retval )
+		m_filters_version = ++g_filters_version;
+
 	return retval;
 }
 
@@ -945,7 +1291,7 @@ void FeRomList::get_file_availability(
 		}
 
 		// convert to set for faster find
-		std::set<std::string> rom_set( rom_names.begin(), rom_names.end() );
+		std::unordered_set<std::string> rom_set( rom_names.begin(), rom_names.end() );
 
 		// For each rom, check if it's in the romname set
 		for ( std::vector<FeRomInfo*>::iterator itr=(*ite).second.begin(); itr!=(*ite).second.end(); ++itr )
@@ -1146,6 +1492,122 @@ void FeRomList::delete_emulator( const std::string & emu )
 	}
 }
 
+// -------------------------------------------------------------------------------------
+// FeFilterEntry
+
+char FeFilterEntry::get_letter_key( const FeRomInfo &rom )
+{
+	const std::string &title = rom.get_sort_title();
+	if ( title.empty() )
+		return ' ';
+
+	unsigned char c = std::tolower( (unsigned char)title[0] );
+	return std::isalpha( c ) ? c : ' ';
+}
+
+void FeFilterEntry::build_indexes()
+{
+	letter_starts.clear();
+	positions.clear();
+
+	int max_index = -1;
+	for ( std::vector<FeRomInfo*>::const_iterator it=filter_list.begin(); it!=filter_list.end(); ++it )
+		max_index = std::max( max_index, (*it)->index );
+
+	positions.resize( max_index + 1, -1 );
+
+	char last = 0;
+	for ( int i=0; i<(int)filter_list.size(); i++ )
+	{
+		const FeRomInfo &rom = *filter_list[i];
+		if ( rom.index >= 0 )
+			positions[ rom.index ] = i;
+
+		char key = get_letter_key( rom );
+		if (( i > 0 ) && ( key != last ))
+			letter_starts.push_back( i );
+
+		last = key;
+	}
+}
+
+bool FeFilterEntry::check_indexes() const
+{
+	int size = filter_list.size();
+	for ( int i=0; i<(int)letter_starts.size(); i++ )
+	{
+		if (( letter_starts[i] <= 0 ) || ( letter_starts[i] >= size )
+				|| (( i > 0 ) && ( letter_starts[i] <= letter_starts[i-1] )))
+			return false;
+	}
+
+	for ( std::vector<int>::const_iterator it=positions.begin(); it!=positions.end(); ++it )
+	{
+		if ( *it >= size )
+			return false;
+	}
+
+	return filter_list.empty() || !positions.empty();
+}
+
+int FeFilterEntry::find( const FeRomInfo &rom ) const
+{
+	if (( rom.index >= 0 ) && ( rom.index < (int)positions.size() ))
+	{
+		int p = positions[ rom.index ];
+		if (( p >= 0 ) && (( filter_list[p] == &rom ) || ( *filter_list[p] == rom )))
+			return p;
+	}
+
+	// rom may be a copy with a different index (i.e. from an edit), so fall back to a search
+	for ( int i=0; i<(int)filter_list.size(); i++ )
+	{
+		if ( *filter_list[i] == rom )
+			return i;
+	}
+
+	return -1;
+}
+
+//
+// Equivalent to stepping through the list one rom at a time (wrapping
+// around) until the letter key changes, but using letter_starts.
+//
+int FeFilterEntry::get_letter_offset( int idx, int step ) const
+{
+	int size = filter_list.size();
+	if (( idx < 0 ) || ( idx >= size ) || letter_starts.empty() )
+		return 0;
+
+	char key = get_letter_key( *filter_list[idx] );
+
+	// the first letter start after idx
+	std::vector<int>::const_iterator next
+		= std::upper_bound( letter_starts.begin(), letter_starts.end(), idx );
+
+	int t_idx;
+	if ( step > 0 )
+	{
+		if ( next != letter_starts.end() )
+			t_idx = *next;
+		else if ( get_letter_key( *filter_list[0] ) != key )
+			t_idx = 0;
+		else
+			t_idx = letter_starts.front();
+	}
+	else
+	{
+		if ( next != letter_starts.begin() )
+			t_idx = *( next - 1 ) - 1; // the entry before idx's letter group
+		else if ( get_letter_key( *filter_list[ size - 1 ] ) != key )
+			t_idx = size - 1;
+		else
+			t_idx = letter_starts.back() - 1;
+	}
+
+	return t_idx - idx;
+}
+
 // -------------------------------------------------------------------------------------
 // FeFilterIndexes
 
@@ -1173,23 +1635,24 @@ bool FeFilterIndexes::filter_list_to_indexes(
 bool FeFilterIndexes::indexes_to_filter_list(
 	const std::vector<int> &indexes,
 	std::vector<FeRomInfo*> &filter_list,
-	const std::map<int, FeRomInfo*> &lookup
+	const std::vector<FeRomInfo*> &lookup
 )
 {
 	filter_list.clear();
 	filter_list.reserve( indexes.size() );
 
-	try {
-		for ( std::vector<int>::const_iterator it=indexes.begin(); it!=indexes.end(); ++it)
-			filter_list.push_back( lookup.at( *it ) );
-
-		return true;
-	}
-	catch ( ... )
+	for ( std::vector<int>::const_iterator it=indexes.begin(); it!=indexes.end(); ++it)
 	{
-		filter_list.clear();
-		return false;
+		if (( *it < 0 ) || ( *it >= (int)lookup.size() ) || !lookup[ *it ] )
+		{
+			filter_list.clear();
+			return false;
+		}
+
+		filter_list.push_back( lookup[ *it ] );
 	}
+
+	return true;
 }
 
 //
@@ -1220,7 +1683,7 @@ bool FeFilterIndexes::clone_group_to_indexes(
 bool FeFilterIndexes::indexes_to_clone_group(
 	const std::map<std::string, std::vector<int>> &indexes,
 	std::map<std::string, std::vector<FeRomInfo*>> &clone_group,
-	const std::map<int, FeRomInfo*> &lookup
+	const std::vector<FeRomInfo*> &lookup
 )
 {
 	clone_group.clear();
@@ -1242,6 +1705,9 @@ bool FeFilterIndexes::entry_to_index(
 	const FeFilterEntry &entry
 )
 {
+	m_letter_starts = entry.letter_starts;
+	m_positions = entry.positions;
+
 	return filter_list_to_indexes( entry.filter_list, m_filter_list )
 		&& clone_group_to_indexes( entry.clone_group, m_clone_group );
 }
@@ -1249,9 +1715,18 @@ bool FeFilterIndexes::entry_to_index(
 // Populate given entry from lookup indexes
 bool FeFilterIndexes::index_to_entry(
 	FeFilterEntry &entry,
-	const std::map<int, FeRomInfo*> &lookup
+	const std::vector<FeRomInfo*> &lookup
 )
 {
-	return indexes_to_filter_list( m_filter_list, entry.filter_list, lookup )
-		&& indexes_to_clone_group( m_clone_group, entry.clone_group, lookup );
+	if ( !indexes_to_filter_list( m_filter_list, entry.filter_list, lookup )
+			|| !indexes_to_clone_group( m_clone_group, entry.clone_group, lookup ))
+		return false;
+
+	entry.letter_starts = m_letter_starts;
+	entry.positions = m_positions;
+
+	if ( !entry.check_indexes() )
+		entry.build_indexes();
+
+	return true;
 }
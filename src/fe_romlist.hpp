@@ -29,6 +29,7 @@
 #include <set>
 #include <list>
 #include <regex>
+#include <atomic>
 
 #include "cereal/cereal.hpp"
 #include <cereal/types/list.hpp>
@@ -77,11 +78,40 @@ public:
 	std::vector<FeRomInfo*> filter_list;
 	// If clone grouping is on, this stores each clone groups pointers
 	std::map<std::string, std::vector<FeRomInfo*>> clone_group;
+	// Positions in filter_list where the sort letter changes (see get_letter_key())
+	std::vector<int> letter_starts;
+	// Position of each rom in filter_list by FeRomInfo::index, -1 if not in the list
+	std::vector<int> positions;
 
 	void clear() {
 		filter_list.clear();
 		clone_group.clear();
+		letter_starts.clear();
+		positions.clear();
 	};
+
+	// Build letter_starts and positions for the current filter_list
+	void build_indexes();
+
+	// Return true if letter_starts and positions fit the current filter_list
+	bool check_indexes() const;
+
+	// Return the position of rom in filter_list, -1 if not found
+	int find( const FeRomInfo &rom ) const;
+
+	// Return the position of the rom with the given FeRomInfo::index, -1 if not in the list
+	int get_position( int index ) const
+	{
+		return (( index >= 0 ) && ( index < (int)positions.size() )) ? positions[index] : -1;
+	}
+
+	// Return the offset from idx to the next (step > 0) or previous rom
+	// with a different sort letter, 0 if there is none
+	int get_letter_offset( int idx, int step ) const;
+
+	// Lowercase first character of the rom's sort title, with everything that
+	// isn't a letter (including multibyte characters) grouped together as ' '
+	static char get_letter_key( const FeRomInfo &rom );
 };
 
 // Helper class for saving FeFilterEntry
@@ -91,6 +121,8 @@ class FeFilterIndexes
 private:
 	std::vector<int> m_filter_list;
 	std::map<std::string, std::vector<int>> m_clone_group;
+	std::vector<int> m_letter_starts;
+	std::vector<int> m_positions;
 	int m_size;
 	std::string m_filter_id;
 
@@ -102,7 +134,7 @@ private:
 	bool indexes_to_filter_list(
 		const std::vector<int> &indexes,
 		std::vector<FeRomInfo*> &filter_list,
-		const std::map<int, FeRomInfo*> &lookup
+		const std::vector<FeRomInfo*> &lookup
 	);
 
 	bool clone_group_to_indexes(
@@ -113,7 +145,7 @@ private:
 	bool indexes_to_clone_group(
 		const std::map<std::string, std::vector<int>> &indexes,
 		std::map<std::string, std::vector<FeRomInfo*>> &clone_group,
-		const std::map<int, FeRomInfo*> &lookup
+		const std::vector<FeRomInfo*> &lookup
 	);
 
 public:
@@ -123,6 +155,8 @@ public:
 	void clear() {
 		m_filter_list.clear();
 		m_clone_group.clear();
+		m_letter_starts.clear();
+		m_positions.clear();
 	};
 
 	void set_size(int s) { m_size = s; }
@@ -137,14 +171,14 @@ public:
 
 	bool index_to_entry(
 		FeFilterEntry &entry,
-		const std::map<int, FeRomInfo*> &lookup
+		const std::vector<FeRomInfo*> &lookup
 	);
 
 	template<class Archive>
 	void serialize( Archive &archive, std::uint32_t const version )
 	{
 		if ( version != FE_CACHE_VERSION ) throw "Invalid FeFilterIndexes cache";
-		archive( m_filter_list, m_clone_group, m_size, m_filter_id );
+		archive( m_filter_list, m_clone_group, m_letter_starts, m_positions, m_size, m_filter_id );
 	}
 };
 
@@ -171,6 +205,10 @@ private:
 	bool m_played_stats_checked;
 	bool m_group_clones;
 	int m_comparisons; // for keeping stats during load
+	unsigned int m_filters_version; // changes whenever the filter lists (or the roms in them) might have changed
+	std::vector<FeRomInfo*> m_rom_ids; // rom in m_list for each FeRomInfo::index, NULL for unused ids
+	bool m_cold_resident; // keep cold rom fields in memory (a filter uses them)
+	std::uint64_t m_cold_stamp; // stamp of the cold field segment the roms point into, 0 if none
 
 	FeRomList( const FeRomList & );
 	FeRomList &operator=( const FeRomList & );
@@ -184,6 +222,13 @@ private:
 		FeRomInfo &rom,
 		FeFilterEntry &result
 	);
+	bool load_filter_entry(
+		FeDisplayInfo &display,
+		int filter_idx,
+		FeFilterEntry &entry,
+		const std::vector<FeRomInfo*> &lookup
+	);
+	void build_rom_ids();
 
 	bool confirm_tag_dir();
 	void save_favs();
@@ -206,6 +251,14 @@ private:
 	void load_tag_data( std::map<std::string, std::vector<FeRomInfo*>> &rom_map );
 	void load_shuffle_data();
 	int apply_global_filter( FeDisplayInfo &display );
+
+	// Write the cold rom fields to their segment file, and drop them from
+	// memory unless m_cold_resident is set
+	bool save_cold_fields();
+
+	// Attach the roms to the cold field segment with the given stamp after
+	// loading them from cache, reading the fields in if m_cold_resident is set
+	bool load_cold_fields( std::uint64_t stamp );
 	void store_extra_tags( FeRomInfo &rom );
 
 public:
@@ -225,12 +278,27 @@ public:
 		bool group_clones,
 		bool load_stats );
 
-	void create_filters( FeDisplayInfo &display ); // called by load_romlist()
+	// Create the filter lists for the display.  Stops between filters once "cancel" is
+	// set, leaving the remaining filters empty
+	//
+	void create_filters( FeDisplayInfo &display, const std::atomic<bool> *cancel=NULL ); // called by load_romlist()
+
+	// Keep the display's rom index for the filter in range of the filter's size
+	void wrap_rom_index( FeDisplayInfo &display, int filter_idx ) const;
+
+	// Exchange contents with another list (used for background loading)
+	void swap( FeRomList &o );
 
 	int process_setting( const std::string &setting,
 		const std::string &value,
 		const std::string &fn );
 
+	// Append the roms in a romlist file to the list.  Much faster than
+	// load_from_file() for big lists, with the same comment, quoting and
+	// whitespace rules
+	//
+	bool load_romlist_file( const std::string &filename );
+
 	void mark_favs_and_tags_changed();
 	void save_state();
 	bool set_fav( FeRomInfo &rom, FeDisplayInfo &display, bool fav );
@@ -240,6 +308,10 @@ public:
 	bool set_tag( FeRomInfo &rom, FeDisplayInfo &display, const std::string &tag, bool flag );
 	bool replace_tags( FeRomInfo &rom, FeDisplayInfo &display, const std::string &tags );
 
+	// Changes whenever the filter lists might have changed, for anything that
+	// keeps information about the filters (i.e. FeSearchIndex)
+	unsigned int get_filters_version() const { return m_filters_version; };
+
 	int filter_size( int filter_idx ) const { return ( filter_idx < (int)m_filtered_list.size() ) ? (int)m_filtered_list[filter_idx].filter_list.size() : 0; };
 
 	// Return rom directly by index
@@ -248,6 +320,20 @@ public:
 
 	void get_clone_group( int filter_idx, int idx, std::vector < FeRomInfo * > &group );
 
+	// Return the position of rom in the filter, -1 if not found.  Roms held
+	// by this list are found through their id without comparing strings
+	int find_rom( int filter_idx, const FeRomInfo &rom ) const;
+
+	// Give rom a fresh id, for roms added to the list after it was loaded
+	void add_rom_id( FeRomInfo &rom );
+
+	// Release rom's id, call before erasing it from the list
+	void clear_rom_id( const FeRomInfo &rom );
+
+	// Return the offset from idx to the next (step > 0) or previous rom in
+	// the filter with a different sort letter, 0 if there is none
+	int get_letter_offset( int filter_idx, int idx, int step ) const;
+
 	FeRomInfoListType &get_list() { return m_list; };
 
 	void get_file_availability( std::map<std::string, std::vector<std::string>> emu_roms = {} );
@@ -270,10 +356,19 @@ public:
 	void clear_emulators() { m_emulators.clear(); }
 
 	template<class Archive>
-	void serialize( Archive &archive, std::uint32_t const version )
+	void save( Archive &archive, std::uint32_t const version ) const
+	{
+		if ( version != FE_CACHE_VERSION ) throw "Invalid FeRomList cache";
+		archive( m_list, m_cold_stamp );
+	}
+
+	template<class Archive>
+	void load( Archive &archive, std::uint32_t const version )
 	{
 		if ( version != FE_CACHE_VERSION ) throw "Invalid FeRomList cache";
-		archive( m_list );
+		std::uint64_t stamp( 0 );
+		archive( m_list, stamp );
+		if ( !load_cold_fields( stamp ) ) throw "Invalid FeRomList extra info";
 	}
 };
 
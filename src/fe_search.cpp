@@ -0,0 +1,233 @@
+/*
+ *
+ *  Attract-Mode Plus frontend
+ *  Copyright (C) 2025 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode Plus
+ *
+ *  Attract-Mode Plus is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode Plus is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode Plus.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "fe_search.hpp"
+#include "fe_romlist.hpp"
+#include "fe_util.hpp"
+
+#include <SFML/System/Clock.hpp>
+
+namespace
+{
+	const FeRomInfo::Index INDEXED_FIELDS[] =
+	{
+		FeRomInfo::Title,
+		FeRomInfo::AltTitle,
+		FeRomInfo::Romname,
+		FeRomInfo::Manufacturer
+	};
+
+	const int INDEXED_COUNT = sizeof( INDEXED_FIELDS ) / sizeof( INDEXED_FIELDS[0] );
+
+	const char *REGEX_CHARS = ".+*?^$()[]{}|\\";
+
+	inline unsigned int trigram( const char *p )
+	{
+		return ( (unsigned char)p[0] << 16 ) | ( (unsigned char)p[1] << 8 ) | (unsigned char)p[2];
+	}
+};
+
+FeSearchIndex::FeSearchIndex()
+	: m_fields( INDEXED_COUNT ),
+	m_filter_index( -1 ),
+	m_filters_version( 0 ),
+	m_have_last( false )
+{
+}
+
+void FeSearchIndex::clear()
+{
+	m_roms.clear();
+	m_fields.clear();
+	m_fields.resize( INDEXED_COUNT );
+	m_filter_index = -1;
+	m_filters_version = 0;
+	m_last_hits.clear();
+	m_have_last = false;
+}
+
+FeSearchIndex::Field *FeSearchIndex::get_field( FeRomInfo::Index target )
+{
+	for ( int i=0; i<INDEXED_COUNT; i++ )
+	{
+		if ( INDEXED_FIELDS[i] == target )
+		{
+			if ( !m_fields[i].built )
+				build_field( target, m_fields[i] );
+
+			return &m_fields[i];
+		}
+	}
+
+	return NULL;
+}
+
+void FeSearchIndex::build_field( FeRomInfo::Index target, Field &f )
+{
+	sf::Clock timer;
+
+	f.text.resize( m_roms.size() );
+	f.trigrams.clear();
+
+	for ( int i=0; i<(int)m_roms.size(); i++ )
+	{
+		std::string &t = f.text[i];
+		t = lowercase( m_roms[i]->get_info( target ));
+
+		for ( size_t j=0; j+2<t.size(); j++ )
+		{
+			std::vector<int> &hits = f.trigrams[ trigram( t.c_str() + j ) ];
+
+			// a trigram can appear more than once in the same text
+			if ( hits.empty() || ( hits.back() != i ))
+				hits.push_back( i );
+		}
+	}
+
+	f.built = true;
+
+	FeDebug() << "Built search index for " << FeRomInfo::indexStrings[target]
+		<< " (" << m_roms.size() << " roms, " << f.trigrams.size() << " trigrams) in "
+		<< timer.getElapsedTime().asMilliseconds() << " ms" << std::endl;
+}
+
+//
+// Return true if everything that matches rule also matches the previous
+// search rule, in which case only the previous results need to be checked.
+// This is when the rule is a "contains" rule with the previous rule's text
+// plus some plain (non-regex) characters.
+//
+bool FeSearchIndex::can_refine( const FeRule &rule ) const
+{
+	if ( !m_have_last
+			|| ( rule.get_comp() != FeRule::FilterContains )
+			|| ( m_last_rule.get_comp() != FeRule::FilterContains )
+			|| ( rule.get_target() != m_last_rule.get_target() ))
+		return false;
+
+	const std::string &prev = m_last_rule.get_what();
+	const std::string &what = rule.get_what();
+
+	if (( what.size() < prev.size() ) || ( what.compare( 0, prev.size(), prev ) != 0 ))
+		return false;
+
+	if ( what.find_first_of( REGEX_CHARS, prev.size() ) != std::string::npos )
+		return false;
+
+	// added characters could change the meaning of an escape or repetition count
+	if ( !prev.empty() && (( prev[ prev.size() - 1 ] == '\\' ) || ( prev.find( '{' ) != std::string::npos )))
+		return false;
+
+	return true;
+}
+
+bool FeSearchIndex::search( FeRomList &rl,
+	int filter_index,
+	const std::string &rule_str,
+	std::vector<FeRomInfo *> &result )
+{
+	result.clear();
+
+	FeRule rule;
+	if ( rule.process_setting( "", rule_str, "" ) )
+		return false;
+
+	if ( !rule.init() )
+		return false;
+
+	if (( filter_index != m_filter_index ) || ( rl.get_filters_version() != m_filters_version ))
+	{
+		clear();
+		m_filter_index = filter_index;
+		m_filters_version = rl.get_filters_version();
+
+		m_roms.reserve( rl.filter_size( filter_index ));
+		for ( int i=0; i<rl.filter_size( filter_index ); i++ )
+			m_roms.push_back( &rl.lookup( filter_index, i ));
+	}
+
+	const std::string &what = rule.get_what();
+	bool plain = ( rule.get_comp() == FeRule::FilterContains )
+		&& ( what.find_first_of( REGEX_CHARS ) == std::string::npos );
+
+	Field *field = plain ? get_field( rule.get_target() ) : NULL;
+
+	//
+	// Work out which roms need to be checked
+	//
+	const std::vector<int> *candidates = NULL;
+	if ( can_refine( rule ))
+		candidates = &m_last_hits;
+	else if ( field && ( what.size() >= 3 ))
+	{
+		std::string lw = lowercase( what );
+
+		// the rarest trigram of the search text
+		static const std::vector<int> none;
+		candidates = &none;
+
+		for ( size_t j=0; j+2<lw.size(); j++ )
+		{
+			std::unordered_map<unsigned int, std::vector<int>>::const_iterator itr
+				= field->trigrams.find( trigram( lw.c_str() + j ));
+
+			if ( itr == field->trigrams.end() )
+			{
+				candidates = &none;
+				break;
+			}
+
+			if (( j == 0 ) || ( itr->second.size() < candidates->size() ))
+				candidates = &itr->second;
+		}
+	}
+
+	//
+	// Check them, using the lowercased text for plain searches and the rule
+	// itself for everything else
+	//
+	std::vector<int> hits;
+	std::string lw = field ? lowercase( what ) : std::string();
+	int count = candidates ? (int)candidates->size() : (int)m_roms.size();
+
+	for ( int k=0; k<count; k++ )
+	{
+		int i = candidates ? (*candidates)[k] : k;
+
+		bool match = field
+			? ( !field->text[i].empty() && ( field->text[i].find( lw ) != std::string::npos ))
+			: rule.apply_rule( *m_roms[i] );
+
+		if ( match )
+			hits.push_back( i );
+	}
+
+	result.reserve( hits.size() );
+	for ( std::vector<int>::const_iterator itr=hits.begin(); itr!=hits.end(); ++itr )
+		result.push_back( m_roms[ *itr ] );
+
+	m_last_rule = rule;
+	m_last_hits.swap( hits );
+	m_have_last = true;
+
+	return true;
+}
@@ -0,0 +1,84 @@
+/*
+ *
+ *  Attract-Mode Plus frontend
+ *  Copyright (C) 2025 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode Plus
+ *
+ *  Attract-Mode Plus is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode Plus is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode Plus.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FE_SEARCH_HPP
+#define FE_SEARCH_HPP
+
+#include "fe_info.hpp"
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+class FeRomList;
+
+//
+// Search index for the current filter, used for search rules (see
+// FeSettings::set_search_rule()).
+//
+// The Title, AltTitle, Romname and Manufacturer of the filter's roms are
+// kept lowercased along with a trigram index, so a plain "contains" search
+// only needs to check the roms that have the rarest trigram of the search
+// text.  When a search extends the previous one (as it does when the user
+// types another letter) only the previous results are checked.
+//
+// The index is built as needed and dropped when the filter lists change.
+//
+class FeSearchIndex
+{
+public:
+	FeSearchIndex();
+
+	void clear();
+
+	//
+	// Put the roms in the given filter that match rule_str into result, in
+	// filter order.  Returns false if the rule is not valid
+	//
+	bool search( FeRomList &rl,
+		int filter_index,
+		const std::string &rule_str,
+		std::vector<FeRomInfo *> &result );
+
+private:
+	struct Field
+	{
+		bool built=false;
+		std::vector<std::string> text; // lowercased, one per rom
+		std::unordered_map<unsigned int, std::vector<int>> trigrams; // trigram -> rom positions
+	};
+
+	Field *get_field( FeRomInfo::Index target );
+	void build_field( FeRomInfo::Index target, Field &f );
+	bool can_refine( const FeRule &rule ) const;
+
+	std::vector<FeRomInfo *> m_roms; // the filter's roms when the index was built
+	std::vector<Field> m_fields;
+	int m_filter_index;
+	unsigned int m_filters_version;
+
+	// The previous search, for refining
+	FeRule m_last_rule;
+	std::vector<int> m_last_hits;
+	bool m_have_last;
+};
+
+#endif
@@ -28,6 +28,9 @@
 #include "fe_cache.hpp"
 #include "fe_vm.hpp"
 #include "image_loader.hpp"
+#include "fe_atlas.hpp"
+#include "fe_texture_pool.hpp"
+#include "fe_shader.hpp"
 #include "zip.hpp"
 #include <iostream>
 #include <sstream>
@@ -40,6 +43,7 @@
 #include <stdlib.h>
 #include <cctype>
 #include <ctime>
+#include <chrono>
 
 #include "language.h"
 
@@ -123,6 +127,10 @@ const float SECONDS_IN_MONTH	= SECONDS_IN_YEAR / 12.0; // Average
 
 const int FE_DEFAULT_UI_COLOR_TOKEN = 1; // Blue
 
+// How long set_display() waits for a background load before showing the display while
+// the list is still loading.  Small lists are done well within this time.
+const int FE_DISPLAY_LOAD_WAIT_MS = 50;
+
 const std::string FE_EMPTY_STRING;
 
 namespace {
@@ -352,6 +360,13 @@ FeSettings::FeSettings( const std::string &config_path ):
 	m_default_romlist( "Mame" ),
 	m_default_display( "Default Display" ),
 	m_rl( m_config_path ),
+	m_rl_loading( m_config_path ),
+	m_load_display( "" ),
+	m_load_display_index( -1 ),
+	m_load_state( LoadIdle ),
+	m_load_ok( false ),
+	m_load_abort( false ),
+	m_load_swapped( false ),
 	m_inputmap(),
 	m_saver_params( FeLayoutInfo::ScreenSaver ),
 	m_intro_params( FeLayoutInfo::Intro ),
@@ -395,6 +410,9 @@ FeSettings::FeSettings( const std::string &config_path ):
 	m_selection_delay( 400 ),
 	m_selection_speed( 40 ),
 	m_image_cache_mbytes( 100 ),
+	m_image_atlas_size( 0 ),
+	m_texture_pool_mbytes( 64 ),
+	m_async_shaders( false ),
 #ifdef SFML_SYSTEM_MACOS
 	m_move_mouse_on_launch( false ), // hotcorners
 #else
@@ -407,6 +425,7 @@ FeSettings::FeSettings( const std::string &config_path ):
 	m_scrape_fanart( false ),
 	m_scrape_vids( false ),
 	m_scrape_overview( true ),
+	m_scrape_full_hashes( false ),
 #ifdef SFML_SYSTEM_WINDOWS
 	m_hide_console( false ),
 #endif
@@ -438,8 +457,15 @@ FeSettings::FeSettings( const std::string &config_path ):
 	load_default_display();
 }
 
+FeSettings::~FeSettings()
+{
+	cancel_display_load();
+}
+
 void FeSettings::clear()
 {
+	cancel_display_load();
+
 	m_current_config_object=NULL;
 	m_current_display = -1;
 
@@ -605,6 +631,7 @@ const char *FeSettings::configSettingStrings[] =
 	"scrape_fanart",
 	"scrape_videos",
 	"scrape_overview",
+	"scrape_full_hashes",
 	"thegamesdb_key",
 	"screenscraper_user",
 	"screenscraper_pass",
@@ -617,6 +644,9 @@ const char *FeSettings::configSettingStrings[] =
 	"menu_prompt",
 	"menu_layout",
 	"image_cache_mbytes",
+	"image_atlas_size",
+	"texture_pool_mbytes",
+	"async_shaders",
 	NULL
 };
 
@@ -784,8 +814,10 @@ void FeSettings::load_layout_params()
 	}
 }
 
-void FeSettings::init_display()
+void FeSettings::init_display( bool background )
 {
+	cancel_display_load();
+
 	FeLog() << std::endl << "*** Initializing display: '" << get_current_display_title() << "'" << std::endl;
 
 	m_loaded_game_extras = false;
@@ -858,6 +890,14 @@ void FeSettings::init_display()
 		return;
 	}
 
+	prefetch_artwork_paths( romlist_name );
+
+	if ( background )
+	{
+		start_display_load( list_path, romlist_name );
+		return;
+	}
+
 	if ( m_rl.load_romlist(
 		list_path,
 		romlist_name,
@@ -871,6 +911,186 @@ void FeSettings::init_display()
 
 }
 
+//
+// Read the artwork directories of the emulator named after the display's romlist (as
+// generated romlists are) while the romlist loads, so the first artwork lookups for
+// the list find the directory listings already cached
+//
+void FeSettings::prefetch_artwork_paths( const std::string &emu_name )
+{
+	std::string filename;
+	if ( !internal_resolve_config_file( m_config_path, filename,
+			FE_EMULATOR_SUBDIR, emu_name + FE_EMULATOR_FILE_EXTENSION ))
+		return;
+
+	FeEmulatorInfo emu( emu_name );
+	if ( !emu.load_from_file( filename ))
+		return;
+
+	std::string layout_path;
+	get_path( Current, layout_path );
+
+	std::vector< std::pair< std::string, std::string > > art_list;
+	emu.get_artwork_list( art_list );
+
+	std::vector<std::string> paths;
+	for ( std::vector< std::pair< std::string, std::string > >::iterator itr=art_list.begin();
+			itr != art_list.end(); ++itr )
+	{
+		std::vector<std::string> temp_list;
+		emu.get_artwork( (*itr).first, temp_list );
+
+		for ( std::vector<std::string>::iterator itp=temp_list.begin(); itp != temp_list.end(); ++itp )
+		{
+			if ( is_supported_archive( *itp ) )
+				continue;
+
+			paths.push_back( emu.clean_path_with_wd( *itp, true ) );
+			perform_substitution( paths.back(), "$LAYOUT", layout_path );
+		}
+	}
+
+	m_path_cache.prefetch( paths );
+}
+
+//
+// Load the romlist for the current display on a background thread, so the layout keeps
+// running while a large list loads.  The loader thread only works on m_rl_loading and
+// its own copy of the display, m_rl is never touched until the main thread swaps the
+// finished list (with all of its filters) in
+//
+void FeSettings::start_display_load( const std::string &list_path, const std::string &romlist_name )
+{
+	// Show an empty list while loading.  The previous list gets freed by the loader thread
+	m_rl.swap( m_rl_loading );
+	m_rl.init_as_empty_list();
+	m_rl_loading.clear_emulators(); // emulator configs may have been edited since last used
+
+	m_load_display = m_displays[m_current_display];
+	m_load_display_index = m_current_display;
+	m_load_ok = false;
+	m_load_abort = false;
+	m_load_state = LoadRunning;
+
+	m_load_thread = std::thread( &FeSettings::display_load_thread, this,
+		list_path, romlist_name, m_group_clones, m_track_usage );
+
+	// Lists that load quickly are swapped in right away, same as a foreground load
+	std::unique_lock<std::mutex> lock( m_load_mutex );
+	if ( m_load_cv.wait_for( lock, std::chrono::milliseconds( FE_DISPLAY_LOAD_WAIT_MS ),
+			[this]{ return m_load_state != LoadRunning; } ))
+	{
+		apply_display_load( lock );
+		m_load_swapped = false; // caller updates the layout
+	}
+	else
+		FeLog() << " - Loading romlist in the background" << std::endl;
+}
+
+void FeSettings::display_load_thread(
+	std::string list_path,
+	std::string romlist_name,
+	bool group_clones,
+	bool load_stats )
+{
+	bool ok = m_rl_loading.load_romlist( list_path, romlist_name, m_load_display, group_clones, load_stats );
+
+	if ( ok && !m_load_abort )
+		m_rl_loading.create_filters( m_load_display, &m_load_abort );
+	else if ( !ok )
+		FeLog() << "Error opening romlist: " << romlist_name << std::endl;
+
+	// Free an aborted list here rather than on the main thread
+	if ( m_load_abort )
+		m_rl_loading.init_as_empty_list();
+
+	std::lock_guard<std::mutex> lock( m_load_mutex );
+	m_load_ok = ok;
+	m_load_state = LoadReady;
+	m_load_cv.notify_all();
+}
+
+//
+// Apply the results of the loader thread, called from the main thread with m_load_mutex held
+// - Returns true if the loaded list was swapped in
+//
+bool FeSettings::apply_display_load( std::unique_lock<std::mutex> &lock )
+{
+	if ( m_load_state != LoadReady )
+		return false;
+
+	lock.unlock();
+	m_load_thread.join();
+	lock.lock();
+
+	m_load_state = LoadIdle;
+	if ( m_load_abort )
+		return false;
+
+	m_rl.swap( m_rl_loading );
+
+	FeDisplayInfo *display = ( m_load_display_index < (int)m_displays.size() )
+		? &m_displays[m_load_display_index] : NULL;
+
+	if ( display && m_load_ok )
+	{
+		for ( int i=0; i<display->get_filter_count(); i++ )
+		{
+			FeFilter *from = m_load_display.get_filter( i );
+			FeFilter *to = display->get_filter( i );
+			if ( from && to )
+				to->set_size( from->get_size() );
+
+			m_rl.wrap_rom_index( *display, i );
+		}
+	}
+
+	m_load_swapped = true;
+	return true;
+}
+
+void FeSettings::cancel_display_load()
+{
+	std::unique_lock<std::mutex> lock( m_load_mutex );
+	if ( m_load_state == LoadIdle )
+		return;
+
+	m_load_abort = true;
+
+	lock.unlock();
+	m_load_thread.join();
+	lock.lock();
+
+	m_load_state = LoadIdle;
+	m_load_abort = false;
+}
+
+bool FeSettings::is_display_loading()
+{
+	std::lock_guard<std::mutex> lock( m_load_mutex );
+	return m_load_state != LoadIdle;
+}
+
+bool FeSettings::poll_display_load()
+{
+	std::unique_lock<std::mutex> lock( m_load_mutex );
+	apply_display_load( lock );
+
+	bool retval = m_load_swapped;
+	m_load_swapped = false;
+	return retval;
+}
+
+void FeSettings::finish_display_load()
+{
+	std::unique_lock<std::mutex> lock( m_load_mutex );
+	if ( m_load_state == LoadIdle )
+		return;
+
+	m_load_cv.wait( lock, [this]{ return m_load_state != LoadRunning; } );
+	apply_display_load( lock );
+}
+
 void FeSettings::construct_display_maps()
 {
 	m_display_cycle.clear();
@@ -1068,6 +1288,7 @@ void FeSettings::save_state()
 	if ( display_idx < 0 )
 		display_idx = m_selected_display;
 
+	finish_display_load();
 	m_rl.save_state();
 
 	std::string filename( m_config_path );
@@ -1403,10 +1624,7 @@ int FeSettings::get_filter_size( int filter_index ) const
 // Return index of given rom in filter, -1 if not found
 int FeSettings::get_rom_index( int filter_index, FeRomInfo* rom ) const
 {
-	for ( int i=0, n=m_rl.filter_size( filter_index ); i<n; ++i )
-		if ( m_rl.lookup( filter_index, i ) == *rom )
-			return i;
-	return -1;
+	return rom ? m_rl.find_rom( filter_index, *rom ) : -1;
 }
 
 int FeSettings::get_rom_index( int filter_index, int offset ) const
@@ -1468,23 +1686,10 @@ bool FeSettings::set_search_rule( const std::string &rule_str )
 	if ( rule_str.empty() )
 		return false;
 
-	// The search rule is not stored if it fails to parse
-	FeRule rule;
-	if ( rule.process_setting( "", rule_str, "" ) )
-		return false;
-
-	// The search rule is not stored if it fails to init (bad regex)
-	if ( !rule.init() )
+	// The search rule is not stored if it fails to parse or init (bad regex)
+	if ( !m_search_index.search( m_rl, get_current_filter_index(), rule_str, m_current_search ))
 		return false;
 
-	int filter_index = get_current_filter_index();
-	for ( int i=0; i<m_rl.filter_size( filter_index ); i++ )
-	{
-		FeRomInfo &r = m_rl.lookup( filter_index, i );
-		if ( rule.apply_rule( r ) )
-			m_current_search.push_back( &r );
-	}
-
 	// The search rule is not stored if there are no results
 	if ( m_current_search.empty() )
 		return false;
@@ -1511,16 +1716,9 @@ bool FeSettings::switch_to_clone_group( int idx )
 		// showing search results we need to find the selected game
 		// in the filter itself (without the search applied)
 		//
-		FeRomInfo *rom = get_rom_absolute( fi, ri );
-
-		for ( int i=0; i<m_rl.filter_size( fi ); i++ )
-		{
-			if ( m_rl.lookup( fi, i ) == *rom )
-			{
-				ri = i;
-				break;
-			}
-		}
+		int i = get_rom_index( fi, get_rom_absolute( fi, ri ));
+		if ( i >= 0 )
+			ri = i;
 	}
 
 	std::vector < FeRomInfo * > group;
@@ -1605,6 +1803,8 @@ const std::string &FeSettings::get_rom_info_absolute( int filter_index, int rom_
 		return FE_EMPTY_STRING;
 
 	// Make sure we have additional fields if user is requesting them.
+	// - These update every rom, so any background load has to be finished first
+	if (( index == FeRomInfo::FileIsAvailable ) || FeRomInfo::isStat( index )) finish_display_load();
 	if ( index == FeRomInfo::FileIsAvailable ) m_rl.get_file_availability();
 	if ( FeRomInfo::isStat( index )) m_rl.get_played_stats();
 
@@ -1895,7 +2095,7 @@ bool FeSettings::config_file_exists() const
 	return file_exists( config_file );
 }
 
-bool FeSettings::set_display( int index, bool stack_previous )
+bool FeSettings::set_display( int index, bool stack_previous, bool background )
 {
 	if ( m_displays.size() == 0 )
 		return false;
@@ -1950,7 +2150,7 @@ bool FeSettings::set_display( int index, bool stack_previous )
 	}
 
 	m_rl.save_state();
-	init_display();
+	init_display( background );
 
 	std::string new_path, new_file;
 	get_path( Layout, new_path, new_file );
@@ -1966,7 +2166,7 @@ bool FeSettings::set_display( int index, bool stack_previous )
 }
 
 // return true if layout needs to be reloaded as a result
-bool FeSettings::navigate_display( int step, bool wrap_mode )
+bool FeSettings::navigate_display( int step, bool wrap_mode, bool background )
 {
 	int i = find_idx_in_vec( m_current_display, m_display_cycle );
 	i += step;
@@ -1985,7 +2185,7 @@ bool FeSettings::navigate_display( int step, bool wrap_mode )
 	if ( idx >= (int)m_displays.size() )
 		return false;
 
-	bool retval = set_display( idx );
+	bool retval = set_display( idx, false, background && !wrap_mode );
 
 	if ( wrap_mode )
 	{
@@ -2089,6 +2289,10 @@ void FeSettings::set_current_selection( int filter_index, int rom_index )
 	}
 	else
 	{
+		// Other filters may still be building in the background
+		if ( filter_index != m_displays[m_current_display].get_current_filter_index() )
+			finish_display_load();
+
 		m_displays[m_current_display].set_current_filter_index( filter_index );
 		if ( rom_index >= 0 )
 			m_displays[m_current_display].set_rom_index( filter_index, rom_index );
@@ -2462,6 +2666,8 @@ bool FeSettings::get_current_fav()
 
 bool FeSettings::set_fav_absolute( bool status, int filter_index, int rom_index )
 {
+	finish_display_load();
+
 	if ( m_current_display < 0 )
 		return false;
 
@@ -2523,35 +2729,23 @@ int FeSettings::get_next_fav_offset()
 	return 0;
 }
 
-namespace
-{
-	std::string get_sort_letter( const FeRomInfo *rom )
-	{
-		if ( !rom ) return "";
-		const std::string &title = rom->get_sort_title();
-		if ( title.empty() ) return "";
-		return FeUtil::narrow( std::wstring( 1, FeUtil::widen( title ).at( 0 ) ) );
-	}
-}
-
 int FeSettings::get_next_letter_offset( int step )
 {
 	int filter_index = get_current_filter_index();
-	int filter_size = get_filter_size( filter_index );
 	int idx = get_rom_index( filter_index, 0 );
-	int dir = step > 0 ? 1 : -1;
 
-	std::string curr_title = get_sort_letter( get_rom_absolute( filter_index, idx ) );
-	const char curr_l = curr_title.empty() ? ' ' : std::tolower( curr_title.at( 0 ) );
-	bool is_alpha = std::isalpha( curr_l );
+	// The filter's letter index can be used unless search results are showing
+	if ( m_current_search.empty() )
+		return m_rl.get_letter_offset( filter_index, idx, step );
+
+	int filter_size = get_filter_size( filter_index );
+	int dir = step > 0 ? 1 : -1;
+	char curr_l = FeFilterEntry::get_letter_key( *get_rom_absolute( filter_index, idx ) );
 
 	for ( int i=1; i<filter_size; i++ )
 	{
 		int t_idx = ( idx + filter_size + dir * i ) % filter_size;
-		std::string test_title = get_sort_letter( get_rom_absolute( filter_index, t_idx ) );
-		const char test_l = test_title.empty() ? ' ' : std::tolower( test_title.at( 0 ) );
-
-		if ( is_alpha ? ( test_l != curr_l ) : std::isalpha( test_l ) )
+		if ( FeFilterEntry::get_letter_key( *get_rom_absolute( filter_index, t_idx ) ) != curr_l )
 			return t_idx - idx;
 	}
 
@@ -2586,6 +2780,8 @@ bool FeSettings::replace_tags_offset( const std::string &tags, int filter_offset
 
 bool FeSettings::replace_tags_absolute( const std::string &tags, int filter_index, int rom_index )
 {
+	finish_display_load();
+
 	if ( m_current_display < 0 )
 		return false;
 
@@ -2612,6 +2808,8 @@ bool FeSettings::set_tag_current( const std::string &tag, bool add_tag )
 
 bool FeSettings::set_tag_absolute( const std::string &tag, bool add_tag, int filter_index, int rom_index )
 {
+	finish_display_load();
+
 	if ( m_current_display < 0 )
 		return false;
 
@@ -2776,14 +2974,9 @@ void FeSettings::prep_for_launch( std::string &command,
 			// showing search results we need to find the selected game
 			// in the filter itself (without the search applied)
 			//
-			for ( int i=0; i<m_rl.filter_size( filter_index ); i++ )
-			{
-				if ( m_rl.lookup( filter_index, i ) == *rom )
-				{
-					m_last_launch_rom = i;
-					break;
-				}
-			}
+			int i = get_rom_index( filter_index, rom );
+			if ( i >= 0 )
+				m_last_launch_rom = i;
 		}
 	}
 	else
@@ -2930,6 +3123,8 @@ bool FeSettings::update_stats_current( int play_count, int play_time )
 
 bool FeSettings::update_stats_absolute( int play_count, int play_time, int filter_index, int rom_index )
 {
+	finish_display_load();
+
 	if (( m_current_display < 0 ) || ( !m_track_usage ))
 		return false;
 
@@ -2961,14 +3156,9 @@ bool FeSettings::update_stats_absolute( int play_count, int play_time, int filte
 	if ( changed && ( &m_rl.lookup( filter_index, selected_rom_index ) != selected_rom ))
 	{
 		// Select the previously selected rom
-		for ( int i=0; i<m_rl.filter_size( filter_index ); i++ )
-		{
-			if ( m_rl.lookup( filter_index, i ) == *selected_rom )
-			{
-				set_current_selection( filter_index, i );
-				break;
-			}
-		}
+		int i = m_rl.find_rom( filter_index, *selected_rom );
+		if ( i >= 0 )
+			set_current_selection( filter_index, i );
 	}
 
 	return changed;
@@ -2978,7 +3168,11 @@ int FeSettings::exit_command() const
 {
 	int r( -1 );
 	if ( !m_exit_command.empty() )
+	{
+		// The exit command may shut the system down, so write the stats first
+		FeStatsWriter::get_ref().flush();
 		r = system( m_exit_command.c_str() );
+	}
 
 	return r;
 }
@@ -3498,6 +3692,10 @@ const std::string FeSettings::get_info( int index ) const
 		return as_str( m_selection_speed );
 	case ImageCacheMBytes:
 		return as_str( m_image_cache_mbytes );
+	case ImageAtlasSize:
+		return as_str( m_image_atlas_size );
+	case TexturePoolMBytes:
+		return as_str( m_texture_pool_mbytes );
 	case StartupMode:
 		return startupTokens[ m_startup_mode ];
 	case PrefixMode:
@@ -3529,8 +3727,10 @@ const std::string FeSettings::get_info( int index ) const
 	case ScrapeFanArt:
 	case ScrapeVids:
 	case ScrapeOverview:
+	case ScrapeFullHashes:
 	case PowerSaving:
 	case CheckForUpdates:
+	case AsyncShaders:
 #ifdef SFML_SYSTEM_WINDOWS
 	case HideConsole:
 #endif
@@ -3601,10 +3801,14 @@ bool FeSettings::get_info_bool( int index ) const
 		return m_scrape_vids;
 	case ScrapeOverview:
 		return m_scrape_overview;
+	case ScrapeFullHashes:
+		return m_scrape_full_hashes;
 	case PowerSaving:
 		return m_power_saving;
 	case CheckForUpdates:
 		return m_check_for_updates;
+	case AsyncShaders:
+		return m_async_shaders;
 #ifdef SFML_SYSTEM_WINDOWS
 	case HideConsole:
 		return m_hide_console;
@@ -3799,6 +4003,21 @@ bool FeSettings::set_info( int index, const std::string &value )
 		FeImageLoader::set_cache_size( m_image_cache_mbytes * 1024 * 1024 );
 		break;
 
+	case ImageAtlasSize:
+		FeTextureAtlas::set_max_image_size( as_int( value ) );
+		m_image_atlas_size = FeTextureAtlas::get_max_image_size();
+		break;
+
+	case TexturePoolMBytes:
+		m_texture_pool_mbytes = std::max( 0, as_int( value ) );
+		FeTexturePool::set_budget( m_texture_pool_mbytes * 1024 * 1024 );
+		break;
+
+	case AsyncShaders:
+		m_async_shaders = config_str_to_bool( value );
+		FeShaderCache::set_async( m_async_shaders );
+		break;
+
 	case MoveMouseOnLaunch:
 		m_move_mouse_on_launch = config_str_to_bool( value );
 		break;
@@ -3831,6 +4050,10 @@ bool FeSettings::set_info( int index, const std::string &value )
 		m_scrape_overview = config_str_to_bool( value );
 		break;
 
+	case ScrapeFullHashes:
+		m_scrape_full_hashes = config_str_to_bool( value );
+		break;
+
 	case PowerSaving:
 		m_power_saving = config_str_to_bool( value );
 		break;
@@ -4849,6 +5072,8 @@ bool FeSettings::update_romlist_after_edit(
 	const FeRomInfo &replacement,
 	UpdateType u_type )
 {
+	finish_display_load();
+
 	// Exit early if display invalid
 	if ( m_current_display < 0 )
 		return false;
@@ -4886,10 +5111,12 @@ bool FeSettings::update_romlist_entry(
 			switch ( u_type )
 			{
 				case EraseEntry:
+					m_rl.clear_rom_id( *it );
 					it = rl.erase( it );
 					return true;
 				case InsertEntry:
 					it = rl.insert( it, replacement );
+					m_rl.add_rom_id( *it );
 					return true;
 				default:
 				case UpdateEntry:
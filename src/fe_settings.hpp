@@ -26,11 +26,15 @@
 #include "fe_base.hpp"
 #include "fe_info.hpp"
 #include "fe_romlist.hpp"
+#include "fe_search.hpp"
 #include "fe_input.hpp"
 #include "fe_util.hpp"
 #include "scraper_base.hpp"
 #include "path_cache.hpp"
 #include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #if defined(USE_DRM)
  #define FORCE_FULLSCREEN
@@ -171,6 +175,7 @@ public:
 		ScrapeFanArt,
 		ScrapeVids,
 		ScrapeOverview,
+		ScrapeFullHashes,
 		ThegamesdbKey,
 		ScreenScraperUser,
 		ScreenScraperPass,
@@ -183,6 +188,9 @@ public:
 		MenuPrompt, // 'Displays Menu' prompt
 		MenuLayout, // 'Displays Menu' layout
 		ImageCacheMBytes,
+		ImageAtlasSize,
+		TexturePoolMBytes,
+		AsyncShaders,
 		LAST_INDEX
 	};
 
@@ -230,8 +238,28 @@ private:
 	std::deque<int> m_display_stack; // stack for displays to navigate to when "back" button pressed (and
 					// display shortcuts are used)
 	FeRomList m_rl;
+	FeSearchIndex m_search_index;
 	FePathCache m_path_cache;
 
+	// Background display loading, see start_display_load()
+	enum DisplayLoadState
+	{
+		LoadIdle,
+		LoadRunning,		// loader thread is loading the romlist and current filter
+		LoadReady			// loader thread is finished, list is ready to be swapped in
+	};
+
+	FeRomList m_rl_loading; // list being loaded, or the previous list (empty) when idle
+	FeDisplayInfo m_load_display; // loader thread's copy of the display being loaded
+	int m_load_display_index;
+	std::thread m_load_thread;
+	std::mutex m_load_mutex;
+	std::condition_variable m_load_cv;
+	DisplayLoadState m_load_state;
+	bool m_load_ok;
+	std::atomic<bool> m_load_abort; // checked between filters while they are built
+	bool m_load_swapped; // list swapped in, layout not yet updated
+
 	FeInputMap m_inputmap;
 	FeSoundInfo m_sound_info;
 	FeTranslationMap m_translation_map;
@@ -276,6 +304,9 @@ private:
 	int m_selection_delay; // delay before key-repeat
 	int m_selection_speed; // key-repeat interval
 	int m_image_cache_mbytes; // image cache size (in Megabytes)
+	int m_image_atlas_size; // max width/height of images put in the texture atlas, 0 to disable
+	int m_texture_pool_mbytes; // video memory for unused textures kept for reuse (in Megabytes)
+	bool m_async_shaders; // compile layout shaders off the main thread
 	bool m_move_mouse_on_launch; // configure whether mouse gets moved to bottom right corner on launch
 	bool m_scrape_snaps;
 	bool m_scrape_marquees;
@@ -284,6 +315,7 @@ private:
 	bool m_scrape_fanart;
 	bool m_scrape_vids;
 	bool m_scrape_overview;
+	bool m_scrape_full_hashes;
 #ifdef SFML_SYSTEM_WINDOWS
 	bool m_hide_console;
 #endif
@@ -317,6 +349,12 @@ private:
 
 	void construct_display_maps();
 
+	void start_display_load( const std::string &list_path, const std::string &romlist_name );
+	void display_load_thread( std::string list_path, std::string romlist_name, bool group_clones, bool load_stats );
+	bool apply_display_load( std::unique_lock<std::mutex> &lock );
+	void cancel_display_load();
+	void prefetch_artwork_paths( const std::string &emu_name );
+
 	void internal_gather_config_files(
 		std::vector<std::string> &ll,
 		const std::string &extension,
@@ -338,6 +376,21 @@ private:
 	bool screenscraper_scraper( FeImporterContext & );
 	bool apply_xml_import( FeImporterContext & );
 
+	//
+	// Build the romlists for emus on a pool of worker threads, the list for
+	// emus[i] goes in results[i].  Overall progress is reported with uiu from
+	// the calling thread, and the build is cancelled if it returns false.
+	// Returns false if cancelled
+	//
+	bool build_emulator_romlists( const std::vector<FeEmulatorInfo *> &emus,
+		bool full,
+		bool use_net,
+		const std::string &out_name,
+		UiUpdate uiu,
+		void *uid,
+		std::vector<FeRomInfoListType> &results,
+		std::string &user_message );
+
 	bool load_game_extras(
 		const std::string &romlist_name,
 		const std::string &romname,
@@ -353,6 +406,7 @@ private:
 
 public:
 	FeSettings( const std::string &config_dir );
+	~FeSettings();
 
 	void load();
 	void save_state();
@@ -405,10 +459,24 @@ public:
 	// to the earlier display).  If index is -1 when stack_previous is true, then the
 	// display will be moved to the display at the top of the display stack (if there is one)
 	//
+	// If "background" is true, the romlist is loaded on a background thread when it takes
+	// longer than a few frames.  The list stays empty (is_display_loading() returns true)
+	// until poll_display_load() swaps in the loaded list.
+	//
 	// Returns true if the display change results in a new layout, false otherwise
 	//
-	bool set_display( int index, bool stack_previous=false );
-	void init_display();
+	bool set_display( int index, bool stack_previous=false, bool background=false );
+	void init_display( bool background=false );
+
+	// Returns true while a background display load is in progress
+	bool is_display_loading();
+
+	// Called by the main thread each frame to apply a background display load
+	// - Returns true when the loaded list has been swapped in and the layout needs updating
+	bool poll_display_load();
+
+	// Block until any background display load is completely applied
+	void finish_display_load();
 
 	// Return true if there are displays available to navigate back to on a "back" button press
 	//
@@ -420,7 +488,7 @@ public:
 	int get_display_index_from_name( const std::string &name ) const;
 	int displays_count() const;
 
-	bool navigate_display( int step, bool wrap_mode=false );
+	bool navigate_display( int step, bool wrap_mode=false, bool background=false );
 	bool navigate_filter( int step );
 
 	int get_filter_index_from_name( const std::string &name ) const;
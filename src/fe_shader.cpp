@@ -24,24 +24,280 @@
 #include "fe_presentable.hpp"
 #include "fe_image.hpp"
 #include "fe_present.hpp"
+#include <SFML/Window/Context.hpp>
+#include <SFML/OpenGL.hpp>
 #include <iostream>
+#include <algorithm>
+#include <thread>
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+#ifndef GL_CURRENT_PROGRAM
+#define GL_CURRENT_PROGRAM 0x8B8D
+#endif
+
+//
+// A compiled program, shared by all the shaders with the same sources
+//
+class FeShaderProgram
+{
+public:
+	~FeShaderProgram()
+	{
+		if ( worker.joinable() )
+			worker.join();
+	}
+
+	sf::Shader shader;
+	std::atomic<bool> ready{ false };
+	bool ok=false; // set before ready
+	std::thread worker;
+
+	// Id of the shader whose parameters were last uploaded to this program
+	unsigned int owner=0;
+
+	// Zero values for every float parameter set by any of the shaders using
+	// this program, so a shader doesn't pick up another shader's values for
+	// parameters it hasn't set itself
+	std::map<std::string, FeShader::Param> defaults;
+
+	void add_default( const std::string &name, int count )
+	{
+		FeShader::Param &d = defaults[ name ];
+		d.name = name;
+		d.count = count;
+	}
+};
+
+namespace
+{
+	unsigned int g_shader_id=0;
+
+	//
+	// sf::Shader::setUniform() looks up the name and binds the program for
+	// each call, so float uniforms are set directly when the GL entry points
+	// are available.  Otherwise the sf::Shader calls are used
+	//
+	struct FeGlUniforms
+	{
+		typedef void ( APIENTRY *UseProgram )( GLuint );
+		typedef GLint ( APIENTRY *GetUniformLocation )( GLuint, const char * );
+		typedef void ( APIENTRY *Uniform1f )( GLint, GLfloat );
+		typedef void ( APIENTRY *Uniform2f )( GLint, GLfloat, GLfloat );
+		typedef void ( APIENTRY *Uniform3f )( GLint, GLfloat, GLfloat, GLfloat );
+		typedef void ( APIENTRY *Uniform4f )( GLint, GLfloat, GLfloat, GLfloat, GLfloat );
+
+		bool loaded=false;
+		bool ok=false;
+		UseProgram use_program=NULL;
+		GetUniformLocation get_uniform_location=NULL;
+		Uniform1f uniform1f=NULL;
+		Uniform2f uniform2f=NULL;
+		Uniform3f uniform3f=NULL;
+		Uniform4f uniform4f=NULL;
+
+		bool load()
+		{
+			if ( loaded )
+				return ok;
+
+			loaded = true;
+			use_program = reinterpret_cast<UseProgram>( sf::Context::getFunction( "glUseProgram" ));
+			get_uniform_location = reinterpret_cast<GetUniformLocation>( sf::Context::getFunction( "glGetUniformLocation" ));
+			uniform1f = reinterpret_cast<Uniform1f>( sf::Context::getFunction( "glUniform1f" ));
+			uniform2f = reinterpret_cast<Uniform2f>( sf::Context::getFunction( "glUniform2f" ));
+			uniform3f = reinterpret_cast<Uniform3f>( sf::Context::getFunction( "glUniform3f" ));
+			uniform4f = reinterpret_cast<Uniform4f>( sf::Context::getFunction( "glUniform4f" ));
+
+			ok = ( use_program && get_uniform_location
+				&& uniform1f && uniform2f && uniform3f && uniform4f );
+
+			if ( !ok )
+				FeDebug() << "Shader uniforms are set through SFML (GL entry points unavailable)" << std::endl;
+
+			return ok;
+		}
+	};
+
+	FeGlUniforms g_gl;
+
+	//
+	// Uploads a batch of parameters to a program, binding it at most once
+	// and restoring the previously bound program when done
+	//
+	class FeUniformUpload
+	{
+	public:
+		FeUniformUpload( sf::Shader &sh )
+			: m_shader( sh ),
+			m_direct( g_gl.load() ),
+			m_bound( false ),
+			m_previous( 0 )
+		{
+		}
+
+		~FeUniformUpload()
+		{
+			if ( m_bound )
+				g_gl.use_program( (GLuint)m_previous );
+		}
+
+		void set( FeShader::Param &p )
+		{
+			switch ( p.kind )
+			{
+				case FeShader::Param::Float:
+					if ( m_direct )
+						set_direct( p );
+					else
+						set_sfml( p );
+					break;
+
+				case FeShader::Param::Texture:
+				case FeShader::Param::FftTexture:
+					m_shader.setUniform( p.name, *p.texture );
+					break;
+
+				case FeShader::Param::CurrentTexture:
+					m_shader.setUniform( p.name, sf::Shader::CurrentTexture );
+					break;
+			}
+		}
+
+	private:
+		FeUniformUpload( const FeUniformUpload & );
+		FeUniformUpload &operator=( const FeUniformUpload & );
+
+		void set_direct( FeShader::Param &p )
+		{
+			if ( p.count < 1 )
+				return;
+
+			GLuint program = m_shader.getNativeHandle();
+			if ( p.location == -2 )
+				p.location = g_gl.get_uniform_location( program, p.name.c_str() );
+
+			if ( p.location < 0 )
+				return;
+
+			if ( !m_bound )
+			{
+				glGetIntegerv( GL_CURRENT_PROGRAM, &m_previous );
+				g_gl.use_program( program );
+				m_bound = true;
+			}
+
+			switch ( p.count )
+			{
+				case 1: g_gl.uniform1f( p.location, p.v[0] ); break;
+				case 2: g_gl.uniform2f( p.location, p.v[0], p.v[1] ); break;
+				case 3: g_gl.uniform3f( p.location, p.v[0], p.v[1], p.v[2] ); break;
+				case 4: g_gl.uniform4f( p.location, p.v[0], p.v[1], p.v[2], p.v[3] ); break;
+				default: break;
+			}
+		}
+
+		void set_sfml( const FeShader::Param &p )
+		{
+			switch ( p.count )
+			{
+				case 1: m_shader.setUniform( p.name, p.v[0] ); break;
+				case 2: m_shader.setUniform( p.name, sf::Glsl::Vec2( p.v[0], p.v[1] ) ); break;
+				case 3: m_shader.setUniform( p.name, sf::Glsl::Vec3( p.v[0], p.v[1], p.v[2] ) ); break;
+				case 4: m_shader.setUniform( p.name, sf::Glsl::Vec4( p.v[0], p.v[1], p.v[2], p.v[3] ) ); break;
+				default: break;
+			}
+		}
+
+		sf::Shader &m_shader;
+		bool m_direct;
+		bool m_bound;
+		GLint m_previous;
+	};
+
+	bool compile_program( sf::Shader &sh, FeShader::Type t,
+		const std::string &src1, const std::string &src2 )
+	{
+		switch ( t )
+		{
+			case FeShader::VertexAndFragment:
+				return sh.loadFromMemory( src1, src2 );
+
+			case FeShader::Vertex:
+				return sh.loadFromMemory( src1, sf::Shader::Type::Vertex );
+
+			case FeShader::Fragment:
+				return sh.loadFromMemory( src1, sf::Shader::Type::Fragment );
+
+			case FeShader::Empty:
+			default:
+				return false;
+		}
+	}
+
+	bool read_stream( sf::InputStream &s, std::string &content )
+	{
+		std::optional<std::size_t> size = s.getSize();
+		if ( !size || !s.seek( 0 ) )
+			return false;
+
+		content.resize( *size );
+		std::optional<std::size_t> count = s.read( content.data(), *size );
+		return ( count && ( *count == *size ));
+	}
+};
 
 FeShader::FeShader()
-	: m_type( Empty )
+	: m_type( Empty ),
+	m_id( ++g_shader_id )
 {
 }
 
+bool FeShader::set_program( Type t, const std::string &src1, const std::string &src2 )
+{
+	m_type = t;
+	m_program = FeShaderCache::get_ref().get( t, src1, src2 );
+
+	// locations are looked up again in the new program, and everything
+	// uploaded when next drawn
+	m_id = ++g_shader_id;
+	for ( std::vector<Param>::iterator itr = m_params.begin(); itr != m_params.end(); ++itr )
+	{
+		(*itr).location = -2;
+		(*itr).dirty = false;
+		if (( (*itr).kind == Param::Float ) && ( (*itr).count > 0 ))
+			m_program->add_default( (*itr).name, (*itr).count );
+	}
+	m_dirty.clear();
+
+	// a program still compiling in the background is assumed good
+	return ( !m_program->ready || m_program->ok );
+}
+
 bool FeShader::load( sf::InputStream &vert, sf::InputStream &frag )
 {
-	m_type = VertexAndFragment;
-	return m_shader.loadFromStream( vert, frag );
+	std::string vert_src, frag_src;
+	if ( !read_stream( vert, vert_src ) || !read_stream( frag, frag_src ))
+	{
+		m_type = VertexAndFragment;
+		return false;
+	}
+
+	return set_program( VertexAndFragment, vert_src, frag_src );
 }
 
 bool FeShader::load( sf::InputStream &sh, Type t )
 {
-	m_type = t;
-	sf::Shader::Type type = (t == Fragment) ? sf::Shader::Type::Fragment : sf::Shader::Type::Vertex;
-	return m_shader.loadFromStream( sh, type );
+	std::string src;
+	if ( !read_stream( sh, src ))
+	{
+		m_type = t;
+		return false;
+	}
+
+	return set_program( t, src, "" );
 }
 
 bool FeShader::load( const std::string &vert, const std::string &frag )
@@ -55,7 +311,15 @@ bool FeShader::load( const std::string &vert, const std::string &frag )
 		return false;
 	}
 	m_type = VertexAndFragment;
-	return m_shader.loadFromFile( vert, frag );
+
+	std::string vert_src, frag_src;
+	if ( !read_file_content( vert, vert_src ) || !read_file_content( frag, frag_src ))
+	{
+		FeLog() << " ! Cannot read shader files: " << vert << ", " << frag << std::endl;
+		return false;
+	}
+
+	return set_program( VertexAndFragment, vert_src, frag_src );
 }
 
 bool FeShader::load( const std::string &sh, Type t )
@@ -65,65 +329,223 @@ bool FeShader::load( const std::string &sh, Type t )
 		return false;
 	}
 	m_type = t;
-	sf::Shader::Type type = (t == Fragment) ? sf::Shader::Type::Fragment : sf::Shader::Type::Vertex;
-	return m_shader.loadFromFile( sh, type );
+
+	std::string src;
+	if ( !read_file_content( sh, src ))
+	{
+		FeLog() << " ! Cannot read shader file: " << sh << std::endl;
+		return false;
+	}
+
+	return set_program( t, src, "" );
 }
 
 bool FeShader::loadFromMemory( const std::string &vert, const std::string &frag )
 {
-	m_type = VertexAndFragment;
-	return m_shader.loadFromMemory( vert, frag );
+	return set_program( VertexAndFragment, vert, frag );
 }
 
 bool FeShader::loadFromMemory( const std::string &sh, Type t )
 {
-	m_type = t;
-	sf::Shader::Type type = (t == Fragment) ? sf::Shader::Type::Fragment : sf::Shader::Type::Vertex;
-	return m_shader.loadFromMemory( sh, type );
+	return set_program( t, sh, "" );
 }
 
-void FeShader::set_param( const char *name, float x )
+int FeShader::get_param_handle( const char *name )
 {
-	if ( m_type != Empty )
+	std::unordered_map<std::string, int>::iterator itr = m_handles.find( name );
+	if ( itr != m_handles.end() )
+		return itr->second;
+
+	int handle = m_params.size();
+	m_params.push_back( Param() );
+	m_params.back().name = name;
+	m_handles[ name ] = handle;
+	return handle;
+}
+
+void FeShader::stage_param( int handle, Param::Kind kind, int count,
+	const float *v, const sf::Texture *texture )
+{
+	if (( m_type == Empty ) || ( handle < 0 ) || ( handle >= (int)m_params.size() ))
+		return;
+
+	Param &p = m_params[ handle ];
+
+	// nothing to do if the value is unchanged
+	if (( p.kind == kind ) && ( p.count == count ) && ( p.texture == texture )
+			&& std::equal( v, v + count, p.v ))
+		return;
+
+	if (( kind == Param::Float ) && m_program && ( p.count != count ))
+		m_program->add_default( p.name, count );
+
+	p.kind = kind;
+	p.count = count;
+	std::copy( v, v + count, p.v );
+	p.texture = texture;
+
+	if ( kind != Param::FftTexture )
+	{
+		p.fft_source = nullptr;
+		p.fft_texture.reset();
+	}
+
+	if ( !p.dirty )
 	{
-		m_shader.setUniform( name, x );
-		FePresent::script_flag_redraw();
+		p.dirty = true;
+		m_dirty.push_back( handle );
 	}
+
+	FePresent::script_flag_redraw();
 }
 
-void FeShader::set_param( const char *name, float x, float y )
+bool FeShader::is_compiling() const
 {
-	if ( m_type != Empty )
+	return ( m_type != Empty ) && m_program && !m_program->ready;
+}
+
+const sf::Shader *FeShader::get_shader() const
+{
+	if (( m_type == Empty ) || !m_program || !m_program->ready || !m_program->ok )
+		return NULL;
+
+	FeShaderProgram &prog = *m_program;
+
+	for ( int i=0; i<(int)m_params.size(); i++ )
 	{
-		m_shader.setUniform( name, sf::Glsl::Vec2( x, y ) );
-		FePresent::script_flag_redraw();
+		if ( m_params[i].kind == Param::FftTexture )
+			refresh_fft_param( i );
 	}
+
+	if ( prog.owner != m_id )
+	{
+		FeUniformUpload upload( prog.shader );
+
+		for ( std::map<std::string, Param>::iterator itr = prog.defaults.begin();
+				itr != prog.defaults.end(); ++itr )
+		{
+			std::unordered_map<std::string, int>::const_iterator itf = m_handles.find( itr->first );
+			if (( itf == m_handles.end() ) || ( m_params[ itf->second ].count == 0 ))
+				upload.set( itr->second );
+		}
+
+		for ( std::vector<Param>::iterator itr = m_params.begin(); itr != m_params.end(); ++itr )
+		{
+			if (( (*itr).kind != Param::Float ) || ( (*itr).count > 0 ))
+				upload.set( *itr );
+		}
+
+		prog.owner = m_id;
+	}
+	else if ( !m_dirty.empty() )
+	{
+		FeUniformUpload upload( prog.shader );
+
+		for ( std::vector<int>::iterator itr = m_dirty.begin(); itr != m_dirty.end(); ++itr )
+			upload.set( m_params[ *itr ] );
+	}
+
+	for ( std::vector<int>::iterator itr = m_dirty.begin(); itr != m_dirty.end(); ++itr )
+		m_params[ *itr ].dirty = false;
+
+	m_dirty.clear();
+	return &prog.shader;
+}
+
+void FeShader::set_param( const char *name, float x )
+{
+	set_param_value( get_param_handle( name ), x );
+}
+
+void FeShader::set_param( const char *name, float x, float y )
+{
+	set_param_value( get_param_handle( name ), x, y );
 }
 
 void FeShader::set_param( const char *name, float x, float y, float z )
 {
-	if ( m_type != Empty )
-	{
-		m_shader.setUniform( name, sf::Glsl::Vec3( x, y, z ) );
-		FePresent::script_flag_redraw();
-	}
+	set_param_value( get_param_handle( name ), x, y, z );
 }
 
 void FeShader::set_param( const char *name, float x, float y, float z, float w )
+{
+	set_param_value( get_param_handle( name ), x, y, z, w );
+}
+
+void FeShader::set_param_value( int handle, float x )
+{
+	float v[] = { x };
+	stage_param( handle, Param::Float, 1, v, NULL );
+}
+
+void FeShader::set_param_value( int handle, float x, float y )
+{
+	float v[] = { x, y };
+	stage_param( handle, Param::Float, 2, v, NULL );
+}
+
+void FeShader::set_param_value( int handle, float x, float y, float z )
+{
+	float v[] = { x, y, z };
+	stage_param( handle, Param::Float, 3, v, NULL );
+}
+
+void FeShader::set_param_value( int handle, float x, float y, float z, float w )
+{
+	float v[] = { x, y, z, w };
+	stage_param( handle, Param::Float, 4, v, NULL );
+}
+
+void FeShader::set_texture_param( const char *name )
 {
 	if ( m_type != Empty )
+		stage_param( get_param_handle( name ), Param::CurrentTexture, 0, NULL, NULL );
+}
+
+namespace
+{
+	// Bound in place of an fft texture while its object has no media
+	const sf::Texture &blank_texture()
 	{
-		m_shader.setUniform( name, sf::Glsl::Vec4( x, y, z, w ) );
-		FePresent::script_flag_redraw();
+		static const sf::Texture blank;
+		return blank;
 	}
+};
+
+void FeShader::set_fft_param( const char *name, std::function<FeAudioVisualiser *()> source )
+{
+	if (( m_type == Empty ) || !source )
+		return;
+
+	int handle = get_param_handle( name );
+	if ( handle < 0 )
+		return;
+
+	stage_param( handle, Param::FftTexture, 0, NULL, &blank_texture() );
+	m_params[ handle ].fft_source = source;
+	m_params[ handle ].fft_texture.reset();
+	refresh_fft_param( handle );
 }
 
-void FeShader::set_texture_param( const char *name )
+void FeShader::refresh_fft_param( int handle ) const
 {
-	if ( m_type != Empty )
+	Param &p = m_params[ handle ];
+
+	FeAudioVisualiser *visualiser = p.fft_source();
+	std::shared_ptr<const sf::Texture> texture;
+	if ( visualiser )
+		texture = visualiser->get_texture();
+
+	if ( texture == p.fft_texture )
+		return;
+
+	p.fft_texture = texture;
+	p.texture = texture ? texture.get() : &blank_texture();
+
+	if ( !p.dirty )
 	{
-		m_shader.setUniform( name, sf::Shader::CurrentTexture );
-		FePresent::script_flag_redraw();
+		p.dirty = true;
+		m_dirty.push_back( handle );
 	}
 }
 
@@ -134,9 +556,112 @@ void FeShader::set_texture_param( const char *name, FeImage *image )
 		const sf::Texture *texture = image->get_texture();
 
 		if ( texture )
+			stage_param( get_param_handle( name ), Param::Texture, 0, NULL, texture );
+	}
+}
+
+bool FeShaderCache::s_async = false;
+
+FeShaderCache &FeShaderCache::get_ref()
+{
+	static FeShaderCache cache;
+	return cache;
+}
+
+FeShaderCache::FeShaderCache()
+	: m_completed( 0 ),
+	m_polled( 0 ),
+	m_compiled( 0 ),
+	m_reused( 0 )
+{
+}
+
+void FeShaderCache::set_async( bool async )
+{
+	s_async = async;
+}
+
+bool FeShaderCache::get_async()
+{
+	return s_async;
+}
+
+std::shared_ptr<FeShaderProgram> FeShaderCache::get( FeShader::Type t,
+	const std::string &src1, const std::string &src2 )
+{
+	std::string key;
+	key.reserve( src1.size() + src2.size() + 2 );
+	key += (char)( '0' + t );
+	key += src1;
+	key += '\0';
+	key += src2;
+
+	std::unordered_map<std::string, std::shared_ptr<FeShaderProgram>>::iterator itr
+		= m_programs.find( key );
+
+	if ( itr != m_programs.end() )
+	{
+		m_reused++;
+		return itr->second;
+	}
+
+	std::shared_ptr<FeShaderProgram> p = std::make_shared<FeShaderProgram>();
+	m_programs[ key ] = p;
+	m_compiled++;
+
+	if ( s_async && sf::Shader::isAvailable() )
+	{
+		//
+		// The program is created in the worker's context, which shares its
+		// objects with the window's context.  SFML flushes once the program
+		// is linked, so it is usable on the main thread once ready is set
+		//
+		FeShaderProgram *prog = p.get();
+		std::atomic<int> *completed = &m_completed;
+
+		p->worker = std::thread( [prog, completed, t, src1, src2]()
 		{
-			m_shader.setUniform( name, *texture );
-			FePresent::script_flag_redraw();
-		}
+			sf::Context context;
+			prog->ok = compile_program( prog->shader, t, src1, src2 );
+			prog->ready = true;
+			(*completed)++;
+		});
+	}
+	else
+	{
+		p->ok = compile_program( p->shader, t, src1, src2 );
+		p->ready = true;
+	}
+
+	return p;
+}
+
+void FeShaderCache::purge_unused()
+{
+	std::unordered_map<std::string, std::shared_ptr<FeShaderProgram>>::iterator itr
+		= m_programs.begin();
+
+	while ( itr != m_programs.end() )
+	{
+		if (( itr->second.use_count() == 1 ) && itr->second->ready )
+			itr = m_programs.erase( itr );
+		else
+			++itr;
 	}
 }
+
+bool FeShaderCache::poll()
+{
+	int completed = m_completed;
+	if ( completed == m_polled )
+		return false;
+
+	m_polled = completed;
+	return true;
+}
+
+void FeShaderCache::get_stats( int &compiled, int &reused ) const
+{
+	compiled = m_compiled;
+	reused = m_reused;
+}
@@ -24,7 +24,17 @@
 #define FE_SHADER_HPP
 
 #include <SFML/Graphics/Shader.hpp>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+
 class FeImage;
+class FeAudioVisualiser;
+class FeShaderProgram;
 
 class FeShader
 {
@@ -52,15 +62,116 @@ public:
 	void set_texture_param( const char *name );
 	void set_texture_param( const char *name, FeImage *image );
 
-	const sf::Shader *get_shader() const { return ( m_type != Empty ) ? &m_shader : NULL; };
+	//
+	// Bind the fft/vu texture of the visualiser returned by source.  source
+	// is called each time the shader is drawn, so the texture follows the
+	// object's media as it changes
+	//
+	void set_fft_param( const char *name, std::function<FeAudioVisualiser *()> source );
+
+	//
+	// Return a handle for the named parameter, for setting it with
+	// set_param_value() without looking up the name each time
+	//
+	int get_param_handle( const char *name );
+	void set_param_value( int handle, float x );
+	void set_param_value( int handle, float x, float y );
+	void set_param_value( int handle, float x, float y, float z );
+	void set_param_value( int handle, float x, float y, float z, float w );
+
+	//
+	// Return the compiled program with this shader's parameters applied,
+	// ready to draw with.  Returns NULL for an empty shader, or while the
+	// program is still being compiled in the background
+	//
+	const sf::Shader *get_shader() const;
 	Type get_type() const { return m_type; };
 
+	// Return true while the program is being compiled in the background
+	bool is_compiling() const;
+
+	struct Param
+	{
+		enum Kind { Float, Texture, CurrentTexture, FftTexture };
+		std::string name;
+		Kind kind=Float;
+		int count=0; // number of floats, 0 until the parameter is set
+		float v[4]={ 0, 0, 0, 0 };
+		const sf::Texture *texture=NULL;
+		std::function<FeAudioVisualiser *()> fft_source; // FftTexture only
+		std::shared_ptr<const sf::Texture> fft_texture; // held while bound, keeping its analysis running
+		int location=-2; // uniform location in the program, -2 until looked up
+		bool dirty=false;
+	};
+
 private:
 	FeShader( const FeShader & );
 	const FeShader &operator=( const FeShader & );
 
+	bool set_program( Type t, const std::string &src1, const std::string &src2 );
+	void stage_param( int handle, Param::Kind kind, int count,
+		const float *v, const sf::Texture *texture );
+
+	// Look up the texture of an FftTexture parameter again, staging it if it changed
+	void refresh_fft_param( int handle ) const;
+
 	Type m_type;
-	sf::Shader m_shader;
+	unsigned int m_id;
+	std::shared_ptr<FeShaderProgram> m_program;
+
+	//
+	// Parameters are kept per shader and staged until the shader is next
+	// drawn, when the changed ones are uploaded to the program in one go.
+	// All of them are uploaded if the (possibly shared) program was last
+	// drawn with another shader's parameters
+	//
+	mutable std::vector<Param> m_params; // indexed by handle
+	mutable std::vector<int> m_dirty; // handles of changed parameters
+	std::unordered_map<std::string, int> m_handles;
+};
+
+//
+// Cache of compiled shader programs, keyed by the shader type and sources,
+// so that identical shaders requested by a layout (i.e. the same shader on
+// every clone of an artwork tile) are only compiled once.  Each FeShader
+// keeps its own parameters.
+//
+// Programs can optionally be compiled off the main thread in a shared
+// context, objects using the shader are drawn unshaded until it is ready.
+//
+class FeShaderCache
+{
+public:
+	static FeShaderCache &get_ref();
+
+	static void set_async( bool async );
+	static bool get_async();
+
+	// Return the program for the given sources, compiling it if needed
+	std::shared_ptr<FeShaderProgram> get( FeShader::Type t,
+		const std::string &src1, const std::string &src2 );
+
+	// Free programs that are no longer used by any shader
+	void purge_unused();
+
+	// Returns true if a background compile completed since the last call
+	bool poll();
+
+	// Counts of programs compiled and reused from the cache
+	void get_stats( int &compiled, int &reused ) const;
+
+private:
+	FeShaderCache();
+	FeShaderCache( const FeShaderCache & );
+	FeShaderCache &operator=( const FeShaderCache & );
+
+	std::unordered_map<std::string, std::shared_ptr<FeShaderProgram>> m_programs;
+	std::atomic<int> m_completed;
+	int m_polled;
+	int m_compiled;
+	int m_reused;
+
+	static bool s_async;
 };
 
 #endif
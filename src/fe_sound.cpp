@@ -26,21 +26,38 @@
 #include "fe_util.hpp"
 #include "fe_file.hpp"
 #include "zip.hpp"
+#include "nowide/stat.hpp"
 
 #include <algorithm>
 #include <iostream>
 #include <cstring>
 
+// Maximum number of event sounds that can play at once
+const int FE_SOUND_VOICES = 8;
+
 FeSoundSystem::FeSoundSystem( FeSettings *fes )
-	: m_event_sound( false ),
+	: m_serial( 0 ),
 	m_ambient_sound( true, FeSoundInfo::Ambient ),
-	m_fes( fes ),
-	m_current_sound( FeInputMap::LAST_COMMAND )
+	m_fes( fes )
 {
+	m_voices.resize( FE_SOUND_VOICES );
+	for ( std::vector<FeSoundVoice>::iterator itr=m_voices.begin(); itr!=m_voices.end(); ++itr )
+	{
+		(*itr).command = FeInputMap::LAST_COMMAND;
+		(*itr).serial = 0;
+	}
+
+	// Decoded while the rest of start-up carries on
+	load_sounds( true );
 }
 
 FeSoundSystem::~FeSoundSystem()
 {
+	finish_loading();
+
+	// Voices have to stop before the buffers they play go away
+	m_voices.clear();
+	m_bank.clear();
 }
 
 FeMusic &FeSoundSystem::get_ambient_sound()
@@ -48,25 +65,190 @@ FeMusic &FeSoundSystem::get_ambient_sound()
 	return m_ambient_sound;
 }
 
+namespace
+{
+	std::shared_ptr<sf::SoundBuffer> decode_sound( const std::string &filename )
+	{
+		std::shared_ptr<sf::SoundBuffer> buffer = std::make_shared<sf::SoundBuffer>();
+		if ( !buffer->loadFromFile( filename ))
+		{
+			FeLog() << "Error loading sound file: " << filename << std::endl;
+			buffer.reset();
+		}
+
+		return buffer;
+	}
+
+	// Changes when the file does, so an edited sound is decoded again
+	std::string sound_stamp( const std::string &filename )
+	{
+		nowide::stat_t st;
+		if ( nowide::stat( filename.c_str(), &st ) != 0 )
+			return std::string();
+
+		return std::to_string( (std::uint64_t)st.st_size ) + ":"
+			+ std::to_string( (std::int64_t)get_file_mtime( filename ));
+	}
+};
+
+void FeSoundSystem::load_sounds( bool background )
+{
+	finish_loading();
+
+	FeSoundBank old_bank;
+	old_bank.swap( m_bank );
+	std::vector<std::string> files;
+
+	for ( int i=0; i < FeInputMap::LAST_EVENT; i++ )
+	{
+		if ( i == FeInputMap::AmbientSound )
+			continue;
+
+		std::string sound;
+		if ( !m_fes->get_sound_file( (FeInputMap::Command)i, sound ) )
+			continue;
+
+		if (( m_bank.find( sound ) != m_bank.end() )
+				|| ( std::find( files.begin(), files.end(), sound ) != files.end() ))
+			continue;
+
+		// Keep buffers that were already decoded, unless the file has changed
+		FeSoundBank::iterator itr = old_bank.find( sound );
+		if (( itr != old_bank.end() ) && ( itr->second.stamp == sound_stamp( sound )))
+		{
+			m_bank[ sound ] = itr->second;
+			continue;
+		}
+
+		files.push_back( sound );
+	}
+
+	if ( files.empty() )
+		return;
+
+	// Failures are stored too, so a missing file is only reported once
+	auto decode = [files]()
+	{
+		sf::Clock load_timer;
+		FeSoundLoad res;
+		FeLogCapture capture;
+
+		for ( std::vector<std::string>::const_iterator itr=files.begin(); itr!=files.end(); ++itr )
+		{
+			FeSoundEntry &e = res.bank[ *itr ];
+			e.stamp = sound_stamp( *itr );
+			e.buffer = decode_sound( *itr );
+		}
+
+		FeDebug() << "Decoded " << res.bank.size() << " event sound(s) in "
+			<< load_timer.getElapsedTime().asMilliseconds() << "ms" << std::endl;
+
+		res.log = capture.str();
+		return res;
+	};
+
+	if ( background )
+		m_loading = std::async( std::launch::async, decode );
+	else
+	{
+		FeSoundLoad res = decode();
+		FeLog() << res.log;
+		m_bank.insert( res.bank.begin(), res.bank.end() );
+	}
+}
+
+void FeSoundSystem::finish_loading()
+{
+	if ( !m_loading.valid() )
+		return;
+
+	// Anything logged while decoding is written from here, on the main thread
+	FeSoundLoad res = m_loading.get();
+	FeLog() << res.log;
+	m_bank.insert( res.bank.begin(), res.bank.end() );
+}
+
+std::shared_ptr<sf::SoundBuffer> FeSoundSystem::get_buffer( const std::string &filename )
+{
+	FeSoundBank::iterator itr = m_bank.find( filename );
+	if ( itr != m_bank.end() )
+		return itr->second.buffer;
+
+	// Failures are stored too, so a missing file is only reported once
+	FeSoundEntry &e = m_bank[ filename ];
+	e.stamp = sound_stamp( filename );
+	e.buffer = decode_sound( filename );
+	return e.buffer;
+}
+
+FeSoundSystem::FeSoundVoice &FeSoundSystem::get_voice()
+{
+	FeSoundVoice *oldest = &m_voices.front();
+
+	for ( std::vector<FeSoundVoice>::iterator itr=m_voices.begin(); itr!=m_voices.end(); ++itr )
+	{
+		if ( !(*itr).sound
+				|| ( (*itr).sound->getStatus() != sf::SoundSource::Status::Playing ))
+			return *itr;
+
+		if ( (*itr).serial < oldest->serial )
+			oldest = &(*itr);
+	}
+
+	return *oldest;
+}
+
 void FeSoundSystem::sound_event( FeInputMap::Command c )
 {
 	if ( m_fes->get_play_volume( FeSoundInfo::Sound ) <= 0 )
 		return;
 
+	sf::Clock latency_timer;
+
 	std::string sound;
 	if ( !m_fes->get_sound_file( c, sound ) )
 		return;
 
-	if ( sound.compare( m_event_sound.get_file_name() ) != 0 )
-		m_event_sound.load( sound );
+	finish_loading();
 
-	m_current_sound = c;
-	m_event_sound.set_playing( true );
+	bool cached = ( m_bank.find( sound ) != m_bank.end() );
+	std::shared_ptr<sf::SoundBuffer> buffer = get_buffer( sound );
+	if ( !buffer )
+		return;
+
+	FeSoundVoice &v = get_voice();
+	if ( !v.sound )
+	{
+		v.sound = std::make_unique<sf::Sound>( *buffer );
+		v.sound->setSpatializationEnabled( false );
+	}
+	else if ( v.buffer != buffer )
+		v.sound->setBuffer( *buffer );
+	else
+		v.sound->stop();
+
+	v.buffer = buffer;
+	v.command = c;
+	v.serial = ++m_serial;
+
+	v.sound->setVolume( m_fes->get_play_volume( FeSoundInfo::Sound ) );
+	v.sound->play();
+
+	FeDebug() << "Sound event " << FeInputMap::commandStrings[c] << ": "
+		<< latency_timer.getElapsedTime().asMicroseconds() << "us to play"
+		<< ( cached ? "" : " (not preloaded)" ) << std::endl;
 }
 
 bool FeSoundSystem::is_sound_event_playing( FeInputMap::Command c )
 {
-	return (( m_current_sound == c ) && m_event_sound.get_playing() );
+	for ( std::vector<FeSoundVoice>::iterator itr=m_voices.begin(); itr!=m_voices.end(); ++itr )
+	{
+		if (( (*itr).command == c ) && (*itr).sound
+				&& ( (*itr).sound->getStatus() == sf::SoundSource::Status::Playing ))
+			return true;
+	}
+
+	return false;
 }
 
 void FeSoundSystem::play_ambient()
@@ -96,7 +278,14 @@ void FeSoundSystem::tick()
 
 void FeSoundSystem::release_audio( bool state )
 {
-	m_event_sound.release_audio( state );
+	if ( !state )
+		return;
+
+	for ( std::vector<FeSoundVoice>::iterator itr=m_voices.begin(); itr!=m_voices.end(); ++itr )
+	{
+		if ( (*itr).sound )
+			(*itr).sound->stop();
+	}
 }
 
 FeSound::FeSound( bool loop )
@@ -28,6 +28,10 @@
 #include "media.hpp"
 #include <string>
 #include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <vector>
 #include "fe_input.hpp"
 
 class FeSettings;
@@ -91,16 +95,50 @@ public:
 	void release_audio( bool );
 };
 
+//
+// Event sounds are decoded once into a bank of shared buffers and played
+// through a small pool of voices, so UI sounds can overlap and never have
+// to be loaded from disk in response to input.
+//
 class FeSoundSystem
 {
 private:
 	FeSoundSystem( const FeSoundSystem & );
 	FeSoundSystem &operator=( const FeSoundSystem & );
 
-	FeSound m_event_sound;
+	struct FeSoundVoice
+	{
+		std::shared_ptr<sf::SoundBuffer> buffer;
+		std::unique_ptr<sf::Sound> sound;
+		FeInputMap::Command command;
+		unsigned int serial; // order played, the oldest voice gets stolen
+	};
+
+	struct FeSoundEntry
+	{
+		std::shared_ptr<sf::SoundBuffer> buffer;
+		std::string stamp; // size and modified time of the file when it was decoded
+	};
+
+	typedef std::map<std::string, FeSoundEntry> FeSoundBank;
+
+	// Sounds decoded in the background, with the log to write out once they are picked up
+	struct FeSoundLoad
+	{
+		FeSoundBank bank;
+		std::string log;
+	};
+
+	FeSoundBank m_bank;
+	std::future<FeSoundLoad> m_loading;
+	std::vector<FeSoundVoice> m_voices;
+	unsigned int m_serial;
 	FeMusic m_ambient_sound;
 	FeSettings *m_fes;
-	FeInputMap::Command m_current_sound;
+
+	std::shared_ptr<sf::SoundBuffer> get_buffer( const std::string &filename );
+	FeSoundVoice &get_voice();
+	void finish_loading();
 
 public:
 	FeSoundSystem( FeSettings * );
@@ -108,6 +146,12 @@ public:
 
 	FeMusic &get_ambient_sound();
 
+	// Decode the sound files for all configured events into the sound bank.
+	// Needs to be called again when the sound configuration changes.  If
+	// background is true the files are decoded on a worker thread, and the
+	// next sound event waits for them
+	void load_sounds( bool background=false );
+
 	void sound_event( FeInputMap::Command );
 	bool is_sound_event_playing( FeInputMap::Command );
 
@@ -0,0 +1,219 @@
+/*
+ *
+ *  Attract-Mode Plus frontend
+ *  Copyright (C) 2025 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode Plus
+ *
+ *  Attract-Mode Plus is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode Plus is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode Plus.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "fe_texture_pool.hpp"
+#include "fe_base.hpp" // logging
+
+namespace
+{
+	int texture_bytes( sf::Vector2u size, unsigned int antialiasing )
+	{
+		return size.x * size.y * 4 * std::max( 1u, antialiasing );
+	}
+};
+
+int FeTexturePool::s_budget = 64 * 1024 * 1024;
+
+FeTexturePool &FeTexturePool::get_ref()
+{
+	static FeTexturePool pool;
+	return pool;
+}
+
+FeTexturePool::FeTexturePool()
+	: m_bytes( 0 ),
+	m_created( 0 ),
+	m_reused( 0 ),
+	m_freed( 0 )
+{
+}
+
+void FeTexturePool::set_budget( int bytes )
+{
+	s_budget = std::max( 0, bytes );
+	get_ref().trim();
+}
+
+int FeTexturePool::get_budget()
+{
+	return s_budget;
+}
+
+std::list<FeTexturePool::Entry>::iterator FeTexturePool::find(
+	sf::Vector2u size,
+	bool is_render,
+	unsigned int antialiasing )
+{
+	std::list<Entry>::iterator itr;
+	for ( itr=m_pool.begin(); itr!=m_pool.end(); ++itr )
+	{
+		if (( itr->size == size ) && ( itr->is_render == is_render )
+				&& ( itr->antialiasing == antialiasing ))
+			break;
+	}
+
+	return itr;
+}
+
+void FeTexturePool::add( Entry &&e )
+{
+	if (( e.size.x == 0 ) || ( e.size.y == 0 ))
+		return;
+
+	int bytes = texture_bytes( e.size, e.antialiasing );
+	if ( bytes > s_budget )
+		return;
+
+	m_pool.push_front( std::move( e ));
+	m_bytes += bytes;
+	trim();
+}
+
+void FeTexturePool::trim()
+{
+	while ( !m_pool.empty() && ( m_bytes > s_budget ))
+	{
+		m_bytes -= texture_bytes( m_pool.back().size, m_pool.back().antialiasing );
+		m_pool.pop_back();
+		m_freed++;
+	}
+}
+
+bool FeTexturePool::resize( sf::Texture &t, sf::Vector2u size )
+{
+	if ( t.getSize() == size )
+		return true;
+
+	bool smooth = t.isSmooth();
+	bool repeated = t.isRepeated();
+
+	std::list<Entry>::iterator itr = find( size, false, 0 );
+	if ( itr != m_pool.end() )
+	{
+		// Take the entry out before release() trims the pool, which could free it
+		std::list<Entry> found;
+		found.splice( found.begin(), m_pool, itr );
+		m_bytes -= texture_bytes( size, 0 );
+
+		release( t );
+		t = std::move( found.front().texture );
+		m_reused++;
+	}
+	else
+	{
+		release( t );
+		if ( !t.resize( size ))
+			return false;
+
+		m_created++;
+	}
+
+	t.setSmooth( smooth );
+	t.setRepeated( repeated );
+	return true;
+}
+
+void FeTexturePool::release( sf::Texture &t )
+{
+	sf::Texture old( std::move( t ));
+	t = sf::Texture();
+
+	if ( s_budget <= 0 )
+		return;
+
+	Entry e;
+	e.size = old.getSize();
+	e.texture = std::move( old );
+	add( std::move( e ));
+}
+
+bool FeTexturePool::resize( sf::RenderTexture &t, sf::Vector2u size, unsigned int antialiasing )
+{
+	std::list<Entry>::iterator itr = find( size, true, antialiasing );
+	if ( itr != m_pool.end() )
+	{
+		// Take the entry out before release() trims the pool, which could free it
+		std::list<Entry> found;
+		found.splice( found.begin(), m_pool, itr );
+		m_bytes -= texture_bytes( size, antialiasing );
+
+		release( t, antialiasing );
+		t = std::move( found.front().render_texture );
+		m_reused++;
+
+		t.setView( t.getDefaultView() );
+		t.setSmooth( false );
+		t.setRepeated( false );
+		t.clear( sf::Color::Transparent );
+		return true;
+	}
+
+	release( t, antialiasing );
+
+	sf::ContextSettings ctx;
+	ctx.antiAliasingLevel = antialiasing;
+	if ( !t.resize( size, ctx ))
+		return false;
+
+	m_created++;
+	t.clear( sf::Color::Transparent );
+	return true;
+}
+
+void FeTexturePool::release( sf::RenderTexture &t, unsigned int antialiasing )
+{
+	sf::RenderTexture old( std::move( t ));
+	t = sf::RenderTexture();
+
+	if ( s_budget <= 0 )
+		return;
+
+	Entry e;
+	e.size = old.getSize();
+	e.antialiasing = antialiasing;
+	e.render_texture = std::move( old );
+	e.is_render = true;
+	add( std::move( e ));
+}
+
+void FeTexturePool::purge()
+{
+	m_pool.clear();
+	m_bytes = 0;
+}
+
+void FeTexturePool::get_stats( int &created, int &reused, int &freed ) const
+{
+	created = m_created;
+	reused = m_reused;
+	freed = m_freed;
+}
+
+int FeTexturePool::pool_count() const
+{
+	return m_pool.size();
+}
+
+int FeTexturePool::pool_bytes() const
+{
+	return m_bytes;
+}
@@ -0,0 +1,101 @@
+/*
+ *
+ *  Attract-Mode Plus frontend
+ *  Copyright (C) 2025 Andrew Mickelson
+ *
+ *  This file is part of Attract-Mode Plus
+ *
+ *  Attract-Mode Plus is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Attract-Mode Plus is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Attract-Mode Plus.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FE_TEXTURE_POOL_HPP
+#define FE_TEXTURE_POOL_HPP
+
+#include <SFML/Graphics/Texture.hpp>
+#include <SFML/Graphics/RenderTexture.hpp>
+#include <list>
+
+//
+// Pool of unused textures and render textures, so that the GL objects can be
+// reused instead of being freed and created again each time an image changes
+// size or a container is destroyed (i.e. when changing layouts).  Textures are
+// matched by exact size (and antialiasing level for render textures), since
+// the image has to fill the texture for repeat, mipmaps and smoothing at the
+// edges to work.
+//
+// The pool holds up to the configured budget of video memory, the least
+// recently pooled textures are freed first.
+//
+class FeTexturePool
+{
+public:
+	static FeTexturePool &get_ref();
+
+	// Video memory budget for pooled textures in bytes, 0 disables the pool
+	static void set_budget( int bytes );
+	static int get_budget();
+
+	//
+	// Resize t, which keeps its smooth and repeat settings.  t's current
+	// texture is put in the pool and replaced by a pooled one of the new
+	// size if there is one.  The contents of the texture are undefined.
+	// Returns false if a new texture couldn't be created
+	//
+	bool resize( sf::Texture &t, sf::Vector2u size );
+
+	// Put t's texture in the pool, leaving t empty
+	void release( sf::Texture &t );
+
+	// As above, for the render textures used by surfaces.  Render textures
+	// from the pool are returned cleared with the default view
+	bool resize( sf::RenderTexture &t, sf::Vector2u size, unsigned int antialiasing );
+	void release( sf::RenderTexture &t, unsigned int antialiasing );
+
+	// Free everything in the pool
+	void purge();
+
+	// Counts of textures created, reused from the pool and freed when over budget
+	void get_stats( int &created, int &reused, int &freed ) const;
+	int pool_count() const;
+	int pool_bytes() const;
+
+private:
+	FeTexturePool();
+	FeTexturePool( const FeTexturePool & );
+	FeTexturePool &operator=( const FeTexturePool & );
+
+	struct Entry
+	{
+		sf::Vector2u size;
+		unsigned int antialiasing=0;
+		sf::Texture texture;
+		sf::RenderTexture render_texture;
+		bool is_render=false;
+	};
+
+	std::list<Entry>::iterator find( sf::Vector2u size, bool is_render, unsigned int antialiasing );
+	void add( Entry &&e );
+	void trim();
+
+	std::list<Entry> m_pool; // most recently pooled first
+	int m_bytes;
+	int m_created;
+	int m_reused;
+	int m_freed;
+
+	static int s_budget;
+};
+
+#endif
@@ -47,10 +47,6 @@
 #include <SFML/System/Sleep.hpp>
 #include <SFML/System/Clock.hpp>
 
-#ifdef USE_LIBARCHIVE
-#include <zlib.h>
-#endif
-
 #ifdef SFML_SYSTEM_WINDOWS
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
@@ -255,6 +251,17 @@ std::string uppercase( const std::string &value )
 	return upper;
 }
 
+std::uint64_t fnv1a_hash( const std::string &data )
+{
+	std::uint64_t h = 14695981039346656037ULL;
+	for ( std::string::const_iterator itr=data.begin(); itr!=data.end(); ++itr )
+	{
+		h ^= (unsigned char)*itr;
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
+
 bool base_compare( const std::string &path,
 		const std::string &base )
 {
@@ -2079,21 +2086,6 @@ void get_url_components( const std::string &url,
 	}
 }
 
-std::string get_crc32( char *buff, int size )
-{
-#ifdef USE_LIBARCHIVE
-	uLong crc = crc32( 0L, Z_NULL, 0 );
-	crc = crc32( crc, (Bytef *)buff, size );
-
-	std::ostringstream ss;
-	ss.fill('0');
-	ss << std::hex << std::setw(8) << crc;
-	return ss.str();
-#else
-	return "";
-#endif
-}
-
 void string_to_vector( const std::string &input,
 	std::vector< std::string > &vec, bool allow_empty )
 {
@@ -111,6 +111,9 @@ std::string lowercase( const std::string &value );
 // Returns uppercase copy of string
 std::string uppercase( const std::string &value );
 
+// Returns the 64-bit FNV-1a hash of data, which is quick and stable between runs
+std::uint64_t fnv1a_hash( const std::string &data );
+
 //
 // Case insensitive compare of one and two
 // - Returns -1 if one < two, 1 if one > two, 0 if equal
@@ -449,8 +452,6 @@ void get_url_components( const std::string &url,
 	std::string &host,
 	std::string &req );
 
-std::string get_crc32( char *buff, int size );
-
 void string_to_vector( const std::string &input,
 	std::vector< std::string > &vec, bool allow_empty=false );
 
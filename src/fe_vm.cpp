@@ -36,6 +36,7 @@
 #include "fe_overlay.hpp"
 #include "fe_window.hpp"
 #include "fe_blend.hpp"
+#include "fe_cache.hpp"
 
 #ifdef USE_LIBCURL
 #include "fe_net.hpp"
@@ -44,6 +45,7 @@
 #include "fe_util.hpp"
 #include "fe_util_sq.hpp"
 #include "image_loader.hpp"
+#include "fe_profiler.hpp"
 #include "zip.hpp"
 
 #include <sqrat.h>
@@ -55,6 +57,7 @@
 #include <sqstdsystem.h>
 
 #include "nowide/fstream.hpp"
+#include "nowide/stat.hpp"
 #include <iostream>
 #include <stdio.h>
 #include <ctime>
@@ -63,6 +66,8 @@
 #include <cmath>
 #include <limits>
 #include <sstream>
+#include <cstdint>
+#include <cstring>
 
 #ifndef SFML_SYSTEM_WINDOWS
 #include <sys/stat.h>
@@ -130,6 +135,171 @@ namespace
 		return Sqrat::Function( environment, magic.c_str() + start );
 	}
 
+	//
+	// Script bytecode cache
+	//
+	// Compiled scripts are written to the cache dir with a header recording
+	// the source's path, mtime, size and content hash.  The path follows the
+	// header and must match before anything else is trusted.  A cache entry is used
+	// without reading the source when mtime and size match, or after
+	// reading it when the content hash still matches.  Anything else is
+	// compiled from source and the cache entry rewritten.
+	//
+	const char FE_SCRIPT_CACHE_TAG[4] = { 'F', 'E', 'S', 'C' };
+
+	struct FeScriptCacheHeader
+	{
+		char tag[4];
+		std::uint32_t version;
+		std::int64_t mtime;
+		std::uint64_t size;
+		std::uint64_t hash;
+		std::uint32_t path_size; // length of the source path following the header
+	};
+
+	// Path used to key and check the cache, the same file always gives the same key
+	std::string script_cache_key( const std::string &path )
+	{
+		std::string key = absolute_path( path );
+		std::replace( key.begin(), key.end(), '\\', '/' );
+		return key;
+	}
+
+	bool read_whole_file( const std::string &path, std::string &data )
+	{
+		nowide::ifstream file( path.c_str(), std::ios::binary );
+		if ( !file.is_open() )
+			return false;
+
+		std::ostringstream ss;
+		ss << file.rdbuf();
+		data = ss.str();
+		return true;
+	}
+
+	struct FeScriptReader
+	{
+		const std::string &data;
+		size_t pos;
+	};
+
+	SQInteger script_cache_read( SQUserPointer up, SQUserPointer buf, SQInteger size )
+	{
+		FeScriptReader *r = (FeScriptReader *)up;
+		if (( size <= 0 ) || ( r->pos + size > r->data.size() ))
+			return -1;
+
+		memcpy( buf, r->data.data() + r->pos, size );
+		r->pos += size;
+		return size;
+	}
+
+	SQInteger script_cache_write( SQUserPointer up, SQUserPointer buf, SQInteger size )
+	{
+		((std::string *)up)->append( (const char *)buf, size );
+		return size;
+	}
+
+	// Pushes the cached closure on success
+	bool read_script_cache( HSQUIRRELVM vm, const std::string &cached )
+	{
+		const FeScriptCacheHeader *h = (const FeScriptCacheHeader *)cached.data();
+		FeScriptReader r = { cached, sizeof( FeScriptCacheHeader ) + h->path_size };
+		return SQ_SUCCEEDED( sq_readclosure( vm, script_cache_read, &r ) );
+	}
+
+	// Writes the closure on top of the stack to the cache
+	void write_script_cache( HSQUIRRELVM vm,
+		const std::string &cache_file,
+		const std::string &key,
+		const nowide::stat_t &st,
+		std::uint64_t hash )
+	{
+		// cleared first so that the padding written out is zeroes, not stack contents
+		FeScriptCacheHeader h;
+		memset( &h, 0, sizeof( h ) );
+		memcpy( h.tag, FE_SCRIPT_CACHE_TAG, sizeof( h.tag ) );
+		h.version = FE_VERSION_NUM;
+		h.size = st.st_size;
+		h.hash = hash;
+		h.path_size = key.size();
+
+		// A source modified within the last couple of seconds could change
+		// again without its mtime moving, so leave it to the hash check
+		h.mtime = ( std::time( NULL ) - st.st_mtime < 2 ) ? 0 : st.st_mtime;
+
+		std::string data( (const char *)&h, sizeof( h ) );
+		data += key;
+		if ( SQ_FAILED( sq_writeclosure( vm, script_cache_write, &data ) ) )
+			return;
+
+		nowide::ofstream file( cache_file.c_str(), std::ios::binary );
+		if ( file.is_open() )
+			file.write( data.data(), data.size() );
+		else
+			FeDebug() << "Unable to write script cache: " << cache_file << std::endl;
+	}
+
+	//
+	// Loads the script at path and pushes its closure, using the bytecode
+	// cache where possible.  Behaves like sqstd_loadfile() otherwise.
+	//
+	SQRESULT load_script( HSQUIRRELVM vm, const std::string &path )
+	{
+		std::string key = script_cache_key( path );
+		std::string cache_file = FeCache::get_script_filename( key );
+		nowide::stat_t st;
+
+		if ( cache_file.empty() || ( nowide::stat( path.c_str(), &st ) != 0 ))
+			return sqstd_loadfile( vm, path.c_str(), SQTrue );
+
+		std::string cached;
+		const FeScriptCacheHeader *h = NULL;
+		if ( read_whole_file( cache_file, cached )
+				&& ( cached.size() > sizeof( FeScriptCacheHeader ) ))
+		{
+			h = (const FeScriptCacheHeader *)cached.data();
+			if (( memcmp( h->tag, FE_SCRIPT_CACHE_TAG, sizeof( h->tag ) ) != 0 )
+					|| ( h->version != FE_VERSION_NUM )
+					|| ( h->path_size != key.size() )
+					|| ( cached.size() <= sizeof( FeScriptCacheHeader ) + key.size() )
+					|| ( cached.compare( sizeof( FeScriptCacheHeader ), key.size(), key ) != 0 ))
+				h = NULL;
+		}
+
+		if ( h && ( h->mtime != 0 ) && ( h->mtime == (std::int64_t)st.st_mtime )
+				&& ( h->size == (std::uint64_t)st.st_size )
+				&& read_script_cache( vm, cached ))
+			return SQ_OK;
+
+		std::string src;
+		if ( !read_whole_file( path, src ) )
+			return sqstd_loadfile( vm, path.c_str(), SQTrue );
+
+		// Bytecode and UTF-16 sources are left to the squirrel loader
+		if (( src.size() >= 2 )
+				&& ((( src[0] == '\xFA' ) && ( src[1] == '\xFA' ))
+					|| (( src[0] == '\xFF' ) && ( src[1] == '\xFE' ))
+					|| (( src[0] == '\xFE' ) && ( src[1] == '\xFF' ))))
+			return sqstd_loadfile( vm, path.c_str(), SQTrue );
+
+		std::uint64_t hash = fnv1a_hash( src );
+		if ( h && ( h->hash == hash ) && read_script_cache( vm, cached ))
+		{
+			// Unchanged content, refresh the header so the next load can
+			// skip reading the source
+			write_script_cache( vm, cache_file, key, st, hash );
+			return SQ_OK;
+		}
+
+		size_t offset = ( src.compare( 0, 3, "\xEF\xBB\xBF" ) == 0 ) ? 3 : 0; // UTF-8 BOM
+		if ( SQ_FAILED( sq_compilebuffer( vm, src.c_str() + offset, src.size() - offset, path.c_str(), SQTrue ) ))
+			return SQ_ERROR;
+
+		write_script_cache( vm, cache_file, key, st, hash );
+		return SQ_OK;
+	}
+
 	bool run_script( const std::string &path,
 		const std::string &filename,
 		bool silent=false )
@@ -137,16 +307,23 @@ namespace
 		std::string path_to_run=path;
 		try
 		{
-			Sqrat::Script sc;
+			HSQUIRRELVM vm = Sqrat::DefaultVM::Get();
 			path_to_run += filename;
 
 			if ( !path_exists( path_to_run ) )
 				return false;
 
-			sc.CompileFile( path_to_run );
+			FeProfileScope profile( "load", path_to_run );
+			if ( SQ_FAILED( load_script( vm, path_to_run ) ))
+				throw Sqrat::Exception( Sqrat::LastErrorString( vm ) );
 
 			FeDebug() << "Running script: " << path_to_run << std::endl;
-			sc.Run();
+			sq_pushroottable( vm );
+			SQRESULT result = sq_call( vm, 1, SQFalse, SQTrue );
+			sq_pop( vm, 1 ); // the script closure
+			if ( SQ_FAILED( result ))
+				throw Sqrat::Exception( Sqrat::LastErrorString( vm ) );
+
 			FeDebug() << "Done script: " << path_to_run << std::endl;
 		}
 		catch( const Sqrat::Exception &e )
@@ -158,6 +335,80 @@ namespace
 		return true;
 	}
 
+	//
+	// obj.fft_copy( target, channel=0 )
+	// - copies the fft bands of an image or sound into an array or blob
+	//
+	template <class T>
+	SQInteger fft_copy( HSQUIRRELVM vm )
+	{
+		SQInteger args = sq_gettop( vm );
+		if (( args < 2 ) || ( args > 3 ))
+			return sq_throwerror( vm, _SC("fft_copy() requires a target array or blob and optional channel") );
+
+		T *obj = Sqrat::ClassType<T>::GetInstance( vm, 1 );
+		if ( !obj )
+			return sq_throwerror( vm, Sqrat::Error::Instance().Message( vm ).c_str() );
+
+		SQInteger channel = 0;
+		if (( args == 3 ) && SQ_FAILED( sq_getinteger( vm, 3, &channel )))
+			return sq_throwerror( vm, _SC("fft_copy() channel must be an integer") );
+
+		FeAudioVisualiser *visualiser = obj->get_audio_visualiser();
+		if ( !visualiser )
+		{
+			sq_pushinteger( vm, 0 );
+			return 1;
+		}
+
+		return visualiser->script_copy_fft( vm, 2, channel );
+	}
+
+	//
+	// Get a function returning the current visualiser of the object at idx,
+	// or an empty one if it isn't a T.  The object owns its visualiser and
+	// can replace it whenever its media changes, so it is always asked
+	//
+	template <class T>
+	std::function<FeAudioVisualiser *()> get_visualiser_arg( HSQUIRRELVM vm, SQInteger idx )
+	{
+		T *obj = Sqrat::ClassType<T>::GetInstance( vm, idx );
+		Sqrat::Error::Instance().Clear( vm );
+
+		if ( !obj )
+			return nullptr;
+
+		return [obj]() { return obj->get_audio_visualiser(); };
+	}
+
+	//
+	// shader.set_fft_param( name, obj )
+	// - binds the fft/vu texture of an image or sound to a shader sampler
+	//
+	SQInteger shader_set_fft_param( HSQUIRRELVM vm )
+	{
+		if ( sq_gettop( vm ) != 3 )
+			return sq_throwerror( vm, _SC("set_fft_param() requires a name and an image or sound") );
+
+		FeShader *sh = Sqrat::ClassType<FeShader>::GetInstance( vm, 1 );
+		if ( !sh )
+			return sq_throwerror( vm, Sqrat::Error::Instance().Message( vm ).c_str() );
+
+		const SQChar *name;
+		if ( SQ_FAILED( sq_getstring( vm, 2, &name )))
+			return sq_throwerror( vm, _SC("set_fft_param() name must be a string") );
+
+		std::function<FeAudioVisualiser *()> source = get_visualiser_arg<FeImage>( vm, 3 );
+		if ( !source )
+			source = get_visualiser_arg<FeMusic>( vm, 3 );
+
+		if ( !source )
+			return sq_throwerror( vm, _SC("set_fft_param() requires an image or sound") );
+
+		sh->set_fft_param( name, source );
+		return 0;
+	}
+
 	SQInteger zip_extract_file(HSQUIRRELVM vm)
 	{
 		if ( sq_gettop( vm ) != 3 )
@@ -814,6 +1065,7 @@ void FeVM::vm_init()
 	sq_setforeignptr( vm, this );
 	register_libs( vm );
 	sqstd_seterrorhandlers( vm );
+	FeScriptProfiler::attach( vm );
 	Sqrat::DefaultVM::Set( vm );
 }
 
@@ -1222,6 +1474,7 @@ bool FeVM::on_new_layout()
 		.Prop(_SC("fft_left"), &FeImage::get_fft_array_left )
 		.Prop(_SC("fft_right"), &FeImage::get_fft_array_right )
 		.Prop(_SC("fft_bands"), &FeImage::get_fft_bands, &FeImage::set_fft_bands )
+		.SquirrelFunc(_SC("fft_copy"), &fft_copy<FeImage> )
 		ANIM_PROP( _SC("padding_left"), &FeImage::get_padding_left, &FeImage::set_padding_left )
 		ANIM_PROP( _SC("padding_right"), &FeImage::get_padding_right, &FeImage::set_padding_right )
 		ANIM_PROP( _SC("padding_top"), &FeImage::get_padding_top, &FeImage::set_padding_top )
@@ -1481,6 +1734,7 @@ bool FeVM::on_new_layout()
 		.Prop( _SC("size"), &FePresent::get_current_filter_size )
 		.Prop( _SC("clones_list"), &FePresent::get_clones_list_showing )
 		.Prop( _SC("tags"), &FePresent::get_tags_available )
+		.Prop( _SC("loading"), &FePresent::get_list_loading )
 
 		// The following are deprecated as of version 1.5 in favour of using the fe.filters array:
 		.Prop( _SC("filter"), &FePresent::get_filter_name )	// deprecated as of 1.5
@@ -1546,6 +1800,7 @@ bool FeVM::on_new_layout()
 		.Prop( _SC("fft_left"), &FeMusic::get_fft_array_left )
 		.Prop( _SC("fft_right"), &FeMusic::get_fft_array_right )
 		.Prop( _SC("fft_bands"), &FeMusic::get_fft_bands, &FeMusic::set_fft_bands )
+		.SquirrelFunc( _SC("fft_copy"), &fft_copy<FeMusic> )
 		.Func( _SC("get_metadata"), &FeMusic::get_metadata )
 	);
 
@@ -1557,6 +1812,12 @@ bool FeVM::on_new_layout()
 		.Overload<void (FeShader::*)(const char *, float, float, float, float)>(_SC("set_param"), &FeShader::set_param)
 		.Overload<void (FeShader::*)(const char *)>( _SC("set_texture_param"), &FeShader::set_texture_param )
 		.Overload<void (FeShader::*)(const char *, FeImage *)>( _SC("set_texture_param"), &FeShader::set_texture_param )
+		.SquirrelFunc( _SC("set_fft_param"), &shader_set_fft_param )
+		.Func( _SC("get_param_handle"), &FeShader::get_param_handle )
+		.Overload<void (FeShader::*)(int, float)>(_SC("set_param_value"), &FeShader::set_param_value)
+		.Overload<void (FeShader::*)(int, float, float)>(_SC("set_param_value"), &FeShader::set_param_value)
+		.Overload<void (FeShader::*)(int, float, float, float)>(_SC("set_param_value"), &FeShader::set_param_value)
+		.Overload<void (FeShader::*)(int, float, float, float, float)>(_SC("set_param_value"), &FeShader::set_param_value)
 	);
 
 	fe.Bind( _SC("Display"), Class <FeDisplayInfo, NoConstructor>()
@@ -1942,6 +2203,7 @@ bool FeVM::on_tick()
 		bool remove=false;
 		try
 		{
+			FeProfileScope profile( "tick", (*itr).m_fn, (*itr).m_file );
 			Function &func = (*itr).get_fn();
 			if ( !func.IsNull() )
 				func.Execute( m_layout_time_old.asMilliseconds() );
@@ -2021,6 +2283,7 @@ void FeVM::on_transition(
 			bool keep=false;
 			try
 			{
+				FeProfileScope profile( "transition", (*itr)->m_fn, (*itr)->m_file );
 				Function &func = (*itr)->get_fn();
 				if ( !func.IsNull() )
 				{
@@ -2095,6 +2358,7 @@ bool FeVM::script_handle_event( FeInputMap::Command c )
 
 		try
 		{
+			FeProfileScope profile( "signal", (*itr).m_fn, (*itr).m_file );
 			Function &func = (*itr).get_fn();
 			if (( !func.IsNull() )
 					&& ( func.Evaluate<bool>( FeInputMap::commandStrings[ c ] )))
@@ -2288,6 +2552,7 @@ bool FePresent::script_process_magic_strings( std::string &str,
 			if ( !func.IsNull() )
 			{
 				std::string result;
+				FeProfileScope profile( "magic", magic );
 
 				switch ( fe_get_num_params( vm, func.GetFunc(), func.GetEnv() ) )
 				{
@@ -27,6 +27,7 @@
 #include "fe_settings.hpp"
 #include "fe_window.hpp"
 #include "fe_present.hpp"
+#include "fe_texture_pool.hpp"
 #include "base64.hpp"
 
 #ifdef SFML_SYSTEM_WINDOWS
@@ -132,6 +133,7 @@ LRESULT CALLBACK FeWindow::CustomWndProc( HWND hwnd, UINT msg, WPARAM wParam, LP
 
 FeWindow::FeWindow( FeSettings &fes )
 	: m_window( NULL ),
+	m_offscreen( NULL ),
 	m_fes( fes ),
 	m_running_pid( 0 ),
 	m_running_wnd( NULL ),
@@ -146,10 +148,19 @@ FeWindow::~FeWindow()
 
 	if ( m_window )
 		delete m_window;
+
+	if ( m_offscreen )
+		delete m_offscreen;
 }
 
 void FeWindow::display()
 {
+	if ( m_offscreen )
+	{
+		m_offscreen->display();
+		return;
+	}
+
 	m_window->display();
 
 	// Starting from Windows Vista non fullscreen window modes
@@ -203,11 +214,39 @@ void FeWindow::set_window_position( const FeWindowPosition &pos )
 	m_win_pos = pos;
 }
 
+bool FeWindow::create_offscreen( const sf::Vector2u &size )
+{
+	// The window object is never opened, it only exists so code that asks
+	// for it (i.e. for the mouse position) keeps working
+	if ( !m_window )
+		m_window = new sf::RenderWindow();
+
+	if ( !m_offscreen )
+		m_offscreen = new sf::RenderTexture();
+
+	sf::ContextSettings ctx;
+	ctx.antiAliasingLevel = m_fes.get_antialiasing();
+
+	if ( !m_offscreen->resize( size, ctx ))
+	{
+		FeLog() << "Error creating " << size.x << "x" << size.y << " offscreen render target" << std::endl;
+		return false;
+	}
+
+	m_win_mode = FeSettings::Window;
+	m_offscreen->clear();
+	return true;
+}
+
 void FeWindow::initial_create()
 {
-	// If re-initialising save its position first
+	// If re-initialising save its position first, and drop the pooled textures
+	// rather than keep GL objects across the new window
 	if ( m_window )
+	{
 		save();
+		FeTexturePool::get_ref().purge();
+	}
 	else
 		m_window = new sf::RenderWindow();
 
@@ -792,9 +831,17 @@ sf::RenderWindow &FeWindow::get_win()
 	return *m_window;
 }
 
+sf::Vector2u FeWindow::get_size()
+{
+	if ( m_offscreen )
+		return m_offscreen->getSize();
+
+	return m_window ? m_window->getSize() : sf::Vector2u( 0, 0 );
+}
+
 void FeWindow::save()
 {
-	if ( m_window && is_windowed_mode( m_win_mode ) && !m_win_pos.m_temporary )
+	if ( m_window && !m_offscreen && is_windowed_mode( m_win_mode ) && !m_win_pos.m_temporary )
 	{
 		m_window->display(); // Crashing on Linux workaround
 
@@ -805,6 +852,9 @@ void FeWindow::save()
 
 void FeWindow::close()
 {
+	// Free pooled textures while there is still a GL context
+	FeTexturePool::get_ref().purge();
+
 	if ( m_window )
 	{
 		m_window->display(); // Crashing on Linux workaround
@@ -815,6 +865,9 @@ void FeWindow::close()
 
 bool FeWindow::hasFocus()
 {
+	if ( m_offscreen )
+		return true;
+
 	if ( m_window )
 		return m_window->hasFocus();
 
@@ -823,6 +876,9 @@ bool FeWindow::hasFocus()
 
 bool FeWindow::isOpen()
 {
+	if ( m_offscreen )
+		return true;
+
 	if ( m_window )
 		return m_window->isOpen();
 
@@ -831,17 +887,24 @@ bool FeWindow::isOpen()
 
 void FeWindow::clear()
 {
-	if ( m_window )
+	if ( m_offscreen )
+		m_offscreen->clear();
+	else if ( m_window )
 		m_window->clear();
 }
 
 void FeWindow::draw( const sf::Drawable &d, const sf::RenderStates &r )
 {
-	if ( m_window )
+	if ( m_offscreen )
+		m_offscreen->draw( d, r );
+	else if ( m_window )
 		m_window->draw( d, r );
 }
 
 const std::optional<sf::Event> FeWindow::pollEvent()
 {
+	if ( m_offscreen )
+		return std::nullopt;
+
 	return m_window->pollEvent();
 }
@@ -60,6 +60,7 @@ class FeWindow
 
 protected:
 	sf::RenderWindow *m_window;
+	sf::RenderTexture *m_offscreen; // set when rendering headless (--benchmark)
 	FeSettings &m_fes;
 	unsigned int m_running_pid;
 	void *m_running_wnd;
@@ -82,6 +83,11 @@ public:
 
 	void set_window_position( const FeWindowPosition &pos );
 	void initial_create();		// first time window creation
+
+	// Render to an offscreen texture of the given size instead of a window.
+	// Used for headless benchmarking, no window is ever shown
+	bool create_offscreen( const sf::Vector2u &size );
+	bool is_offscreen() const { return m_offscreen != NULL; }
 	bool run();						// run the currently selected game (blocking). returns false if window closed in the interim
 	void on_exit();				// called before exiting frontend
 
@@ -99,6 +105,7 @@ public:
 	const std::optional<sf::Event> pollEvent();
 
 	sf::RenderWindow &get_win();
+	sf::Vector2u get_size(); // size of the drawing area
 	int get_window_mode() { return m_win_mode; }
 };
 
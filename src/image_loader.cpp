@@ -442,7 +442,9 @@ class FeImageLoaderImp
 public:
 	FeImageLoaderImp()
 		: m_cache( NULL ),
-		m_load_images_in_bg( false )
+		m_load_images_in_bg( false ),
+		m_hits( 0 ),
+		m_misses( 0 )
 	{
 	};
 
@@ -455,6 +457,8 @@ public:
 	FeImageLRUCache *m_cache;
 	FeImageLoaderThread m_bg_loader;
 	bool m_load_images_in_bg;
+	int m_hits;
+	int m_misses;
 };
 
 FeImageLoaderEntry::FeImageLoaderEntry( sf::InputStream *s )
@@ -557,6 +561,7 @@ bool FeImageLoader::internal_load_image( const std::string &key, sf::InputStream
 	if ( m_imp->m_cache && m_imp->m_cache->get( key, &temp_e ))
 	{
 		FeDebug() << "Image cache hit: " << key << std::endl;
+		m_imp->m_hits++;
 		delete stream;
 
 		std::lock_guard<std::recursive_mutex> l( g_mutex );
@@ -569,6 +574,8 @@ bool FeImageLoader::internal_load_image( const std::string &key, sf::InputStream
 		FeDebug() << "Image cache miss: " << key << std::endl;
 	}
 
+	m_imp->m_misses++;
+
 	temp_e = new FeImageLoaderEntry( stream );
 
 	// load image dimensions now
@@ -754,6 +761,18 @@ void FeImageLoader::add_to_cache( const std::string &key, FeImageLoaderEntry *en
 	m_imp->m_cache->put(key, entry);
 }
 
+void FeImageLoader::get_stats( int &hits, int &misses )
+{
+	hits = m_imp->m_hits;
+	misses = m_imp->m_misses;
+}
+
+void FeImageLoader::reset_stats()
+{
+	m_imp->m_hits = 0;
+	m_imp->m_misses = 0;
+}
+
 int FeImageLoader::cache_max()
 {
 	if ( !m_imp->m_cache )
@@ -110,6 +110,10 @@ public:
 	bool get_background_loading();
 	bool image_in_cache( const std::string &filename );
 	void add_to_cache(const std::string &key, FeImageLoaderEntry *entry);
+
+	// Cache hit/miss counts for images requested since the last reset_stats()
+	void get_stats( int &hits, int &misses );
+	void reset_stats();
 private:
 	FeImageLoader();
 	FeImageLoader( const FeImageLoader & );
@@ -35,6 +35,8 @@
 #include "fe_vm.hpp"
 #include "fe_blend.hpp"
 #include "fe_net.hpp"
+#include "fe_profiler.hpp"
+#include "fe_benchmark.hpp"
 #include <iostream>
 #include <cmath>
 #include <cstdlib>
@@ -66,11 +68,59 @@ void process_args( int argc, char *argv[],
 			std::string &log_file,
 			FeLogLevel &log_level,
 			bool &window_topmost,
-			std::vector<int> &window_args );
+			std::vector<int> &window_args,
+			std::string &profile_file,
+			std::string &benchmark_display,
+			int &benchmark_frames,
+			std::string &benchmark_report );
+
+//
+// Times the phases of start-up, logging them once the first frame showing the
+// current list has been drawn
+//
+class FeStartupTrace
+{
+public:
+	FeStartupTrace() : m_done( false ) {}
+
+	// End the current phase
+	void phase( const char *name )
+	{
+		if ( m_done )
+			return;
+
+		sf::Time t = m_clock.getElapsedTime();
+		m_phases.push_back( std::make_pair( std::string( name ), ( t - m_last ).asMilliseconds() ));
+		m_last = t;
+	}
+
+	void finish( const char *name )
+	{
+		if ( m_done )
+			return;
+
+		phase( name );
+		m_done = true;
+
+		FeLog() << " - Startup: ";
+		for ( std::vector< std::pair<std::string, int> >::iterator itr=m_phases.begin(); itr!=m_phases.end(); ++itr )
+			FeLog() << (*itr).first << " " << (*itr).second << "ms, ";
+
+		FeLog() << "total " << m_last.asMilliseconds() << "ms" << std::endl;
+	}
+
+	bool is_done() const { return m_done; }
+
+private:
+	sf::Clock m_clock;
+	sf::Time m_last;
+	std::vector< std::pair<std::string, int> > m_phases;
+	bool m_done;
+};
 
 int main(int argc, char *argv[])
 {
-	std::string config_path, log_file;
+	std::string config_path, log_file, profile_file;
 	bool launch_game = false;
 	bool initial_load = true;
 	bool process_console = false;
@@ -85,13 +135,18 @@ int main(int argc, char *argv[])
 	std::vector<int> window_args = std::vector<int>();
 	int layout_sel = 0;
 	int plugin_sel = 0;
+	std::string benchmark_display;
+	int benchmark_frames = FeBenchmark::DEFAULT_FRAMES;
+	std::string benchmark_report = FeBenchmark::DEFAULT_REPORT;
+	FeStartupTrace startup_trace;
 
 #ifdef USE_LIBCURL
 	curl_global_init( CURL_GLOBAL_ALL );
 #endif
 
 	nowide::args a( argc, argv );
-	process_args( argc, argv, config_path, process_console, startup_display, startup_filter, startup_rom, log_file, log_level, window_topmost, window_args );
+	process_args( argc, argv, config_path, process_console, startup_display, startup_filter, startup_rom, log_file, log_level, window_topmost, window_args, profile_file,
+		benchmark_display, benchmark_frames, benchmark_report );
 
 	FeSettings feSettings( config_path );
 	feSettings.set_window_topmost( window_topmost );
@@ -137,6 +192,9 @@ int main(int argc, char *argv[])
 	fe_print_version();
 	FeLog() << std::endl;
 
+	if ( !profile_file.empty() )
+		FeScriptProfiler::enable( clean_path( profile_file ) );
+
 	// Redirect SFML error buffer to FeLog
 	sf::err().rdbuf(FeLog().rdbuf());
 
@@ -155,6 +213,29 @@ int main(int argc, char *argv[])
 #endif
 
 	feSettings.load();
+	startup_trace.phase( "settings" );
+
+	if ( !benchmark_display.empty() )
+		feSettings.set_mute( true );
+
+	//
+	// Start the independent parts of start-up early, so they run alongside the
+	// window and script setup below:
+	// - the built-in font is decoded
+	// - the startup display's romlist and filters load in the background (this also
+	//   prefetches its artwork directories)
+	// - event sounds are decoded by FeSoundSystem
+	//
+	FeFontContainer::start_default_font_decode();
+
+	bool display_started = false;
+	if ( benchmark_display.empty() && startup_display.empty()
+			&& ( feSettings.displays_count() > 0 )
+			&& !feSettings.get_info( FeSettings::Language ).empty() )
+	{
+		feSettings.set_display( feSettings.get_selected_display_index(), false, true );
+		display_started = true;
+	}
 
 	//
 	// Set up music/sound playing objects
@@ -162,10 +243,22 @@ int main(int argc, char *argv[])
 	FeSoundSystem soundsys( &feSettings );
 
 	soundsys.play_ambient();
+	startup_trace.phase( "sound" );
 
 	FeWindow window( feSettings );
 	window.set_window_position( win_pos );
-	window.initial_create();
+
+	if ( !benchmark_display.empty() )
+	{
+		// Headless: render offscreen at the -w size, or 1280x720
+		sf::Vector2u size = window_args.empty() ? sf::Vector2u( 1280, 720 ) : win_pos.m_size;
+		if ( !window.create_offscreen( size ))
+			return 1;
+	}
+	else
+		window.initial_create();
+
+	startup_trace.phase( "window" );
 
 #ifdef WINDOWS_CONSOLE
 	if ( feSettings.get_hide_console() )
@@ -178,6 +271,21 @@ int main(int argc, char *argv[])
 
 	// Set transforms now in case load_layout never gets called (ie: first-run), required for multimon
 	feVM.set_transforms();
+	startup_trace.phase( "scripting" );
+
+	if ( !benchmark_display.empty() )
+	{
+		FeBenchmark benchmark( feSettings, window, feVM );
+		int retval = benchmark.run( benchmark_display, benchmark_frames, benchmark_report );
+
+		feVM.on_stop_frontend();
+		soundsys.stop();
+#ifdef USE_LIBCURL
+		versionChecker.reset();
+		curl_global_cleanup();
+#endif
+		return retval;
+	}
 
 	bool exit_selected=false;
 
@@ -277,18 +385,22 @@ int main(int argc, char *argv[])
 				}
 			}
 		}
-		else
+		else if ( !display_started )
 		{
-			// Load the display early so the intro can use the romlist and artwork
+			// First run (or no displays when start-up began), load in the foreground as before
 			feSettings.set_display( feSettings.get_selected_display_index() );
 		}
 
+		startup_trace.phase( "display" );
+
 		// Attempt to start the intro
 		if ( !feVM.load_intro() )
 		{
 			// Post a dummy command to trigger poll_command to end the Intro_Showing mode
 			feVM.post_command( FeInputMap::EventStartup );
 		}
+
+		startup_trace.phase( "intro" );
 	}
 
 	while (window.isOpen() && (!exit_selected))
@@ -307,6 +419,7 @@ int main(int argc, char *argv[])
 				feSettings.on_joystick_connect(); // update joystick mappings
 
 				soundsys.stop();
+				soundsys.load_sounds();
 				soundsys.play_ambient();
 
 				// Recreate window if the window mode changed
@@ -367,7 +480,7 @@ int main(int argc, char *argv[])
 					}
 					else
 					{
-						if ( feSettings.set_display( index, true ) )
+						if ( feSettings.set_display( index, true, true ) )
 							feVM.load_layout();
 						else
 							feVM.update_to_new_list( 0, true );
@@ -556,7 +669,7 @@ int main(int argc, char *argv[])
 					//
 					if ( feSettings.back_displays_available() )
 					{
-						if ( feSettings.set_display( -1, true ) )
+						if ( feSettings.set_display( -1, true, true ) )
 							feVM.load_layout();
 						else
 							feVM.update_to_new_list( 0, true );
@@ -713,6 +826,7 @@ int main(int argc, char *argv[])
 					feSettings.on_joystick_connect(); // update joystick mappings
 
 					soundsys.stop();
+					soundsys.load_sounds();
 					soundsys.play_ambient();
 
 					// Recreate window if the window mode changed
@@ -972,7 +1086,7 @@ int main(int argc, char *argv[])
 							}
 							else if ( sel_idx >= 0 )
 							{
-								if ( feSettings.set_display( disp_indices[sel_idx] ) )
+								if ( feSettings.set_display( disp_indices[sel_idx], false, true ) )
 									feVM.load_layout();
 								else
 									feVM.update_to_new_list( 0, true );
@@ -1323,6 +1437,10 @@ int main(int argc, char *argv[])
 			window.draw( feVM );
 			window.display();
 			redraw=false;
+
+			// Start-up is done once a frame with the current list has been drawn
+			if ( !startup_trace.is_done() && !feSettings.is_display_loading() )
+				startup_trace.finish( "first frame" );
 		}
 		else
 			sf::sleep( sf::milliseconds( 15 ) );
@@ -1332,6 +1450,8 @@ int main(int argc, char *argv[])
 
 	window.on_exit();
 	feVM.on_stop_frontend();
+	FeScriptProfiler::write_report();
+	FeStatsWriter::get_ref().flush();
 
 	if ( window.isOpen() )
 		window.close();
@@ -27,6 +27,7 @@
 #include <SFML/Graphics.hpp>
 #include "fe_present.hpp"
 #include "fe_audio_fx.hpp"
+#include "fe_texture_pool.hpp"
 
 extern "C"
 {
@@ -45,7 +46,6 @@ extern "C"
 #endif
 }
 
-#include <queue>
 #include <iostream>
 #include <thread>
 #include <condition_variable>
@@ -114,6 +114,47 @@ void print_ffmpeg_version_info()
 
 #define MAX_AUDIO_FRAME_SIZE 256000
 
+//
+// Demuxer queue limits.  The demux thread stops reading once every stream
+// has at least PACKETQ_MIN_PACKETS queued, or once the queued packets
+// total more than PACKETQ_MAX_BYTES.  PACKETQ_CAPACITY is the hard limit
+// on packets queued for a single stream and must be a power of two.
+//
+#define PACKETQ_CAPACITY 1024
+#define PACKETQ_MIN_PACKETS 25
+#define PACKETQ_MAX_BYTES ( 16 * 1024 * 1024 )
+
+//
+// Bounded single producer/single consumer packet queue.  The demux thread
+// is the only producer and the stream's decoder (the audio callback or the
+// video thread) is the only consumer, so no locking is needed.
+//
+class FePacketRing
+{
+public:
+	FePacketRing();
+	~FePacketRing();
+
+	bool push( AVPacket *pkt ); // producer, returns false if full
+	AVPacket *pop(); // consumer, returns NULL if empty
+
+	// Free all queued packets.  Only call when the producer is stopped
+	void clear();
+
+	size_t size() const;
+	size_t bytes() const;
+	bool full() const;
+
+private:
+	AVPacket *m_slots[ PACKETQ_CAPACITY ];
+	std::atomic<size_t> m_head; // next slot to pop
+	std::atomic<size_t> m_tail; // next slot to push
+	std::atomic<size_t> m_bytes;
+
+	FePacketRing( const FePacketRing & );
+	FePacketRing &operator=( const FePacketRing & );
+};
+
 //
 // Container for our general implementation
 //
@@ -123,11 +164,27 @@ public:
 	FeMediaImp( FeMedia::Type t );
 	void close();
 
+	// Used by the consumers to wait for the demux thread and vice versa.
+	// The waits time out so that callers can recheck their own stop flags
+	void wait_for_packet();
+	void notify_packet();
+	void notify_space();
+
 	FeMedia::Type m_type;
 	AVFormatContext *m_format_ctx;
 	AVIOContext *m_io_ctx;
 	std::recursive_mutex m_read_mutex;
-	bool m_read_eof;
+	std::atomic<bool> m_read_eof;
+
+	//
+	// Demuxing runs on a dedicated thread so that neither the audio
+	// callback nor the video thread ever has to wait on a read
+	//
+	std::thread m_demux_thread;
+	std::atomic<bool> m_run_demux;
+	std::mutex m_demux_mutex;
+	std::condition_variable m_packet_cond;
+	std::condition_variable m_space_cond;
 };
 
 //
@@ -135,14 +192,12 @@ public:
 //
 class FeBaseStream
 {
-private:
+public:
 	//
-	// Queue containing the next packet to process for this stream
+	// Queue containing the next packets to process for this stream
 	//
-	std::queue <AVPacket *> m_packetq;
-	std::mutex m_packetq_mutex;
+	FePacketRing packetq;
 
-public:
 	virtual ~FeBaseStream();
 
 	bool at_end;					// set when at the end of our input
@@ -153,8 +208,6 @@ public:
 
 	FeBaseStream();
 	virtual void stop();
-	AVPacket *pop_packet();
-	void push_packet( AVPacket *pkt );
 	void clear_packet_queue();
 };
 
@@ -199,6 +252,7 @@ private:
 public:
 	std::atomic<bool> run_video_thread;
 	sf::Time time_base;
+	double stream_time_base; // seconds per pts unit
 	sf::Time max_sleep;
 	sf::Clock video_timer;
 	sf::Texture *display_texture;
@@ -225,12 +279,95 @@ public:
 	void video_thread();
 };
 
+FePacketRing::FePacketRing()
+	: m_slots(),
+	m_head( 0 ),
+	m_tail( 0 ),
+	m_bytes( 0 )
+{
+}
+
+FePacketRing::~FePacketRing()
+{
+	clear();
+}
+
+bool FePacketRing::push( AVPacket *pkt )
+{
+	size_t tail = m_tail.load( std::memory_order_relaxed );
+	if ( tail - m_head.load( std::memory_order_acquire ) >= PACKETQ_CAPACITY )
+		return false;
+
+	m_slots[ tail & ( PACKETQ_CAPACITY - 1 ) ] = pkt;
+	m_bytes.fetch_add( pkt->size, std::memory_order_relaxed );
+	m_tail.store( tail + 1, std::memory_order_release );
+	return true;
+}
+
+AVPacket *FePacketRing::pop()
+{
+	size_t head = m_head.load( std::memory_order_relaxed );
+	if ( head == m_tail.load( std::memory_order_acquire ))
+		return NULL;
+
+	AVPacket *pkt = m_slots[ head & ( PACKETQ_CAPACITY - 1 ) ];
+	m_bytes.fetch_sub( pkt->size, std::memory_order_relaxed );
+	m_head.store( head + 1, std::memory_order_release );
+	return pkt;
+}
+
+void FePacketRing::clear()
+{
+	AVPacket *p;
+	while (( p = pop() ))
+		av_packet_free( &p );
+}
+
+size_t FePacketRing::size() const
+{
+	return m_tail.load( std::memory_order_acquire )
+		- m_head.load( std::memory_order_acquire );
+}
+
+size_t FePacketRing::bytes() const
+{
+	return m_bytes.load( std::memory_order_relaxed );
+}
+
+bool FePacketRing::full() const
+{
+	return ( size() >= PACKETQ_CAPACITY );
+}
+
 FeMediaImp::FeMediaImp( FeMedia::Type t )
 	: m_type( t ),
 	m_format_ctx( NULL ),
 	m_io_ctx( NULL ),
-	m_read_eof( false )
+	m_read_eof( false ),
+	m_run_demux( false )
+{
+}
+
+void FeMediaImp::wait_for_packet()
+{
+	std::unique_lock<std::mutex> l( m_demux_mutex );
+	m_packet_cond.wait_for( l, std::chrono::milliseconds( 10 ) );
+}
+
+void FeMediaImp::notify_packet()
+{
+	{
+		std::lock_guard<std::mutex> l( m_demux_mutex );
+	}
+	m_packet_cond.notify_all();
+}
+
+void FeMediaImp::notify_space()
 {
+	{
+		std::lock_guard<std::mutex> l( m_demux_mutex );
+	}
+	m_space_cond.notify_one();
 }
 
 void FeMediaImp::close()
@@ -285,34 +422,9 @@ void FeBaseStream::stop()
 	far_behind = false;
 }
 
-AVPacket *FeBaseStream::pop_packet()
-{
-	std::lock_guard<std::mutex> l( m_packetq_mutex );
-
-	if ( m_packetq.empty() )
-		return NULL;
-
-	AVPacket *p = m_packetq.front();
-	m_packetq.pop();
-	return p;
-}
-
 void FeBaseStream::clear_packet_queue()
 {
-	std::lock_guard<std::mutex> l( m_packetq_mutex );
-
-	while ( !m_packetq.empty() )
-	{
-		AVPacket *p = m_packetq.front();
-		m_packetq.pop();
-		av_packet_free( &p );
-	}
-}
-
-void FeBaseStream::push_packet( AVPacket *pkt )
-{
-	std::lock_guard<std::mutex> l( m_packetq_mutex );
-	m_packetq.push( pkt );
+	packetq.clear();
 }
 
 FeAudioImp::FeAudioImp()
@@ -467,6 +579,7 @@ FeVideoImp::FeVideoImp( FeMedia *p )
 		hwaccel_output_format( AV_PIX_FMT_NONE ),
 #endif
 		run_video_thread( false ),
+		stream_time_base( 0.0 ),
 		display_texture( NULL ),
 		disptex_width( 0 ),
 		disptex_height( 0 ),
@@ -664,19 +777,7 @@ void FeVideoImp::video_thread()
 		if ( detached_frame )
 		{
 
-			sf::Time frame_time;
-			{
-				std::lock_guard<std::recursive_mutex> l( m_parent->m_imp->m_read_mutex );
-				if ( m_parent->m_imp->m_format_ctx && stream_id >= 0 )
-				{
-					frame_time = sf::seconds( detached_frame->pts
-						* av_q2d( m_parent->m_imp->m_format_ctx->streams[stream_id]->time_base ));
-				}
-				else
-				{
-					frame_time = sf::Time::Zero;
-				}
-			}
+			sf::Time frame_time = sf::seconds( detached_frame->pts * stream_time_base );
 			wait_time = frame_time - m_parent->get_video_time() + half_frame_offset;
 
 			if ( wait_time < max_sleep )
@@ -806,14 +907,19 @@ void FeVideoImp::video_thread()
 				//
 				// get next packet
 				//
-				AVPacket *packet = pop_packet();
+				// check for the end before popping, the demux thread queues
+				// its last packet before flagging the end of file
+				bool eof = m_parent->end_of_file();
+				AVPacket *packet = packetq.pop();
 				if ( packet == NULL )
 				{
-					if ( !m_parent->end_of_file() )
-						m_parent->read_packet();
+					if ( !eof )
+						m_parent->m_imp->wait_for_packet();
 					else
 						do_flush = true; // NULL packet will be fed to avcodec_send_packet()
 				}
+				else
+					m_parent->m_imp->notify_space();
 
 				if (( packet != NULL ) || ( do_flush && !flush_packet_sent ))
 				{
@@ -988,6 +1094,8 @@ void FeMedia::play()
 {
 	if ( !is_playing() )
 	{
+		start_demux();
+
 		if ( m_video )
 			m_video->play();
 
@@ -1000,6 +1108,9 @@ void FeMedia::signal_stop()
 {
 	m_alive.store( false, std::memory_order_release );
 
+	m_imp->m_run_demux = false;
+	m_imp->notify_space();
+
 	if ( m_audio )
 		sf::SoundStream::stop();
 
@@ -1009,6 +1120,10 @@ void FeMedia::signal_stop()
 
 void FeMedia::stop()
 {
+	// Stop the demuxer first so that nothing refills the packet queues
+	// and so that a consumer waiting on a packet gives up
+	stop_demux();
+
 	if ( m_audio )
 	{
 		sf::SoundStream::stop();
@@ -1042,14 +1157,13 @@ void FeMedia::stop()
 		avcodec_flush_buffers( m_video->codec_ctx );
 	}
 
-	{
-		std::lock_guard<std::recursive_mutex> l( m_imp->m_read_mutex );
-		m_imp->m_read_eof = false;
-	}
+	m_imp->m_read_eof = false;
 }
 
 void FeMedia::close()
 {
+	// Stop the demuxer first, an audio callback could be waiting on it
+	stop_demux();
 
 	{ // Wait for getData() callback
 		std::lock_guard<std::mutex> callback_mutex( m_callback_mutex );
@@ -1382,7 +1496,8 @@ bool FeMedia::open( const std::string &archive,
 				m_video->codec_ctx = codec_ctx;
 
 				m_video->codec = dec;
-				m_video->time_base = sf::seconds( av_q2d( m_imp->m_format_ctx->streams[stream_id]->time_base ));
+				m_video->stream_time_base = av_q2d( m_imp->m_format_ctx->streams[stream_id]->time_base );
+				m_video->time_base = sf::seconds( m_video->stream_time_base );
 
 				m_video->max_sleep = sf::seconds( 0.5 / av_q2d( m_imp->m_format_ctx->streams[stream_id]->r_frame_rate ));
 
@@ -1396,7 +1511,7 @@ bool FeMedia::open( const std::string &archive,
 
 				m_video->display_texture = outt;
 				if ( outt->getSize() != sf::Vector2u( m_video->disptex_width, m_video->disptex_height ))
-					std::ignore = m_video->display_texture->resize({ static_cast<unsigned int>( m_video->disptex_width ), static_cast<unsigned int>( m_video->disptex_height )});
+					FeTexturePool::get_ref().resize( *m_video->display_texture, { static_cast<unsigned int>( m_video->disptex_width ), static_cast<unsigned int>( m_video->disptex_height )});
 
 				m_video->init_rgba_buffer();
 			}
@@ -1411,59 +1526,121 @@ bool FeMedia::open( const std::string &archive,
 
 bool FeMedia::end_of_file()
 {
-	std::lock_guard<std::recursive_mutex> l( m_imp->m_read_mutex );
+	return m_imp->m_read_eof.load( std::memory_order_acquire );
+}
 
-	bool retval = ( m_imp->m_read_eof );
-	return retval;
+void FeMedia::start_demux()
+{
+	// Once started, the demux thread keeps its place in the file until
+	// stop() rewinds it
+	if ( m_imp->m_demux_thread.joinable() )
+		return;
+
+	m_imp->m_run_demux = true;
+	m_imp->m_demux_thread = std::thread( &FeMedia::demux_thread, this );
 }
 
-bool FeMedia::read_packet()
+void FeMedia::stop_demux()
 {
-	std::lock_guard<std::recursive_mutex> l( m_imp->m_read_mutex );
+	m_imp->m_run_demux = false;
+	m_imp->notify_space();
 
-	if ( m_imp->m_read_eof )
-		return false;
+	if ( m_imp->m_demux_thread.joinable() )
+		m_imp->m_demux_thread.join();
+}
 
-	if ( !m_imp->m_format_ctx )
+bool FeMedia::demux_queues_full()
+{
+	size_t bytes = 0;
+	bool enough = true;
+
+	if ( m_audio )
 	{
-		m_imp->m_read_eof = true;
-		FeLog() << "Error: Invalid format context: " << FORMAT_CTX_URL << std::endl;
-		return false;
+		bytes += m_audio->packetq.bytes();
+		enough = ( m_audio->packetq.size() >= PACKETQ_MIN_PACKETS );
 	}
 
-	AVPacket *pkt = av_packet_alloc();
-	if ( !pkt )
+	if ( m_video )
 	{
-		m_imp->m_read_eof = true;
-		FeLog() << "Error: Failed to allocate packet: " << FORMAT_CTX_URL << std::endl;
-		return false;
+		bytes += m_video->packetq.bytes();
+		enough = enough && ( m_video->packetq.size() >= PACKETQ_MIN_PACKETS );
 	}
 
+	return ( enough || ( bytes > PACKETQ_MAX_BYTES ));
+}
+
+void FeMedia::demux_thread()
+{
 	if ( !m_imp->m_format_ctx )
 	{
-		FeLog() << "Error: Format context was closed during read operation" << std::endl;
-		av_packet_free( &pkt );
+		FeLog() << "Error: Invalid format context" << std::endl;
 		m_imp->m_read_eof = true;
-		return false;
+		m_imp->notify_packet();
+		return;
 	}
 
-	int r = av_read_frame( m_imp->m_format_ctx, pkt );
-
-	if ( r < 0 )
+	while ( m_imp->m_run_demux )
 	{
-		m_imp->m_read_eof=true;
-		av_packet_free( &pkt );
-		return false;
-	}
+		{
+			std::unique_lock<std::mutex> l( m_imp->m_demux_mutex );
+			m_imp->m_space_cond.wait_for( l, std::chrono::milliseconds( 50 ),
+				[this]{ return !m_imp->m_run_demux || !demux_queues_full(); } );
+		}
 
-	if (( m_audio ) && ( pkt->stream_index == m_audio->stream_id ))
-		m_audio->push_packet( pkt );
-	else if (( m_video ) && (pkt->stream_index == m_video->stream_id ))
-		m_video->push_packet( pkt );
-	else
-		av_packet_free( &pkt );
+		if ( !m_imp->m_run_demux )
+			break;
 
-	return true;
+		if ( demux_queues_full() )
+			continue;
+
+		AVPacket *pkt = av_packet_alloc();
+		if ( !pkt )
+		{
+			FeLog() << "Error: Failed to allocate packet: " << FORMAT_CTX_URL << std::endl;
+			break;
+		}
+
+		if ( av_read_frame( m_imp->m_format_ctx, pkt ) < 0 )
+		{
+			av_packet_free( &pkt );
+			break;
+		}
+
+		FePacketRing *q = NULL;
+		if (( m_audio ) && ( pkt->stream_index == m_audio->stream_id ))
+			q = &m_audio->packetq;
+		else if (( m_video ) && ( pkt->stream_index == m_video->stream_id ))
+			q = &m_video->packetq;
+
+		if ( !q )
+		{
+			av_packet_free( &pkt );
+			continue;
+		}
+
+		// Hard limit reached on this stream's queue, hold the packet until
+		// its consumer catches up
+		while ( !q->push( pkt ))
+		{
+			std::unique_lock<std::mutex> l( m_imp->m_demux_mutex );
+			m_imp->m_space_cond.wait_for( l, std::chrono::milliseconds( 50 ),
+				[this, q]{ return !m_imp->m_run_demux || !q->full(); } );
+
+			if ( !m_imp->m_run_demux )
+			{
+				av_packet_free( &pkt );
+				return;
+			}
+		}
+
+		m_imp->notify_packet();
+	}
+
+	if ( m_imp->m_run_demux )
+	{
+		m_imp->m_read_eof = true;
+		m_imp->notify_packet();
+	}
 }
 
 bool FeMedia::tick()
@@ -1486,6 +1663,15 @@ bool FeMedia::tick()
 	return false;
 }
 
+void FeMedia::set_texture( sf::Texture *out_texture )
+{
+	if ( m_video )
+	{
+		std::lock_guard<std::recursive_mutex> l( m_video->image_swap_mutex );
+		m_video->display_texture = out_texture;
+	}
+}
+
 
 bool FeMedia::onGetData( Chunk &data )
 {
@@ -1494,7 +1680,7 @@ bool FeMedia::onGetData( Chunk &data )
 	data.samples = NULL;
 	data.sampleCount = 0;
 
-	if (( !m_audio ) || end_of_file() )
+	if ( !m_audio )
 		return false;
 
 	std::lock_guard<std::mutex> l( m_callback_mutex );
@@ -1504,19 +1690,30 @@ bool FeMedia::onGetData( Chunk &data )
 		if ( !m_alive.load( std::memory_order_acquire ))
 			return false;
 
-		AVPacket *packet = m_audio->pop_packet();
-		while (( packet == NULL ) && ( !end_of_file() ))
+		//
+		// Wait on the demux thread for our next packet.  The end of file
+		// is checked before popping since the demux thread queues its last
+		// packet before flagging the end.
+		//
+		bool eof = end_of_file();
+		AVPacket *packet = m_audio->packetq.pop();
+		while (( packet == NULL ) && ( !eof ))
 		{
-			read_packet();
 			if ( !m_alive.load( std::memory_order_acquire ))
-			{
-				av_packet_free( &packet );
 				return false;
-			}
 
-			packet = m_audio->pop_packet();
+			if ( !m_imp->m_run_demux.load( std::memory_order_acquire ))
+				return ( offset > 0 );
+
+			m_imp->wait_for_packet();
+
+			eof = end_of_file();
+			packet = m_audio->packetq.pop();
 		}
 
+		if ( packet )
+			m_imp->notify_space();
+
 		if ( packet == NULL )
 		{
 			m_audio->at_end=true;
@@ -69,6 +69,11 @@ public:
 	//
 	bool tick();
 
+	// Change the texture that video frames are drawn to.  The new texture
+	// needs to be the same size as the current one
+	//
+	void set_texture( sf::Texture *out_texture );
+
 	float getVolume() const;
 	void setVolume( float volume );
 
@@ -114,9 +119,15 @@ protected:
 	bool onGetData( Chunk &data ) override;
 	void onSeek( sf::Time timeOffset ) override;
 
-	bool read_packet();
 	bool end_of_file();
 
+	// The demux thread reads packets from the file and queues them for the
+	// audio and video decoders
+	void start_demux();
+	void stop_demux();
+	bool demux_queues_full();
+	void demux_thread();
+
 private:
 	FeMediaImp *m_imp;
 	FeAudioImp *m_audio;
@@ -25,11 +25,13 @@
 #include "fe_base.hpp" // logging
 #include "fe_util.hpp"
 
+#include <SFML/System/Clock.hpp>
 #include <algorithm>
 #include <cstring>
 #include <dirent.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/stat.h>
 
 namespace
 {
@@ -40,15 +42,18 @@ namespace
 };
 
 FePathCache::FePathCache()
+	: m_prefetch_abort( false )
 {
 }
 
 FePathCache::~FePathCache()
 {
+	stop_prefetch();
 }
 
 void FePathCache::clear()
 {
+	stop_prefetch();
 	m_cache.clear();
 	FeDebug() << "Cleared artwork path cache." << std::endl;
 }
@@ -83,15 +88,99 @@ bool FePathCache::get_filename_from_base(
 	return !(in_list.empty());
 }
 
+void FePathCache::prefetch( const std::vector<std::string> &paths )
+{
+	stop_prefetch();
+
+	if ( paths.empty() )
+		return;
+
+	m_prefetch = std::thread( [this, paths]()
+	{
+		sf::Clock timer;
+		FeLogCapture capture;
+		int count=0;
+
+		for ( std::vector<std::string>::const_iterator itr=paths.begin();
+				( itr != paths.end() ) && !m_prefetch_abort; ++itr )
+		{
+			{
+				std::lock_guard<std::mutex> l( m_mutex );
+				if ( m_cache.find( *itr ) != m_cache.end() )
+					continue;
+			}
+
+			std::vector<std::string> temp;
+			read_path( *itr, temp );
+
+			// get_cache() may have read this path meanwhile, and callers can
+			// hold references to its entry, so never replace one
+			std::lock_guard<std::mutex> l( m_mutex );
+			std::pair<std::map<std::string, std::vector<std::string> >::iterator, bool> ret = m_cache.insert(
+				std::pair< std::string, std::vector<std::string> >( *itr, std::vector<std::string>() ));
+
+			if ( ret.second )
+			{
+				ret.first->second.swap( temp );
+				count++;
+			}
+		}
+
+		FeDebug() << "Prefetched " << count << " artwork path(s) in "
+			<< timer.getElapsedTime().asMilliseconds() << "ms" << std::endl;
+
+		m_prefetch_log = capture.str();
+	});
+}
+
+void FePathCache::stop_prefetch()
+{
+	if ( !m_prefetch.joinable() )
+		return;
+
+	m_prefetch_abort = true;
+	m_prefetch.join();
+	m_prefetch_abort = false;
+
+	if ( !m_prefetch_log.empty() )
+		FeLog() << m_prefetch_log;
+	m_prefetch_log.clear();
+}
+
+//
+// Entries in m_cache are only ever added while the prefetch thread runs, and
+// an entry's contents are never replaced once it is in the map, so the
+// reference returned stays valid without holding the lock until the cache
+// is cleared
+//
 std::vector < std::string > &FePathCache::get_cache( const std::string &path )
 {
 	std::map< std::string, std::vector<std::string> >::iterator itr;
 
-	itr = m_cache.find( path );
-	if ( itr != m_cache.end() )
-		return (*itr).second;
+	{
+		std::lock_guard<std::mutex> l( m_mutex );
+		itr = m_cache.find( path );
+		if ( itr != m_cache.end() )
+			return (*itr).second;
+	}
 
 	std::vector < std::string > temp;
+	read_path( path, temp );
+
+	std::pair<std::map<std::string, std::vector<std::string> >::iterator, bool> ret;
+	std::lock_guard<std::mutex> l( m_mutex );
+
+	ret = m_cache.insert(
+		std::pair< std::string, std::vector<std::string> >( path, std::vector<std::string>() ));
+
+	if ( ret.second )
+		ret.first->second.swap( temp );
+
+	return ret.first->second;
+}
+
+void FePathCache::read_path( const std::string &path, std::vector<std::string> &temp )
+{
 	temp.reserve(100);  // Reserve some space to avoid small reallocations
 
 #ifdef SFML_SYSTEM_WINDOWS
@@ -137,14 +226,94 @@ std::vector < std::string > &FePathCache::get_cache( const std::string &path )
 	std::sort( temp.begin(), temp.end(), my_comp );
 
 	FeDebug() << "Caching contents of artwork path: " << path << " (" << temp.size() << " entries)." << std::endl;
+}
 
-	std::pair<std::map<std::string, std::vector<std::string> >::iterator, bool> ret;
+std::map< std::string, FeDirSnapshot::Snapshot > FeDirSnapshot::s_cache;
+std::mutex FeDirSnapshot::s_mutex;
 
-	ret = m_cache.insert(
-		std::pair< std::string, std::vector<std::string> >( path, std::vector<std::string>() ));
+FeDirSnapshot::Listing FeDirSnapshot::get( const std::string &path )
+{
+	time_t mtime = get_file_mtime( path );
 
-	if ( ret.second )
-		ret.first->second.swap( temp );
+	if ( mtime != 0 )
+	{
+		std::lock_guard<std::mutex> l( s_mutex );
 
-	return ret.first->second;
+		std::map< std::string, Snapshot >::iterator itr = s_cache.find( path );
+
+		// A snapshot taken within the same second as the last modification
+		// can't be trusted, since mtime has only one second resolution
+		if (( itr != s_cache.end() )
+				&& ( itr->second.mtime == mtime )
+				&& ( itr->second.taken > mtime ))
+			return itr->second.listing;
+	}
+
+	time_t taken = time( NULL );
+	std::shared_ptr< std::vector<Entry> > temp = std::make_shared< std::vector<Entry> >();
+
+	if ( !read_dir( path, *temp ) || ( mtime == 0 ))
+		return temp;
+
+	std::lock_guard<std::mutex> l( s_mutex );
+	s_cache[ path ] = Snapshot{ mtime, taken, temp };
+
+	return temp;
+}
+
+void FeDirSnapshot::clear()
+{
+	std::lock_guard<std::mutex> l( s_mutex );
+	s_cache.clear();
+}
+
+bool FeDirSnapshot::read_dir( const std::string &path, std::vector<Entry> &list )
+{
+#ifdef SFML_SYSTEM_WINDOWS
+	std::string search_path = path + "*";
+
+	struct _wfinddata_t t;
+	intptr_t srch = _wfindfirst( FeUtil::widen( search_path ).c_str(), &t );
+
+	if ( srch < 0 )
+		return false;
+
+	do
+	{
+		std::string filename = FeUtil::narrow( t.name );
+		if (( filename != "." ) && ( filename != ".." ))
+			list.push_back( Entry{ std::move( filename ), ( t.attrib & _A_SUBDIR ) != 0 } );
+	} while ( _wfindnext( srch, &t ) == 0 );
+	_findclose( srch );
+#else
+	DIR *dir;
+	struct dirent *ent;
+
+	if ( (dir = opendir( path.c_str() )) == NULL )
+		return false;
+
+	while ((ent = readdir( dir )) != NULL )
+	{
+		std::string filename = ent->d_name;
+		if (( filename == "." ) || ( filename == ".." ))
+			continue;
+
+		bool is_dir = false;
+#ifdef _DIRENT_HAVE_D_TYPE
+		if (( ent->d_type != DT_UNKNOWN ) && ( ent->d_type != DT_LNK ))
+			is_dir = ( ent->d_type == DT_DIR );
+		else
+#endif
+		{
+			struct stat st;
+			if ( stat( (path + filename).c_str(), &st ) == 0 )
+				is_dir = S_ISDIR( st.st_mode );
+		}
+
+		list.push_back( Entry{ std::move( filename ), is_dir } );
+	}
+	closedir( dir );
+#endif
+
+	return true;
 }
@@ -26,6 +26,11 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <ctime>
 
 class FePathCache
 {
@@ -42,13 +47,64 @@ public:
 		const std::string &base_name,
 		const char **filter );
 
+	// Read and cache the contents of the given paths on a background thread,
+	// so that the first artwork lookups in them don't have to
+	void prefetch( const std::vector<std::string> &paths );
+
 private:
 	std::map< std::string, std::vector<std::string> > m_cache;
+	std::mutex m_mutex; // guards m_cache while prefetching
+	std::thread m_prefetch;
+	std::atomic<bool> m_prefetch_abort;
+	std::string m_prefetch_log; // written out when the prefetch thread is joined
 
 	FePathCache( FePathCache & );
 	FePathCache &operator=( FePathCache & );
 
 	std::vector < std::string > &get_cache( const std::string &path );
+	void stop_prefetch();
+
+	static void read_path( const std::string &path, std::vector<std::string> &list );
+};
+
+//
+// Snapshot of a directory listing, kept between calls and revalidated
+// against the directory's modification time.  Used by the rom scanner so that
+// repeated availability checks don't re-read directories that haven't changed.
+//
+// Safe to call from multiple threads.
+//
+class FeDirSnapshot
+{
+public:
+	struct Entry
+	{
+		std::string name;
+		bool is_dir;
+	};
+
+	typedef std::shared_ptr< const std::vector<Entry> > Listing;
+
+	// Return the listing of "path" (which must have a trailing slash),
+	// reading the directory only if it has changed since the last call.
+	// Returns an empty listing if the directory can't be opened.
+	//
+	static Listing get( const std::string &path );
+
+	static void clear();
+
+private:
+	struct Snapshot
+	{
+		time_t mtime;
+		time_t taken;
+		Listing listing;
+	};
+
+	static std::map< std::string, Snapshot > s_cache;
+	static std::mutex s_mutex;
+
+	static bool read_dir( const std::string &path, std::vector<Entry> &list );
 };
 
 #endif
@@ -22,13 +22,22 @@
 
 #include "scraper_base.hpp"
 #include "fe_util.hpp"
+#include "fe_hash.hpp"
+#include "fe_cache.hpp"
 #include "zip.hpp"
 
 #include <cstring>
 #include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <iomanip>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
 #include "nowide/fstream.hpp"
+#include "nowide/stat.hpp"
+#include "nowide/cstdio.hpp"
 
 #include <expat.h>
 
@@ -73,110 +82,509 @@ std::string truncate( FeRomInfo &ri, FeRomInfo::Index idx, size_t width )
 	return str;
 }
 
-bool correct_buff_for_format( char *&buff, int &size,
-	const std::string &filename )
+//
+// Get the part of a rom file to hash, so that it matches the dat files
+// used by -listsoftware.  head holds the start of the file.
+//
+void get_hash_window( const char *head, size_t head_len, std::uint64_t size,
+	const std::string &filename, std::uint64_t &skip, std::uint64_t &count )
 {
+	skip = 0;
+	count = size;
+
 	if ( tail_compare( filename, "nes" ) )
 	{
 		//
 		// .nes files: 16 bit header
 		// we only want the first prg block
 		//
-		if (( size <= 16 ) || ( buff[0] != 'N' )
-				|| ( buff[1] != 'E' ) || ( buff[2] != 'S' ))
-			return false;
+		if (( head_len <= 16 ) || ( head[0] != 'N' )
+				|| ( head[1] != 'E' ) || ( head[2] != 'S' ))
+			return;
 
-		int new_size = 16384 * buff[4];
-		bool trainer_present = buff[6] & 0x04;
+		std::uint64_t new_size = 16384 * (unsigned char)head[4];
+		bool trainer_present = head[6] & 0x04;
 
-		int buff_move = 16 + ( trainer_present ? 512 : 0 );
+		std::uint64_t buff_move = 16 + ( trainer_present ? 512 : 0 );
 		if ( new_size + buff_move > size )
-			return false;
+			return;
 
-		buff += buff_move;
-		size = new_size;
+		skip = buff_move;
+		count = new_size;
 	}
+}
 
-	return true;
+const size_t HASH_CHUNK_SIZE = 1048576;
+
+//
+// Hash size bytes read from read_fn, a chunk at a time
+//
+void hash_stream( std::function<size_t( char *, size_t )> read_fn,
+	std::uint64_t size,
+	const std::string &filename,
+	int types,
+	FeRomHash &out )
+{
+	std::vector<char> buff( HASH_CHUNK_SIZE );
+	FeHasher hasher( types );
+
+	std::uint64_t skip=0, count=size, pos=0;
+	size_t len;
+
+	while (( len = read_fn( buff.data(), buff.size() )) > 0 )
+	{
+		if ( pos == 0 )
+			get_hash_window( buff.data(), len, size, filename, skip, count );
+
+		std::uint64_t start = std::max( pos, skip );
+		std::uint64_t end = std::min( pos + len, skip + count );
+		if ( start < end )
+			hasher.update( buff.data() + ( start - pos ), end - start );
+
+		pos += len;
+		if ( pos >= skip + count )
+			break;
+	}
+
+	hasher.finish( out.crc, out.sha1, out.md5 );
+	out.size = count;
 }
 
 } // end namespace
 
-std::string get_crc( const std::string &full_path,
-	const std::vector<std::string> &exts )
+FeRomHasher::FeRomHasher()
+	: m_dirty( false )
 {
-	const int MAX_CRC_FILE_SIZE = 10485760; // don't do CRC checks on files more than 10 meg
+	FeCache::load_hashes( m_cache );
+}
 
-	if ( is_supported_archive( full_path ) )
+FeRomHasher::~FeRomHasher()
+{
+	if ( m_dirty )
+		FeCache::save_hashes( m_cache );
+}
+
+bool FeRomHasher::hash_file( const std::string &path,
+	const std::vector<std::string> &exts,
+	int types,
+	bool open_archives,
+	FeRomHash &out )
+{
+	if ( open_archives && is_supported_archive( path ) )
 	{
 		std::vector<std::string> contents;
-		if ( !fe_zip_get_dir( full_path.c_str(), contents ) )
-			return "";
+		if ( !fe_zip_get_dir( path.c_str(), contents ) )
+			return false;
 
 		// check for extension matches
 		std::vector<std::string>::iterator itr;
 		for ( itr=contents.begin(); itr != contents.end(); ++itr )
 		{
 			//
-			// Run the crc on this file if there is only one file
-			// in the archive or if this file matches one of the
-			// supported extensions
+			// Hash this file if there is only one file in the archive
+			// or if this file matches one of the supported extensions
 			//
 			if ( tail_compare( *itr, exts ) || ( contents.size() == 1 ) )
 			{
-				FeZipStream zs( full_path );
-				zs.open( *itr );
+				FeZipStream zs( path );
+				if ( !zs.open( *itr ) )
+					return false;
 
-				char *buff = zs.getData();
 				std::optional<size_t> size = zs.getSize();
-
 				if ( !size )
-					return "";
-
-				int size_int = static_cast<int>( *size );
+					return false;
 
-				if ( size_int > MAX_CRC_FILE_SIZE )
-					return "";
-
-				correct_buff_for_format( buff, size_int, *itr );
-				std::string retval = get_crc32( buff, size_int );
-				FeDebug() << "CRC: " << full_path << "=" << retval << std::endl;
-				return retval;
+				hash_stream( [&zs]( char *b, size_t n ) { return zs.read( b, n ).value_or( 0 ); },
+					*size, *itr, types, out );
+				return true;
 			}
 		}
 
-		return "";
+		return false;
 	}
 
-	nowide::ifstream myfile( full_path.c_str(),
+	nowide::ifstream myfile( path.c_str(),
 		std::ios_base::in | std::ios_base::binary );
 
 	if ( !myfile.is_open() )
-		return "";
+		return false;
+
+	myfile.seekg( 0, myfile.end );
+	std::uint64_t size = myfile.tellg();
+	myfile.seekg( 0, myfile.beg );
+
+	hash_stream( [&myfile]( char *b, size_t n ) { myfile.read( b, n ); return (size_t)myfile.gcount(); },
+		size, path, types, out );
+	return true;
+}
+
+bool FeRomHasher::hash_files( const std::vector<std::string> &paths,
+	const std::vector<std::string> &exts,
+	int types,
+	bool open_archives,
+	std::vector<FeRomHash> &out,
+	std::function<bool( int )> progress )
+{
+	// Cache entry: file size, file mtime, hashed size, crc, sha1, md5
+	enum { CSize, CMtime, CHashSize, CCrc, CSha1, CMd5, CLast };
+
+	std::string key_suffix;
+	if ( open_archives )
+	{
+		key_suffix = "|";
+		for ( std::vector<std::string>::const_iterator itr=exts.begin(); itr!=exts.end(); ++itr )
+			key_suffix += *itr + ";";
+	}
+
+	out.clear();
+	out.resize( paths.size() );
 
-	myfile.seekg(0, myfile.end);
-	int size = myfile.tellg();
-	myfile.seekg(0, myfile.beg);
+	std::atomic<size_t> next( 0 );
+	std::atomic<int> done( 0 );
+	std::atomic<bool> cancel( false );
+	std::atomic<int> hashed( 0 );
 
-	if ( size > MAX_CRC_FILE_SIZE )
+	auto worker = [&]()
 	{
-		myfile.close();
-		return "";
+		size_t i;
+		while ( !cancel && (( i = next++ ) < paths.size() ))
+		{
+			const std::string &path = paths[i];
+			if ( path.empty() )
+			{
+				done++;
+				continue;
+			}
+
+			nowide::stat_t st;
+			if ( nowide::stat( path.c_str(), &st ) != 0 )
+			{
+				done++;
+				continue;
+			}
+
+			std::string key = path + key_suffix;
+			std::string size_str = std::to_string( (std::uint64_t)st.st_size );
+			std::string mtime_str = std::to_string( (std::int64_t)get_file_mtime( path ) );
+			std::vector<std::string> entry;
+
+			{
+				std::lock_guard<std::mutex> l( m_mutex );
+				std::map<std::string, std::vector<std::string>>::iterator itr = m_cache.find( key );
+				if (( itr != m_cache.end() ) && ( itr->second.size() == CLast )
+						&& ( itr->second[CSize] == size_str )
+						&& ( itr->second[CMtime] == mtime_str ))
+					entry = itr->second;
+			}
+
+			// Only rehash if the file changed or a hash type is missing
+			int missing = types;
+			if ( !entry.empty() )
+			{
+				if ( !entry[CCrc].empty() ) missing &= ~FeHasher::Crc32;
+				if ( !entry[CSha1].empty() ) missing &= ~FeHasher::Sha1;
+				if ( !entry[CMd5].empty() ) missing &= ~FeHasher::Md5;
+			}
+			else
+				entry.resize( CLast );
+
+			if ( missing )
+			{
+				FeRomHash h;
+				if ( !hash_file( path, exts, missing, open_archives, h ) )
+				{
+					done++;
+					continue;
+				}
+
+				entry[CSize] = size_str;
+				entry[CMtime] = mtime_str;
+				entry[CHashSize] = std::to_string( h.size );
+				if ( !h.crc.empty() ) entry[CCrc] = h.crc;
+				if ( !h.sha1.empty() ) entry[CSha1] = h.sha1;
+				if ( !h.md5.empty() ) entry[CMd5] = h.md5;
+
+				FeDebug() << "CRC: " << path << "=" << entry[CCrc] << std::endl;
+				hashed++;
+
+				std::lock_guard<std::mutex> l( m_mutex );
+				m_cache[ key ] = entry;
+				m_dirty = true;
+			}
+
+			FeRomHash &r = out[i];
+			r.size = strtoull( entry[CHashSize].c_str(), NULL, 10 );
+			r.crc = ( types & FeHasher::Crc32 ) ? entry[CCrc] : "";
+			r.sha1 = ( types & FeHasher::Sha1 ) ? entry[CSha1] : "";
+			r.md5 = ( types & FeHasher::Md5 ) ? entry[CMd5] : "";
+
+			done++;
+		}
+	};
+
+	int thread_count = std::max( 1, std::min( (int)std::thread::hardware_concurrency(), 8 ));
+	thread_count = std::min( thread_count, (int)paths.size() );
+
+	std::vector<std::thread> threads;
+	for ( int i=0; i<thread_count; i++ )
+		threads.push_back( std::thread( worker ));
+
+	while ( !cancel && ( done < (int)paths.size() ))
+	{
+		if ( progress && !progress( done ))
+			cancel = true;
+		else
+			std::this_thread::sleep_for( std::chrono::milliseconds( 50 ));
 	}
 
-	char *buff_ptr = new char[size];
-	char *orig_buff_ptr = buff_ptr;
+	for ( std::vector<std::thread>::iterator itr=threads.begin(); itr!=threads.end(); ++itr )
+		itr->join();
 
-	myfile.read( buff_ptr, size );
-	myfile.close();
+	FeDebug() << "Hashed " << hashed << " of " << paths.size() << " files, using "
+		<< thread_count << " thread(s)" << std::endl;
 
-	correct_buff_for_format( buff_ptr, size, full_path );
-	std::string retval = get_crc32( buff_ptr, size );
+	return !cancel;
+}
 
-	delete [] orig_buff_ptr;
+//
+// FeScrapeJournal helpers.  Journal lines are tab separated fields
+//
+namespace
+{
+	const char JOURNAL_SEP = '\t';
+	const char *JOURNAL_HEADER = "# Attract-Mode Plus scrape journal";
 
-	FeDebug() << "CRC: " << full_path << "=" << retval << std::endl;
-	return retval;
+	// Split line on tabs, the last field gets the rest of the line
+	void split_journal_line( const std::string &line, size_t count, std::vector<std::string> &out )
+	{
+		out.clear();
+		size_t pos = 0;
+		while ( out.size() + 1 < count )
+		{
+			size_t end = line.find( JOURNAL_SEP, pos );
+			if ( end == std::string::npos )
+				break;
+
+			out.push_back( line.substr( pos, end - pos ) );
+			pos = end + 1;
+		}
+		out.push_back( line.substr( pos ) );
+	}
+}
+
+FeScrapeJournal::FeScrapeJournal( const std::string &filename )
+	: m_filename( filename ),
+	m_appended( 0 )
+{
+	load();
+}
+
+FeScrapeJournal::~FeScrapeJournal()
+{
+	if ( m_out.is_open() )
+		m_out.close();
+
+	if ( m_appended > 0 )
+		compact();
+}
+
+void FeScrapeJournal::load()
+{
+	nowide::ifstream in( m_filename.c_str() );
+	if ( !in.is_open() )
+		return;
+
+	std::string line;
+	std::vector<std::string> f;
+	while ( std::getline( in, line ) )
+	{
+		if ( !line.empty() && ( line.back() == '\r' ))
+			line.pop_back();
+
+		if ( line.size() < 2 || line[0] == '#' )
+			continue;
+
+		switch ( line[0] )
+		{
+		case 'Q':
+			split_journal_line( line, 5, f );
+			if ( f.size() == 5 )
+			{
+				QueryEntry &q = m_queries[ f[3] ];
+				q.time = (time_t)strtoll( f[1].c_str(), NULL, 10 );
+				q.result = ( f[2] == "F" ) ? Found : NotFound;
+				q.fingerprint = f[4];
+			}
+			break;
+
+		case 'M':
+			split_journal_line( line, 4, f );
+			if ( f.size() == 4 )
+			{
+				MediaEntry &m = m_media[ f[2] ];
+				if ( m.key != f[1] )
+				{
+					m.key = f[1];
+					m_key_media[ f[1] ].push_back( f[2] );
+				}
+				m.url = f[3];
+				m.done = false;
+			}
+			break;
+
+		case 'D':
+			split_journal_line( line, 2, f );
+			if ( f.size() == 2 )
+			{
+				std::map< std::string, MediaEntry >::iterator itr = m_media.find( f[1] );
+				if ( itr != m_media.end() )
+					itr->second.done = true;
+			}
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	FeDebug() << "Loaded scrape journal: " << m_filename << " (" << m_queries.size()
+		<< " queries, " << m_media.size() << " media)" << std::endl;
+}
+
+void FeScrapeJournal::append( const std::string &line )
+{
+	if ( !m_out.is_open() )
+	{
+		bool is_new = !file_exists( m_filename );
+		m_out.open( m_filename.c_str(), std::ios_base::app );
+		if ( !m_out.is_open() )
+			return;
+
+		if ( is_new )
+			m_out << JOURNAL_HEADER << std::endl;
+	}
+
+	// flushed each time so the journal survives the scrape being killed
+	m_out << line << std::endl;
+	m_appended++;
+}
+
+void FeScrapeJournal::compact()
+{
+	std::string temp = m_filename + ".new";
+	{
+		nowide::ofstream out( temp.c_str() );
+		if ( !out.is_open() )
+			return;
+
+		out << JOURNAL_HEADER << "\n";
+
+		for ( std::map< std::string, QueryEntry >::const_iterator itr=m_queries.begin(); itr!=m_queries.end(); ++itr )
+		{
+			out << 'Q' << JOURNAL_SEP << (long long)itr->second.time
+				<< JOURNAL_SEP << (( itr->second.result == Found ) ? "F" : "N" )
+				<< JOURNAL_SEP << itr->first
+				<< JOURNAL_SEP << itr->second.fingerprint << "\n";
+		}
+
+		for ( std::map< std::string, MediaEntry >::const_iterator itr=m_media.begin(); itr!=m_media.end(); ++itr )
+		{
+			out << 'M' << JOURNAL_SEP << itr->second.key
+				<< JOURNAL_SEP << itr->first
+				<< JOURNAL_SEP << itr->second.url << "\n";
+
+			if ( itr->second.done )
+				out << 'D' << JOURNAL_SEP << itr->first << "\n";
+		}
+
+		if ( !out.good() )
+		{
+			out.close();
+			delete_file( temp );
+			return;
+		}
+	}
+
+	delete_file( m_filename );
+	nowide::rename( temp.c_str(), m_filename.c_str() );
+}
+
+FeScrapeJournal::Result FeScrapeJournal::get_result( const std::string &key,
+	const std::string &fingerprint ) const
+{
+	std::map< std::string, QueryEntry >::const_iterator itr = m_queries.find( key );
+	if (( itr == m_queries.end() ) || ( itr->second.fingerprint != fingerprint ))
+		return Unknown;
+
+	if (( itr->second.result == NotFound )
+			&& ( difftime( time( NULL ), itr->second.time ) > NOT_FOUND_TTL_DAYS * 86400.0 ))
+		return Unknown;
+
+	return itr->second.result;
+}
+
+void FeScrapeJournal::set_result( const std::string &key,
+	const std::string &fingerprint,
+	Result r )
+{
+	QueryEntry &q = m_queries[ key ];
+	q.fingerprint = fingerprint;
+	q.result = r;
+	q.time = time( NULL );
+
+	append( std::string( "Q" ) + JOURNAL_SEP + std::to_string( (long long)q.time )
+		+ JOURNAL_SEP + (( r == Found ) ? "F" : "N" )
+		+ JOURNAL_SEP + key + JOURNAL_SEP + fingerprint );
+}
+
+void FeScrapeJournal::add_media( const std::string &key,
+	const std::string &url,
+	const std::string &filename )
+{
+	MediaEntry &m = m_media[ filename ];
+	if ( m.key != key )
+	{
+		m.key = key;
+		m_key_media[ key ].push_back( filename );
+	}
+	m.url = url;
+	m.done = false;
+
+	append( std::string( "M" ) + JOURNAL_SEP + key + JOURNAL_SEP + filename + JOURNAL_SEP + url );
+}
+
+void FeScrapeJournal::media_done( const std::string &filename )
+{
+	std::map< std::string, MediaEntry >::iterator itr = m_media.find( filename );
+	if (( itr == m_media.end() ) || itr->second.done )
+		return;
+
+	itr->second.done = true;
+	append( std::string( "D" ) + JOURNAL_SEP + filename );
+}
+
+bool FeScrapeJournal::get_pending( const std::string &key,
+	std::vector< std::pair< std::string, std::string > > &out ) const
+{
+	out.clear();
+
+	std::map< std::string, std::vector< std::string > >::const_iterator itr = m_key_media.find( key );
+	if ( itr == m_key_media.end() )
+		return true;
+
+	for ( std::vector< std::string >::const_iterator itf=itr->second.begin(); itf!=itr->second.end(); ++itf )
+	{
+		std::map< std::string, MediaEntry >::const_iterator itm = m_media.find( *itf );
+		if (( itm == m_media.end() ) || ( itm->second.key != key ))
+			continue;
+
+		if ( !itm->second.done )
+			out.push_back( std::make_pair( itm->second.url, itm->first ) );
+		else if ( !file_exists( itm->first ) )
+			return false;
+	}
+
+	return true;
 }
 
 //
@@ -265,6 +673,7 @@ FeImporterContext::FeImporterContext( const FeEmulatorInfo &e, FeRomInfoListType
 	use_net( true ),
 	progress_past( 0 ),
 	progress_range( 100 ),
-	download_count( 0 )
+	download_count( 0 ),
+	show_progress( true )
 {
 }
@@ -24,7 +24,13 @@
 #define FE_SCRAPER_BASE_HPP
 
 #include <string>
+#include <map>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+#include <ctime>
 #include "fe_romlist.hpp"
+#include "nowide/fstream.hpp"
 
 typedef bool (*UiUpdate) (void *, int, const std::string &);
 
@@ -42,6 +48,7 @@ public:
 	int progress_past;
 	int progress_range;
 	int download_count;
+	bool show_progress; // write the percent done to the log as it goes
 	std::string user_message;
 	std::string out_name;
 };
@@ -53,7 +60,125 @@ void romlist_console_report( FeRomInfoListType &rl );
 //
 std::string get_fuzzy( const std::string &orig );
 
-std::string get_crc( const std::string &full_path, const std::vector < std::string > &exts );
+//
+// Rom file hashes used to identify games when scraping
+//
+struct FeRomHash
+{
+	std::uint64_t size=0;
+	std::string crc;
+	std::string sha1;
+	std::string md5;
+};
+
+//
+// Hashes rom files on a pool of worker threads.  Files are read in chunks,
+// so there is no limit on their size.  Results are stored in the cache
+// directory keyed by path, size and modified time, so unchanged files are
+// never read again.
+//
+class FeRomHasher
+{
+public:
+	FeRomHasher();
+	~FeRomHasher(); // saves any new results to the cache
+
+	//
+	// Hash each file in paths, the results go in the matching entry of out.
+	// types is a combination of FeHasher::Type values.  If open_archives is
+	// true, the archive member matching exts (or the only member) is hashed
+	// instead of the archive itself.  progress is called on the calling
+	// thread with the number of files done, hashing stops if it returns false.
+	//
+	bool hash_files( const std::vector<std::string> &paths,
+		const std::vector<std::string> &exts,
+		int types,
+		bool open_archives,
+		std::vector<FeRomHash> &out,
+		std::function<bool( int )> progress=nullptr );
+
+private:
+	FeRomHasher( const FeRomHasher & );
+	FeRomHasher &operator=( const FeRomHasher & );
+
+	bool hash_file( const std::string &path,
+		const std::vector<std::string> &exts,
+		int types,
+		bool open_archives,
+		FeRomHash &out );
+
+	std::map<std::string, std::vector<std::string>> m_cache;
+	std::mutex m_mutex;
+	bool m_dirty;
+};
+
+//
+// Persistent record of what a scraper has done for one emulator on one site.
+// Query results (including games that were not found) and media downloads
+// are appended to the journal file as they happen, so an interrupted scrape
+// can carry on where it stopped and later runs only query new or changed
+// roms.  The file is compacted when the journal is destroyed.
+//
+class FeScrapeJournal
+{
+public:
+	enum Result { Unknown, Found, NotFound };
+
+	FeScrapeJournal( const std::string &filename );
+	~FeScrapeJournal();
+
+	//
+	// Get the result of the last query for key.  Returns Unknown if there was
+	// none, if fingerprint differs from when it was recorded (the rom or
+	// settings have changed) or if a NotFound result has expired
+	//
+	Result get_result( const std::string &key, const std::string &fingerprint ) const;
+	void set_result( const std::string &key, const std::string &fingerprint, Result r );
+
+	// Record a media download for key, and its completion
+	void add_media( const std::string &key, const std::string &url, const std::string &filename );
+	void media_done( const std::string &filename );
+
+	//
+	// Get the media recorded for key that has not finished downloading as
+	// (url, filename) pairs.  Returns false if media that was downloaded is
+	// no longer there, in which case the game should be queried again
+	//
+	bool get_pending( const std::string &key,
+		std::vector< std::pair< std::string, std::string > > &out ) const;
+
+	// How long NotFound results are kept before the game is queried again
+	static const int NOT_FOUND_TTL_DAYS = 30;
+
+private:
+	FeScrapeJournal( const FeScrapeJournal & );
+	FeScrapeJournal &operator=( const FeScrapeJournal & );
+
+	struct QueryEntry
+	{
+		std::string fingerprint;
+		Result result=Unknown;
+		time_t time=0;
+	};
+
+	struct MediaEntry
+	{
+		std::string key;
+		std::string url;
+		bool done=false;
+	};
+
+	void load();
+	void append( const std::string &line );
+	void compact();
+
+	std::string m_filename;
+	std::map< std::string, QueryEntry > m_queries; // key is rom key
+	std::map< std::string, MediaEntry > m_media; // key is filename
+	std::map< std::string, std::vector< std::string > > m_key_media;
+	nowide::ofstream m_out;
+	int m_appended;
+};
 
 typedef std::map < std::string, FeRomInfo * > ParentMapType;
 
@@ -22,6 +22,7 @@
 
 #include <string>
 #include <map>
+#include <set>
 
 #include "nowide/fstream.hpp"
 #include "rapidjson/document.h"
@@ -626,6 +627,7 @@ void create_ft(
 
 #define INFO_QUERY 16
 #define IMAGE_QUERY 420
+#define NAME_QUERY 1000 // name queries are numbered from here
 
 void create_single_id_query(
 		std::vector < std::pair< int, FeRomInfo * > > &id_worklist,
@@ -726,6 +728,24 @@ bool FeSettings::thegamesdb_scraper( FeImporterContext &c )
 
 	std::string emu_name = c.emulator.get_info( FeEmulatorInfo::Name );
 
+	std::string plat_id_str;
+	for ( pd_itr = plats_db.begin(); pd_itr != plats_db.end(); ++pd_itr )
+	{
+		if ( !plat_id_str.empty() )
+			plat_id_str += "%2C";
+
+		plat_id_str += as_str( (*pd_itr).get_plat_id() );
+	}
+
+	//
+	// The journal remembers which games couldn't be matched by name, so they
+	// aren't searched for again on every run
+	//
+	std::string emu_path = get_config_dir() + FE_SCRAPER_SUBDIR;
+	confirm_directory( emu_path, emu_name + "/" );
+	FeScrapeJournal journal( emu_path + emu_name + "/thegamesdb.journal" );
+	int skipped_count = 0;
+
 	for ( FeRomInfoListType::iterator itl = c.romlist.begin(); itl != c.romlist.end(); ++itl )
 	{
 		(*itl).set_info( FeRomInfo::Emulator, emu_name );
@@ -750,14 +770,25 @@ bool FeSettings::thegamesdb_scraper( FeImporterContext &c )
 			id = (*pd_itr).get_id_from_name( name_with_brackets_stripped( (*itl).get_info( FeRomInfo::Title ) ));
 
 		if ( id < 0 )
-			name_worklist.push_back( &(*itl) );
+		{
+			if ( journal.get_result( (*itl).get_info( FeRomInfo::Romname ),
+					get_fuzzy( (*itl).get_info( FeRomInfo::Title ) ) + ":" + plat_id_str ) == FeScrapeJournal::NotFound )
+				skipped_count++;
+			else
+				name_worklist.push_back( &(*itl) );
+		}
 		else
 			id_worklist.push_back( std::pair<int, FeRomInfo *>( id, &(*itl) ) );
 	}
 
+	if ( skipped_count > 0 )
+		FeLog() << " - Skipping " << skipped_count << " games not matched on a previous run" << std::endl;
+
 	FeNetQueue q;
 	std::map< int, FeRomInfo * > my_id_map;
 	std::map< std::string, FeRomInfo * > my_fuzz_map;
+	std::vector< std::string > name_queries; // fuzzy name of each name query
+	std::set< std::string > names_answered;
 
 	std::map< int, std::string > genres;
 	std::map< int, std::string > publishers;
@@ -845,15 +876,6 @@ fail_emu_scrape:
 	// Build requests for games without IDs (skip if we are scraping art, because we need
 	// the IDs in order to get artworks
 	//
-	std::string plat_id_str;
-	for ( pd_itr = plats_db.begin(); pd_itr != plats_db.end(); ++pd_itr )
-	{
-		if ( !plat_id_str.empty() )
-			plat_id_str += "%2C";
-
-		plat_id_str += as_str( (*pd_itr).get_plat_id() );
-	}
-
 	while ( !name_worklist.empty() )
 	{
 		const std::string &temp =  name_worklist.back()->get_info( FeRomInfo::Title );
@@ -870,7 +892,8 @@ fail_emu_scrape:
 		name_worklist.pop_back();
 
 		FeDebug() << " - db query: " << my_req << std::endl;
-		q.add_buffer_task( my_req, INFO_QUERY );
+		q.add_buffer_task( my_req, NAME_QUERY + (int)name_queries.size() );
+		name_queries.push_back( get_fuzzy( temp ) );
 		q_total++;
 	}
 
@@ -881,9 +904,9 @@ fail_emu_scrape:
 	}
 
 	//
-	// Create work threads to process the queue, adding new tasks to download
+	// Create a worker to process the queue, adding new tasks to download
 	//
-	FeNetWorker worker1( q ), worker2( q ), worker3( q ), worker4( q );
+	FeNetWorker worker( q, 4 );
 	std::string aux;
 
 	bool my_all_done = false;
@@ -941,6 +964,9 @@ fail_emu_scrape:
 			if ( !parse_confirm_data( result, doc, remaining_allowance ) )
 				continue;
 
+			if (( id >= NAME_QUERY ) && ( id - NAME_QUERY < (int)name_queries.size() ))
+				names_answered.insert( name_queries[ id - NAME_QUERY ] );
+
 			const rapidjson::Value &d = doc[DATA_E];
 
 			if ( id == IMAGE_QUERY )
@@ -1171,7 +1197,7 @@ fail_emu_scrape:
 
 		}
 		else
-			std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+			q.wait_for_result();
 	}
 
 	if ( !my_fuzz_map.empty() )
@@ -1184,6 +1210,10 @@ fail_emu_scrape:
 		{
 			FeLog() << ( dc?",":"" ) << "\"" << (*it2).second->get_info( FeRomInfo::Romname ) << "\"";
 			dc=true;
+
+			if ( names_answered.find( (*it2).first ) != names_answered.end() )
+				journal.set_result( (*it2).second->get_info( FeRomInfo::Romname ),
+					(*it2).first + ":" + plat_id_str, FeScrapeJournal::NotFound );
 		}
 
 		FeLog() << std::endl;
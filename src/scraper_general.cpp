@@ -31,6 +31,10 @@
 #include "nowide/fstream.hpp"
 #include <list>
 #include <map>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <memory>
 
 extern const char *FE_ROMLIST_SUBDIR;
 
@@ -410,12 +414,47 @@ bool scummvm_build( FeImporterContext &c )
 	return true;
 }
 
+const int MAX_BUILD_THREADS = 4;
+
+//
+// The online scrapers share their site caches and the connection limits, so
+// when several emulators are built at once only one of them scrapes at a time
+//
+std::mutex g_net_scrape_mutex;
+
+//
+// Progress of one emulator's romlist build
+//
+struct FeBuildJob
+{
+	std::atomic<int> percent{ -1 }; // -1 until started
+	std::atomic<bool> *cancel=NULL;
+};
+
+//
+// UiUpdate handed to the importers, which run on worker threads.  It only
+// records the progress, the real UiUpdate is called by the thread that
+// started the build
+//
+bool build_job_update( void *d, int percent, const std::string & )
+{
+	FeBuildJob *job = (FeBuildJob *)d;
+	job->percent = std::max( 0, std::min( percent, 99 ));
+	return !*job->cancel;
+}
+
 }; // end namespace
 
 bool FeSettings::apply_xml_import( FeImporterContext &c )
 {
 	bool cancelled = false;
 
+	auto tgdb = [this,&c]()
+	{
+		std::lock_guard<std::mutex> l( g_net_scrape_mutex );
+		return thegamesdb_scraper( c );
+	};
+
 	std::string base_command = clean_path( c.emulator.get_info(
 				FeEmulatorInfo::Executable ) );
 
@@ -456,7 +495,7 @@ bool FeSettings::apply_xml_import( FeImporterContext &c )
 		cancelled = !lsp.get_continue_parse();
 
 		if ( !cancelled && c.use_net && ( is == FeEmulatorInfo::Listsoftware_tgdb ) )
-			cancelled = !thegamesdb_scraper( c );
+			cancelled = !tgdb();
 	}
 	break;
 
@@ -531,24 +570,27 @@ bool FeSettings::apply_xml_import( FeImporterContext &c )
 		}
 
 		if ( c.use_net )
-			cancelled = !thegamesdb_scraper( c );
+			cancelled = !tgdb();
 	}
 	break;
 
 	case FeEmulatorInfo::Thegamesdb:
 		if ( c.use_net )
-			cancelled = !thegamesdb_scraper( c );
+			cancelled = !tgdb();
 		break;
 
 	case FeEmulatorInfo::Screenscraper:
 		if ( c.use_net )
+		{
+			std::lock_guard<std::mutex> l( g_net_scrape_mutex );
 			cancelled = !screenscraper_scraper( c );
+		}
 		break;
 
 	case FeEmulatorInfo::Scummvm:
 		scummvm_build( c );
 		if ( c.use_net )
-			cancelled = !thegamesdb_scraper( c );
+			cancelled = !tgdb();
 		break;
 
 	case FeEmulatorInfo::None:
@@ -567,15 +609,34 @@ bool FeSettings::build_romlist( const std::vector< FeImportTask > &task_list,
 	FeRomInfoListType total_romlist;
 	std::string best_name, list_name, path;
 
+	//
+	// The emulators' romlists are all built up front (in parallel), and then
+	// merged in with the other tasks' results in task order below
+	//
+	std::vector<FeEmulatorInfo *> build_emus;
+	for ( std::vector<FeImportTask>::const_iterator itr=task_list.begin();
+			itr < task_list.end(); ++itr )
+	{
+		if ( (*itr).task_type != FeImportTask::BuildRomlist )
+			continue;
+
+		FeEmulatorInfo *emu = m_rl.get_emulator( (*itr).emulator_name );
+		if ( emu )
+			build_emus.push_back( emu );
+	}
+
+	std::vector<FeRomInfoListType> built;
+	std::string built_message;
+	build_emulator_romlists( build_emus, full, true, output_name, NULL, NULL, built, built_message );
+
+	size_t next_built = 0;
+
 	for ( std::vector<FeImportTask>::const_iterator itr=task_list.begin();
 			itr < task_list.end(); ++itr )
 	{
 		if ( (*itr).task_type == FeImportTask::BuildRomlist )
 		{
 			// Build romlist task
-			FeLog() << "*** Generating Collection/Romlist: "
-				<< (*itr).emulator_name << std::endl;
-
 			FeEmulatorInfo *emu = m_rl.get_emulator( (*itr).emulator_name );
 			if ( emu == NULL )
 			{
@@ -584,21 +645,8 @@ bool FeSettings::build_romlist( const std::vector< FeImportTask > &task_list,
 			}
 			else
 			{
-				FeRomInfoListType romlist;
-
 				best_name = emu->get_info( FeEmulatorInfo::Name );
-
-				FeImporterContext ctx( *emu, romlist );
-				ctx.full = full;
-				ctx.out_name = output_name;
-
-				build_basic_romlist( ctx );
-
-				apply_xml_import( ctx );
-				apply_import_extras( ctx, emu->is_mame() );
-
-				apply_emulator_name( best_name, romlist );
-				total_romlist.splice( total_romlist.end(), romlist );
+				total_romlist.splice( total_romlist.end(), built[ next_built++ ] );
 			}
 		}
 		else if ( (*itr).task_type == FeImportTask::ImportRomlist )
@@ -633,7 +681,7 @@ bool FeSettings::build_romlist( const std::vector< FeImportTask > &task_list,
 				// Native format list
 				//
 				FeRomList temp_list( m_config_path );
-				temp_list.load_from_file( (*itr).file_name, ";" );
+				temp_list.load_romlist_file( (*itr).file_name );
 
 				FeRomInfoListType &entries = temp_list.get_list();
 
@@ -696,7 +744,7 @@ bool FeSettings::build_romlist( const std::vector< FeImportTask > &task_list,
 			if ( file_exists( fn ) )
 			{
 				FeRomList loader( get_config_dir() );
-				loader.load_from_file( fn, ";" );
+				loader.load_romlist_file( fn );
 				ctx.romlist.swap( loader.get_list() );
 			}
 			else
@@ -774,53 +822,181 @@ bool FeSettings::build_romlist( const std::vector< FeImportTask > &task_list,
 	return true;
 }
 
-bool FeSettings::build_romlist( const std::vector<std::string> &emu_list, const std::string &out_name,
-	UiUpdate uiu, void *uid, std::string &msg, bool use_net )
+bool FeSettings::build_emulator_romlists( const std::vector<FeEmulatorInfo *> &emus,
+	bool full,
+	bool use_net,
+	const std::string &out_name,
+	UiUpdate uiu,
+	void *uid,
+	std::vector<FeRomInfoListType> &results,
+	std::string &user_message )
 {
+	results.clear();
+	results.resize( emus.size() );
+
+	if ( emus.empty() )
+		return true;
+
+	std::vector<FeBuildJob> jobs( emus.size() );
+	std::vector<std::string> messages( emus.size() );
+	std::vector<std::string> logs( emus.size() );
+	std::vector<bool> logged( emus.size(), false );
+	std::atomic<size_t> next( 0 );
+	std::atomic<bool> cancel( false );
+
+	for ( size_t i=0; i<jobs.size(); i++ )
+		jobs[i].cancel = &cancel;
+
+	int thread_count = std::max( 1, std::min( (int)std::thread::hardware_concurrency(), MAX_BUILD_THREADS ));
+	thread_count = std::min( thread_count, (int)emus.size() );
+
+	std::atomic<int> running( thread_count );
+
+	auto worker = [&]()
+	{
+		size_t i;
+		while ( !cancel && (( i = next++ ) < emus.size() ))
+		{
+			const FeEmulatorInfo &emu = *emus[i];
+			const std::string &name = emu.get_info( FeEmulatorInfo::Name );
+
+			// With several workers each job's log is held back and written
+			// out whole by the calling thread, so that jobs don't interleave
+			std::unique_ptr<FeLogCapture> capture;
+			if ( thread_count > 1 )
+				capture.reset( new FeLogCapture() );
+
+			FeLog() << "*** Generating Collection/Romlist: " << name << std::endl;
+			jobs[i].percent = 0;
+
+			FeImporterContext ctx( emu, results[i] );
+			ctx.full = full;
+			ctx.use_net = use_net;
+			ctx.out_name = out_name;
+			ctx.uiupdate = build_job_update;
+			ctx.uiupdatedata = &jobs[i];
+			ctx.show_progress = ( thread_count == 1 );
+
+			build_basic_romlist( ctx );
+
+			// Without a UiUpdate there is no one to cancel, so a failed
+			// import just leaves its list as it is
+			if ( !apply_xml_import( ctx ) && uiu )
+				cancel = true;
+
+			apply_import_extras( ctx, emu.is_mame() );
+			apply_emulator_name( name, results[i] );
+
+			messages[i] = ctx.user_message;
+			if ( capture )
+				logs[i] = capture->str();
+
+			jobs[i].percent = 100;
+		}
+
+		running--;
+	};
+
+	std::vector<std::thread> threads;
+	for ( int i=0; i<thread_count; i++ )
+		threads.push_back( std::thread( worker ));
+
 	//
-	// Put up the "building romlist" message at 0 percent while we get going...
+	// Report progress from this thread, since the UiUpdate draws to the
+	// window.  It is called on every pass, even with no change, so that the
+	// user can still cancel during long steps
 	//
-	if ( uiu )
-		uiu( uid, 0, "" );
-
-	FeRomInfoListType total_romlist;
-	bool cancelled = false;
-	std::string user_message;
+	auto write_logs = [&]()
+	{
+		for ( size_t i=0; i<jobs.size(); i++ )
+		{
+			if ( !logged[i] && ( jobs[i].percent == 100 ))
+			{
+				FeLog() << logs[i];
+				logged[i] = true;
+			}
+		}
+	};
 
-	for ( std::vector<std::string>::const_iterator itr = emu_list.begin();
-		!cancelled && ( itr != emu_list.end() ); ++itr )
+	while ( running > 0 )
 	{
-		FeEmulatorInfo *emu = m_rl.get_emulator( *itr );
-		if ( emu == NULL )
-			continue;
+		write_logs();
 
-		FeLog() << "*** Generating Collection/Romlist: "
-			<< emu->get_info( FeEmulatorInfo::Name ) << std::endl;
+		if ( uiu && !cancel )
+		{
+			int total = 0;
+			std::string status;
 
-		FeRomInfoListType romlist;
+			for ( size_t i=0; i<jobs.size(); i++ )
+			{
+				int p = jobs[i].percent;
+				if ( p < 0 )
+					continue;
 
-		FeImporterContext ctx( *emu, romlist );
-		ctx.uiupdate = uiu;
-		ctx.uiupdatedata = uid;
-		ctx.out_name = out_name;
-		ctx.use_net = use_net;
+				total += p;
 
-		build_basic_romlist( ctx );
-		if ( !apply_xml_import( ctx ) )
-			cancelled = true;
+				// list the emulators being worked on
+				if ( p < 100 )
+				{
+					if ( !status.empty() )
+						status += "\n";
+
+					status += emus[i]->get_info( FeEmulatorInfo::Name ) + " " + as_str( p ) + "%";
+				}
+			}
+
+			if ( !uiu( uid, std::min( 99, total / (int)jobs.size() ), status ))
+				cancel = true;
+		}
+
+		std::this_thread::sleep_for( std::chrono::milliseconds( 50 ));
+	}
+
+	for ( std::vector<std::thread>::iterator itr=threads.begin(); itr!=threads.end(); ++itr )
+		itr->join();
+
+	write_logs();
 
-		apply_import_extras( ctx, emu->is_mame() );
-		apply_emulator_name( *itr, romlist );
+	FeDebug() << "Built " << emus.size() << " romlist(s) using " << thread_count << " thread(s)" << std::endl;
 
-		total_romlist.splice( total_romlist.end(), romlist );
+	// the message from the last emulator in the list wins, as when they were built one at a time
+	for ( size_t i=0; i<messages.size(); i++ )
+	{
+		if ( !messages[i].empty() )
+			user_message = messages[i];
+	}
+
+	return !cancel;
+}
+
+bool FeSettings::build_romlist( const std::vector<std::string> &emu_list, const std::string &out_name,
+	UiUpdate uiu, void *uid, std::string &msg, bool use_net )
+{
+	//
+	// Put up the "building romlist" message at 0 percent while we get going...
+	//
+	if ( uiu )
+		uiu( uid, 0, "" );
 
-		if ( !ctx.user_message.empty() )
-			user_message = ctx.user_message;
+	std::vector<FeEmulatorInfo *> emus;
+	for ( std::vector<std::string>::const_iterator itr = emu_list.begin(); itr != emu_list.end(); ++itr )
+	{
+		FeEmulatorInfo *emu = m_rl.get_emulator( *itr );
+		if ( emu )
+			emus.push_back( emu );
 	}
 
-	if ( cancelled )
+	std::vector<FeRomInfoListType> built;
+	std::string user_message;
+
+	if ( !build_emulator_romlists( emus, false, use_net, out_name, uiu, uid, built, user_message ))
 		return false;
 
+	// Merge in emulator list order, so the result doesn't depend on which finished first
+	FeRomInfoListType total_romlist;
+	for ( std::vector<FeRomInfoListType>::iterator itr = built.begin(); itr != built.end(); ++itr )
+		total_romlist.splice( total_romlist.end(), *itr );
+
 	total_romlist.sort( FeRomListSorter() );
 
 	// strip duplicate entries
@@ -843,7 +1019,7 @@ bool FeSettings::build_romlist( const std::vector<std::string> &emu_list, const
 		? _( "Added $1 Collection/Romlist entries", { as_str( total_romlist.size() ) })
 		: user_message;
 
-	return !cancelled;
+	return true;
 }
 
 bool FeSettings::scrape_artwork( const std::string &emu_name, UiUpdate uiu, void *uid, std::string &msg )
@@ -872,7 +1048,7 @@ bool FeSettings::scrape_artwork( const std::string &emu_name, UiUpdate uiu, void
 	if ( file_exists( fn ) )
 	{
 		FeRomList loader( get_config_dir() );
-		loader.load_from_file( fn, ";" );
+		loader.load_romlist_file( fn );
 		ctx.romlist.swap( loader.get_list() );
 	}
 	else
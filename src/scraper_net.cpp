@@ -41,13 +41,15 @@ extern const char *FE_ROMLIST_SUBDIR;
 #ifdef USE_LIBCURL
 bool process_q_simple( FeNetQueue &q,
 	FeImporterContext &c,
-	int taskc )
+	int taskc,
+	FeScrapeJournal &journal,
+	const std::string &site )
 {
 	int done( 0 );
 	//
-	// Create worker threads to process the queue.
+	// Create a worker to process the queue.
 	//
-	FeNetWorker worker1( q ), worker2( q ), worker3( q ), worker4( q );
+	FeNetWorker worker( q, 4 );
 
 	//
 	// Process the output queue from our worker threads
@@ -56,8 +58,18 @@ bool process_q_simple( FeNetQueue &q,
 	while ( !q.all_done() )
 	{
 		int id;
+		long code;
 		std::string result;
 
+		// Missing files are remembered so they aren't requested on every run
+		while ( q.pop_failed_task( id, result, code ) )
+		{
+			if ( code == 404 )
+				journal.set_result( result, site, FeScrapeJournal::NotFound );
+
+			done++;
+		}
+
 		if ( q.pop_completed_task( id, result ) )
 		{
 			if ( id < 0 )
@@ -84,7 +96,7 @@ bool process_q_simple( FeNetQueue &q,
 			}
 		}
 		else
-			std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+			q.wait_for_result();
 
 		if ( c.uiupdate && ( taskc > 0 ) )
 		{
@@ -123,6 +135,15 @@ bool FeSettings::simple_scraper( FeImporterContext &c,
 
 	bool is_snap = ( strcmp( art_label, "snap" ) == 0 );
 
+	std::string site = host;
+	size_t spos = site.find( "://" );
+	if ( spos != std::string::npos )
+		site.erase( 0, spos + 3 );
+
+	confirm_directory( get_config_dir() + FE_SCRAPER_SUBDIR, emu_name + "/" );
+	FeScrapeJournal journal( base_path + site + ".journal" );
+	int skipped( 0 );
+
 	for ( FeRomInfoListType::iterator itr=c.romlist.begin(); itr!=c.romlist.end(); ++itr )
 	{
 		// ugh, this must be set for has_artwork() to correctly function
@@ -161,12 +182,21 @@ bool FeSettings::simple_scraper( FeImporterContext &c,
 			else
 				fname += ".png";
 
+			if ( journal.get_result( fname, site ) == FeScrapeJournal::NotFound )
+			{
+				skipped++;
+				continue;
+			}
+
 			q.add_file_task( url, fname );
 			taskc++;
 		}
 	}
 
-	return process_q_simple( q, c, taskc );
+	if ( skipped > 0 )
+		FeLog() << " - Skipping " << skipped << " files not found on a previous run" << std::endl;
+
+	return process_q_simple( q, c, taskc, journal, site );
 #else
 	FeLog() << " - Unable to scrape network, frontend was built without libcurl enabled" << std::endl;
 	return true;
@@ -23,6 +23,8 @@
 #include "fe_settings.hpp"
 #include "fe_util.hpp"
 #include "fe_net.hpp"
+#include "fe_hash.hpp"
+#include "scraper_base.hpp"
 
 #include "nowide/fstream.hpp"
 #include "nowide/cstdio.hpp"
@@ -36,15 +38,12 @@
 #include <vector>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
 
 #ifdef USE_LIBCURL
 
 #include <expat.h>
 
-#ifdef USE_LIBARCHIVE
-#include <zlib.h>
-#endif
-
 const char *SSHOSTNAME = "https://api.screenscraper.fr/api2";
 
 namespace
@@ -53,6 +52,9 @@ namespace
 const std::string SS_DEV_ID{char(78^1),char(110^1),char(108^1),char(100^1),char(106^1)};
 const std::string SS_DEV_PASSWORD{char(84^1),char(102^1),char(77^1),char(110^1),char(53^1),char(87^1),char(87^1),char(57^1),char(50^1),char(112^1),char(85^1)};
 
+// requests the worker can have open, whatever the user's api limit
+const int SS_MIN_REQUESTS = 4;
+
 const std::map<std::string, int> SS_SYSTEM_MAP =
 {
 	// Atari
@@ -508,6 +510,7 @@ int get_screenscraper_sysid( const std::string &emulator_name )
 }
 
 std::string get_ss_game_search_url( const std::string &game_name,
+	const FeRomHash &hash,
 	const std::string &username,
 	const std::string &password,
 	int systemeid )
@@ -520,6 +523,19 @@ std::string get_ss_game_search_url( const std::string &game_name,
 	url += std::to_string( systemeid );
 	url += "&romnom=";
 	url += url_encode( game_name );
+
+	// Hashes let ScreenScraper identify the game regardless of its filename
+	if ( !hash.crc.empty() )
+	{
+		url += "&romtype=rom&romtaille=";
+		url += std::to_string( hash.size );
+		url += "&crc=";
+		url += hash.crc;
+		if ( !hash.md5.empty() )
+			url += "&md5=" + hash.md5;
+		if ( !hash.sha1.empty() )
+			url += "&sha1=" + hash.sha1;
+	}
 	url += "&langue=en";  // Force English
 
 	if ( !username.empty() && !password.empty() )
@@ -566,7 +582,7 @@ int get_ss_user_info( const std::string &username, const std::string &password )
 			return 0;
 		}
 		else
-			std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+			q.wait_for_result();
 	}
 
 	if ( aux.empty() )
@@ -599,32 +615,29 @@ int get_ss_user_info( const std::string &username, const std::string &password )
 
 std::string calculate_file_crc32( const std::string &filename )
 {
-#ifdef USE_LIBARCHIVE
 	nowide::ifstream file( filename, std::ios::binary );
 	if ( !file.is_open() )
 		return "";
 
-	file.seekg( 0, std::ios::end );
-	std::streamsize file_size = file.tellg();
-	file.seekg( 0, std::ios::beg );
+	FeHasher hasher( FeHasher::Crc32 );
+	std::vector<char> buffer( 65536 );
+	std::streamsize total = 0;
 
-	if ( file_size == 0 )
-		return "";
+	while ( file.read( buffer.data(), buffer.size() ) || file.gcount() > 0 )
+	{
+		hasher.update( buffer.data(), file.gcount() );
+		total += file.gcount();
+	}
 
-	std::vector<char> buffer( file_size );
-	if ( !file.read( buffer.data(), file_size ) )
+	if ( total == 0 )
 		return "";
 
-	u_long crc = crc32( 0L, Z_NULL, 0 );
-	crc = crc32( crc, (Bytef *)buffer.data(), file_size );
+	std::string crc, sha1, md5;
+	hasher.finish( crc, sha1, md5 );
 
 	// Format as uppercase hex
-	char buf[9];
-	snprintf( buf, sizeof(buf), "%08lX", (unsigned long)crc );
-	return buf;
-#else
-	return "";
-#endif
+	std::transform( crc.begin(), crc.end(), crc.begin(), ::toupper );
+	return crc;
 }
 
 std::string format_genres( const std::vector<std::string> &genres )
@@ -695,7 +708,7 @@ std::string format_genres( const std::vector<std::string> &genres )
 	return result;
 }
 
-void download_media( FeNetQueue &q, const std::string &url,
+void download_media( FeNetQueue &q, FeScrapeJournal &journal, const std::string &url,
 	const std::string &romname, const std::string &art_type,
 	const std::string &path_base, const std::string &server_crc = "" )
 {
@@ -730,6 +743,8 @@ void download_media( FeNetQueue &q, const std::string &url,
 			filename += ".png";
 	}
 
+	journal.add_media( romname, url, filename );
+
 	if ( file_exists( filename ) )
 	{
 		if ( !server_crc.empty() )
@@ -740,6 +755,7 @@ void download_media( FeNetQueue &q, const std::string &url,
 			{
 				FeDebug() << " - Skipping download (CRC match): " << filename
 					<< " (local: " << local_crc << ", server: " << uppercase( server_crc ) << ")" << std::endl;
+				journal.media_done( filename );
 				return;
 			}
 			else
@@ -751,6 +767,7 @@ void download_media( FeNetQueue &q, const std::string &url,
 		else
 		{
 			FeDebug() << " - Skipping download (file exists): " << filename << std::endl;
+			journal.media_done( filename );
 			return;
 		}
 	}
@@ -803,11 +820,20 @@ bool FeSettings::screenscraper_scraper( FeImporterContext &c )
 		confirm_directory( emu_path, "overview" );
 
 	int info_taskc = 0;
-	int total_count = 0;
 
 	FeNetQueue q;
 	std::map<int, std::string> task_to_romname;
+	std::map<int, std::string> task_to_fingerprint;
 
+	FeScrapeJournal journal( emu_path + "screenscraper.journal" );
+
+	// Changing which media gets scraped means every game is queried again
+	std::string settings_fp;
+	for ( bool b : { m_scrape_snaps, m_scrape_marquees, m_scrape_flyers,
+			m_scrape_wheels, m_scrape_fanart, m_scrape_vids, m_scrape_overview } )
+		settings_fp += b ? '1' : '0';
+
+	std::vector<FeRomInfo *> to_scrape;
 	for ( auto& rom : c.romlist )
 	{
 		rom.set_info( FeRomInfo::Emulator, emu_name );
@@ -821,17 +847,80 @@ bool FeSettings::screenscraper_scraper( FeImporterContext &c )
 			}
 		}
 
-		total_count++;
+		to_scrape.push_back( &rom );
+	}
+
+	//
+	// Hash the rom files so ScreenScraper can match them exactly.  Archives
+	// are hashed as they are, which is what ScreenScraper expects.  The CRC
+	// and size are enough for it to find a rom, MD5 and SHA-1 are only sent
+	// when asked for since they take much longer on large files
+	//
+	std::vector<std::string> paths;
+	paths.reserve( to_scrape.size() );
+	for ( auto rom : to_scrape )
+		paths.push_back( rom->get_info( FeRomInfo::BuildFullPath ) );
+
+	std::vector<FeRomHash> hashes;
+	{
+		FeRomHasher hasher;
+		if ( !hasher.hash_files( paths, std::vector<std::string>(),
+				FeHasher::Crc32 | ( m_scrape_full_hashes ? FeHasher::Sha1 | FeHasher::Md5 : 0 ), false, hashes,
+				[&c]( int ) { return !c.uiupdate || c.uiupdate( c.uiupdatedata, c.progress_past, "" ); } ))
+			return false;
+	}
+
+	int skipped_count = 0;
+	int resumed_count = 0;
+	std::vector< std::pair< std::string, std::string > > pending;
+
+	for ( size_t i=0; i<to_scrape.size(); i++ )
+	{
+		FeRomInfo &rom = *to_scrape[i];
+		const std::string &romname = rom.get_info( FeRomInfo::Romname );
 
 		std::string game_name = name_with_brackets_stripped( rom.get_info( FeRomInfo::Title ) );
-		std::string url = get_ss_game_search_url( game_name, username, password, sysid );
+		std::string fingerprint = hashes[i].crc + ":" + std::to_string( hashes[i].size )
+			+ ":" + settings_fp + ":" + game_name;
+
+		//
+		// Skip games that weren't found last time, and when scraping artwork
+		// skip games that were found, just finishing any of their downloads
+		// that didn't complete
+		//
+		FeScrapeJournal::Result r = journal.get_result( romname, fingerprint );
+		if ( r == FeScrapeJournal::NotFound )
+		{
+			skipped_count++;
+			continue;
+		}
+
+		if (( r == FeScrapeJournal::Found ) && c.scrape_art && journal.get_pending( romname, pending ))
+		{
+			for ( size_t j=0; j<pending.size(); j++ )
+				q.add_file_task( pending[j].first, pending[j].second );
+
+			if ( pending.empty() )
+				skipped_count++;
+			else
+				resumed_count++;
+
+			continue;
+		}
+
+		std::string url = get_ss_game_search_url( game_name, hashes[i], username, password, sysid );
 
 		q.add_buffer_task( url, info_taskc );
-		task_to_romname[info_taskc] = rom.get_info( FeRomInfo::Romname );
+		task_to_romname[info_taskc] = romname;
+		task_to_fingerprint[info_taskc] = fingerprint;
 		info_taskc++;
 	}
 
-	if ( info_taskc == 0 )
+	if ( skipped_count > 0 || resumed_count > 0 )
+		FeLog() << " - Scrape journal: skipping " << skipped_count << " games, resuming downloads for "
+			<< resumed_count << " games" << std::endl;
+
+	if (( info_taskc == 0 ) && ( resumed_count == 0 ))
 	{
 		FeLog() << " - No games to scrape." << std::endl;
 		return true;
@@ -840,13 +929,15 @@ bool FeSettings::screenscraper_scraper( FeImporterContext &c )
 	FeLog() << " - Querying " << info_taskc << " games from ScreenScraper" << std::endl;
 
 	int num_workers = ( ss_workers > 0 && ss_workers <= 15 ) ? ss_workers : 1;
-	FeLog() << " - Using " << num_workers << " worker threads for scraping" << std::endl;
-
-	std::vector<std::unique_ptr<FeNetWorker>> workers;
-	workers.reserve(num_workers);
+	FeLog() << " - Using " << num_workers << " concurrent requests for scraping" << std::endl;
 
-	for (int i = 0; i < num_workers; i++)
-		workers.emplace_back(std::make_unique<FeNetWorker>(q));
+	//
+	// ScreenScraper limits the number of api requests each user can have
+	// open at once.  Media downloads from its other hosts aren't held to
+	// that limit, so the worker can keep a few of them going alongside
+	//
+	q.set_host_limit( SSHOSTNAME, num_workers );
+	FeNetWorker worker( q, std::max( num_workers, SS_MIN_REQUESTS ));
 
 	int info_done = 0;
 	const int initial_task_count = info_taskc;
@@ -855,11 +946,28 @@ bool FeSettings::screenscraper_scraper( FeImporterContext &c )
 	int found( 0 );
 	std::string aux;
 
+	//
+	// ScreenScraper responds with a 404 when it has no match for a game
+	//
+	auto record_failures = [&]()
+	{
+		int fid;
+		long code;
+		std::string target;
+		while ( q.pop_failed_task( fid, target, code ) )
+		{
+			if (( fid >= 0 ) && ( code == 404 ))
+				journal.set_result( task_to_romname[fid], task_to_fingerprint[fid], FeScrapeJournal::NotFound );
+		}
+	};
+
 	while ( !q.all_done() )
 	{
 		int id;
 		std::string result;
 
+		record_failures();
+
 		if ( q.pop_completed_task( id, result ) )
 		{
 			if ( id >= 0 )
@@ -867,8 +975,9 @@ bool FeSettings::screenscraper_scraper( FeImporterContext &c )
 				info_done++;
 				games.clear();
 				SSXMLParser parser( games );
+				bool parsed = parser.parse( result );
 
-				if ( parser.parse( result ) && !games.empty() )
+				if ( parsed && !games.empty() )
 				{
 					std::string romname = task_to_romname[id];
 					std::string rom_title = name_with_brackets_stripped( romname );
@@ -887,6 +996,9 @@ bool FeSettings::screenscraper_scraper( FeImporterContext &c )
 					if ( game == NULL && !games.empty() )
 						game = &games.front();
 
+					if ( game == NULL || game->name.empty() )
+						journal.set_result( romname, task_to_fingerprint[id], FeScrapeJournal::NotFound );
+
 					if ( game != NULL && !game->name.empty() )
 					{
 						for ( auto& rom : c.romlist )
@@ -941,37 +1053,37 @@ bool FeSettings::screenscraper_scraper( FeImporterContext &c )
 
 						if ( m_scrape_snaps && !game->snap.empty() )
 						{
-							download_media( q, game->snap, romname, "snap", emu_path, game->snap_crc );
+							download_media( q, journal, game->snap, romname, "snap", emu_path, game->snap_crc );
 							c.download_count++;
 						}
 
 						if ( m_scrape_marquees && !game->marquee.empty() )
 						{
-							download_media( q, game->marquee, romname, "marquee", emu_path, game->marquee_crc );
+							download_media( q, journal, game->marquee, romname, "marquee", emu_path, game->marquee_crc );
 							c.download_count++;
 						}
 
 						if ( m_scrape_flyers && !game->flyer.empty() )
 						{
-							download_media( q, game->flyer, romname, "flyer", emu_path, game->flyer_crc );
+							download_media( q, journal, game->flyer, romname, "flyer", emu_path, game->flyer_crc );
 							c.download_count++;
 						}
 
 						if ( m_scrape_wheels && !game->wheel.empty() )
 						{
-							download_media( q, game->wheel, romname, "wheel", emu_path, game->wheel_crc );
+							download_media( q, journal, game->wheel, romname, "wheel", emu_path, game->wheel_crc );
 							c.download_count++;
 						}
 
 						if ( m_scrape_fanart && !game->fanart.empty() )
 						{
-							download_media( q, game->fanart, romname, "fanart", emu_path, game->fanart_crc );
+							download_media( q, journal, game->fanart, romname, "fanart", emu_path, game->fanart_crc );
 							c.download_count++;
 						}
 
 						if ( m_scrape_vids && !game->video.empty() )
 						{
-							download_media( q, game->video, romname, "video", emu_path, game->video_crc );
+							download_media( q, journal, game->video, romname, "video", emu_path, game->video_crc );
 						}
 
 						if ( m_scrape_overview && !game->description.empty() )
@@ -989,15 +1101,26 @@ bool FeSettings::screenscraper_scraper( FeImporterContext &c )
 							found++;
 
 						aux = game->name;
+						journal.set_result( romname, task_to_fingerprint[id], FeScrapeJournal::Found );
 					}
 				}
 				else
+				{
 					FeDebug() << " - No game info found for query ID " << id << std::endl;
+
+					// a response we can't parse is likely an error message, so the
+					// game is only known to be missing if the response parsed
+					if ( parsed )
+						journal.set_result( task_to_romname[id], task_to_fingerprint[id], FeScrapeJournal::NotFound );
+				}
 			}
 			else if ( id == -1 )
 			{
 				if ( !result.empty() )
+				{
 					FeLog() << " - Downloaded: " << result << std::endl;
+					journal.media_done( result );
+				}
 				else
 					FeLog() << " - Failed to download" << std::endl;
 				c.download_count--;
@@ -1011,9 +1134,11 @@ bool FeSettings::screenscraper_scraper( FeImporterContext &c )
 			}
 		}
 		else
-			std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+			q.wait_for_result();
 	}
 
+	record_failures();
+
 	FeLog() << " - Scrape complete. Found " << found << " games." << std::endl;
 	return true;
 }
@@ -22,6 +22,7 @@
 
 #include "scraper_xml.hpp"
 #include "fe_util.hpp"
+#include "fe_hash.hpp"
 #include "zip.hpp"
 
 #include <cstring>
@@ -135,7 +136,8 @@ FeListXMLParser::FeListXMLParser( FeImporterContext &ctx )
 	m_displays( 0 ),
 	m_collect_data( false ),
 	m_chd( false ),
-	m_mechanical( false )
+	m_mechanical( false ),
+	m_last_percent( 0 )
 {
 }
 
@@ -390,7 +392,6 @@ void FeListXMLParser::end_element( const char *element )
 
 			m_count++;
 
-			static int last_percent( 0 );
 			if ( !m_ctx.full && ( !m_ctx.romlist.empty() ))
 			{
 				int per = m_ctx.progress_past
@@ -401,17 +402,18 @@ void FeListXMLParser::end_element( const char *element )
 				if ( m_count == m_ctx.romlist.size() )
 					set_complete( true );
 
-				if ( per != last_percent )
+				if ( per != m_last_percent )
 				{
-					last_percent = per;
+					m_last_percent = per;
 
-					FeLog() << "\b\b\b\b" << std::setw(3)
-						<< last_percent << '%' << std::flush;
+					if ( m_ctx.show_progress )
+						FeLog() << "\b\b\b\b" << std::setw(3)
+							<< m_last_percent << '%' << std::flush;
 
 					if ( m_ui_update )
 					{
 						if ( m_ui_update( m_ui_update_data,
-								last_percent,
+								m_last_percent,
 								(*m_itr).get_info( FeRomInfo::Title ) ) == false )
 							set_continue_parse( false );
 					}
@@ -775,6 +777,27 @@ bool FeListSoftwareParser::parse( const std::string &prog,
 				&& ( !temp_list.empty() ))
 		{
 			FeRomInfo &ri = temp_list.front();
+
+			//
+			// Hash all the rom files up front, in parallel
+			//
+			std::vector<std::string> paths;
+			paths.reserve( m_ctx.romlist.size() );
+			for ( itr=m_ctx.romlist.begin(); itr!=m_ctx.romlist.end(); ++itr )
+				paths.push_back( (*itr).get_info( FeRomInfo::BuildFullPath ) );
+
+			std::vector<FeRomHash> hashes;
+			FeRomHasher hasher;
+			if ( !hasher.hash_files( paths, listxml.get_sl_extensions(),
+					FeHasher::Crc32, true, hashes,
+					[this, s]( int done ) {
+						return !m_ui_update || m_ui_update( m_ui_update_data, done*90/s, "" );
+					} ))
+			{
+				set_continue_parse( false );
+				break;
+			}
+
 			for ( itr=m_ctx.romlist.begin(); itr!=m_ctx.romlist.end(); ++itr )
 			{
 				(*itr).copy_info( ri, FeRomInfo::Players );
@@ -785,9 +808,7 @@ bool FeListSoftwareParser::parse( const std::string &prog,
 				(*itr).copy_info( ri, FeRomInfo::DisplayType );
 				(*itr).copy_info( ri, FeRomInfo::Buttons );
 
-				std::string crc = get_crc(
-					(*itr).get_info( FeRomInfo::BuildFullPath ),
-					listxml.get_sl_extensions() );
+				const std::string &crc = hashes[c].crc;
 
 				//
 				// Add rom to our crc and fuzzy name maps
@@ -802,16 +823,6 @@ bool FeListSoftwareParser::parse( const std::string &prog,
 							(*itr).get_info( FeRomInfo::Romname ) ),
 						&(*itr) ) );
 
-
-				if ( m_ui_update )
-				{
-					if ( m_ui_update( m_ui_update_data,
-							c*90/s, "") == false )
-					{
-						set_continue_parse( false );
-						break;
-					}
-				}
 				c++;
 			}
 			system_name=(*its);
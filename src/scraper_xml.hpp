@@ -91,6 +91,7 @@ private:
 	bool m_collect_data;
 	bool m_chd;
 	bool m_mechanical;
+	int m_last_percent;
 	std::vector<std::string> m_sl_exts; // softlists: supported extensions
 
 	void pre_parse();